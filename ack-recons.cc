@@ -91,16 +91,12 @@ AckRecons::recv(Packet *pkt)
 	double now = Scheduler::instance().clock();
 	hdr_tcp *tcph = hdr_tcp::access(pkt);
 	int &ack = tcph->seqno(), a, i;
-	Tcl& tcl = Tcl::instance();
 #ifdef DEBUG
 	printf("%f\tRecd ack %d\n", now, ack);
 #endif
 	if (ackTemplate_ == 0)
 		ackTemplate_ = pkt->copy();
-	if (adaptive_)
-		tcl.evalf("%s ackbw %d %f\n", name(), ack, now);
-	/* The ack spacing policy is implemented in Tcl for flexibility */
-	tcl.evalf("%s spacing %d\n", name(), ack);
+	spacing(ack, now);
 	/* 
 	 * If the difference in acks is less than a threshold, let
 	 * it go through.  Later, we will look for rapid ack arrivals
@@ -125,10 +121,11 @@ AckRecons::recv(Packet *pkt)
 			dupacks_++;
 		/* Intersperse some acks and schedule their transmissions. */
 		double starttime = max(now, lastTime_);
+		double step = (policy_ == SPACING_TOKEN) ? 0 : ackSpacing_;
 		for (a = lastAck_+delack_, i=0; a <= ack; a += delack_, i++)
-			sendack(a, starttime + i*ackSpacing_ - now);
+			queueack(a, release(starttime + i*step));
 		if ((a-ack)%delack_)
-			sendack(ack, starttime + i*ackSpacing_ - now);
+			queueack(ack, release(starttime + i*step));
 		Packet::free(pkt);
 	}
 	if (ack >= lastRealAck_) {
@@ -137,64 +134,199 @@ AckRecons::recv(Packet *pkt)
 	}
 }
 
+AckRecons::~AckRecons()
+{
+	timer_.force_cancel();
+	delete [] pendAck_;
+	delete [] pendTime_;
+	if (ackTemplate_)
+		Packet::free(ackTemplate_);
+}
+
+/*
+ * Update ackSpacing_ (and ackInterArr_) for the arrival of ack at now.
+ * SPACING_TCL leaves this to the "spacing" and "ackbw" instprocs, for
+ * policies that are not built in.
+ */
+void
+AckRecons::spacing(int ack, double now)
+{
+	Tcl& tcl = Tcl::instance();
+	int n;
+
+	switch (policy_) {
+	case SPACING_TCL:
+		if (adaptive_)
+			tcl.evalf("%s ackbw %d %f\n", name(), ack, now);
+		tcl.evalf("%s spacing %d\n", name(), ack);
+		break;
+	case SPACING_EWMA:
+		/* spread the acks to generate until the next one arrives */
+		if (lastRealTime_ > 0)
+			ackInterArr_ = alpha_*(now - lastRealTime_) +
+				(1 - alpha_)*ackInterArr_;
+		n = (delack_ > 0) ? (ack - lastAck_)/delack_ : 0;
+		if (n > 0)
+			ackSpacing_ = ackInterArr_/n;
+		break;
+	}
+}
+
+/*
+ * The time at which an ack ready at t can go.  With SPACING_TOKEN,
+ * each ack takes a token from a bucket filling at ackRate_.
+ */
+double
+AckRecons::release(double t)
+{
+	if (policy_ != SPACING_TOKEN || ackRate_ <= 0)
+		return t;
+	if (tokenTime_ < 0) {
+		tokens_ = ackBurst_;	/* a full bucket to start with */
+		tokenTime_ = t;
+	}
+	if (t < tokenTime_)
+		t = tokenTime_;
+	tokens_ += (t - tokenTime_)*ackRate_;
+	if (tokens_ > ackBurst_)
+		tokens_ = ackBurst_;
+	if (tokens_ < 1) {
+		t += (1 - tokens_)/ackRate_;
+		tokens_ = 1;
+	}
+	tokens_ -= 1;
+	tokenTime_ = t;
+	return t;
+}
+
 int
 AckRecons::command(int argc, const char*const* argv)
 {
+	Tcl& tcl = Tcl::instance();
+	static const char *policies[] = { "tcl", "fixed", "ewma", "token" };
+
+	if (argc == 2 && strcmp(argv[1], "spacing-policy") == 0) {
+		tcl.resultf("%s", policies[policy_]);
+		return (TCL_OK);
+	}
+	if (argc == 3 && strcmp(argv[1], "spacing-policy") == 0) {
+		for (int i = 0; i < 4; i++) {
+			if (strcmp(argv[2], policies[i]) == 0) {
+				policy_ = i;
+				return (TCL_OK);
+			}
+		}
+		tcl.resultf("%s: unknown spacing policy %s", name(), argv[2]);
+		return (TCL_ERROR);
+	}
 	return Agent::command(argc, argv);
 }
 
 /*
- * Arrange to send ack a at time t from now.
+ * Arrange to send ack at time t.  A new burst of acks may start before
+ * the end of the last one, so an ack is inserted from the tail of the
+ * ring, after the acks due no later than it.
  */
 void
-AckRecons::sendack(int ack, double t)
+AckRecons::queueack(int ack, double t)
 {
-	Packet *ackp = ackTemplate_->copy();
-	Scheduler &s = Scheduler::instance();
-	hdr_tcp *th = hdr_tcp::access(ackp);
-	th->seqno() = ack;
-	/* Set no_ts_ in flags because we don't want an rtt sample for this */
-	if (th->ts() == hdr_tcp::access(ackp)->ts()) {
-		hdr_flags *fh = hdr_flags::access(ackp);
-		fh->no_ts_ = 1;
-		th->ts_ = s.clock();	/* for debugging purposes only */
+	int i, j, n;
+
+	if (ackPending_ > pendMask_) {
+		n = (pendMask_ < 0) ? 16 : 2*(pendMask_ + 1);
+		int *nack = new int[n];
+		double *ntime = new double[n];
+		for (i = 0; i < ackPending_; i++) {
+			nack[i] = pendAck_[(pendHead_ + i) & pendMask_];
+			ntime[i] = pendTime_[(pendHead_ + i) & pendMask_];
+		}
+		delete [] pendAck_;
+		delete [] pendTime_;
+		pendAck_ = nack;
+		pendTime_ = ntime;
+		pendHead_ = 0;
+		pendMask_ = n - 1;
 	}
-	s.schedule((Handler *)this, (Event *)ackp, t);
+	/* insertion from the tail, keeping acks of equal times in order */
+	for (i = ackPending_; i > 0; i--) {
+		j = (pendHead_ + i - 1) & pendMask_;
+		if (pendTime_[j] <= t)
+			break;
+		pendAck_[(j + 1) & pendMask_] = pendAck_[j];
+		pendTime_[(j + 1) & pendMask_] = pendTime_[j];
+	}
+	j = (pendHead_ + i) & pendMask_;
+	pendAck_[j] = ack;
+	pendTime_[j] = t;
 	ackPending_++;
+	if (i == 0) {
+		double now = Scheduler::instance().clock();
+		timer_.resched(t - now);
+	}
 #ifdef DEBUG
 	printf("\t%f\tScheduling ack %d to be sent at %f\n", 
-	       s.clock(), ack, s.clock() + t);
+	       Scheduler::instance().clock(), ack, t);
 #endif
 }
 
+void
+AckReconsTimer::expire(Event *)
+{
+	a_->timeout(0);
+}
+
 /* 
- * Handle scheduling of acks.
+ * Send the acks that are due, and wait for the next one.  The one at
+ * the head is due when the timer goes off.
  */
 void
-AckRecons::handle(Event *e)
+AckRecons::timeout(int)
 {
-	Packet *p = (Packet *) e;
-	hdr_tcp *th = hdr_tcp::access(p);
-	ackPending_--;
-	if (lastAck_ < th->seqno()) {
+	double now = Scheduler::instance().clock();
+	do {
+		int ack = pendAck_[pendHead_];
+		pendHead_ = (pendHead_ + 1) & pendMask_;
+		ackPending_--;
+		sendack(ack);
+	} while (ackPending_ > 0 && pendTime_[pendHead_] <= now);
+	if (ackPending_ > 0)
+		timer_.resched(pendTime_[pendHead_] - now);
+}
+
+/*
+ * Send ack now, unless a later one was sent already.
+ */
+void
+AckRecons::sendack(int ack)
+{
+	if (lastAck_ < ack) {
+		Packet *ackp = ackTemplate_->copy();
+		hdr_tcp *th = hdr_tcp::access(ackp);
+		th->seqno() = ack;
+		/*
+		 * Set no_ts_ in flags because we don't want an rtt
+		 * sample for this
+		 */
+		hdr_flags *fh = hdr_flags::access(ackp);
+		fh->no_ts_ = 1;
+		th->ts_ = Scheduler::instance().clock(); /* for debugging */
 		spq_->reconsAcks_ = 0;
 		/* 
 		 * need to do queue's recv here, so that a deque is
 		 * forced if the queue isn't blocked.  It's not
 		 * sufficient to call spq_->recv() alone.
 		 */
-		target_->recv(p); /* maybe do acksfirst for this ack? */
+		target_->recv(ackp); /* maybe do acksfirst for this ack? */
 		spq_->reconsAcks_ = 1;
 		lastTime_ = Scheduler::instance().clock();
-		lastAck_ = th->seqno();
+		lastAck_ = ack;
 #ifdef DEBUG
-		printf("%f\tSending scheduled ack %d\n",lastTime_,th->seqno());
+		printf("%f\tSending scheduled ack %d\n", lastTime_, ack);
 #endif
 	} else {
-		Packet::free(p);
 #ifdef DEBUG
 		printf("%f\tack %d superceded by ack %d at %f\n", 
-		       Scheduler::instance().clock(), th->seqno(), lastAck_,
+		       Scheduler::instance().clock(), ack, lastAck_,
 		       lastTime_);
 #endif
 	}
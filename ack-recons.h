@@ -50,6 +50,23 @@
 #define ns_ack_recons_h
 
 #include "semantic-packetqueue.h"
+#include "timer-handler.h"
+
+/* ack spacing policies, set with "spacing-policy" */
+#define SPACING_TCL	0	/* "spacing" and "ackbw" instprocs, per ack */
+#define SPACING_FIXED	1	/* ackSpacing_ as set */
+#define SPACING_EWMA	2	/* spread acks over the ack interarrival EWMA */
+#define SPACING_TOKEN	3	/* token bucket of ackRate_, ackBurst_ acks */
+
+class AckRecons;
+
+class AckReconsTimer : public TimerHandler {
+public:
+	AckReconsTimer(AckRecons *a) : TimerHandler() { a_ = a; }
+protected:
+	virtual void expire(Event *e);
+	AckRecons *a_;
+};
 
 class AckReconsController : public TclObject {
 public:
@@ -63,7 +80,9 @@ public:
 	AckRecons(nsaddr_t src, nsaddr_t dst) :
 		Agent(PT_TCP), spq_(0), src_(src), dst_(dst),
 		ackTemplate_(0), ackPending_(0), lastAck_(0), 
-		lastRealAck_(0) {
+		lastRealAck_(0), dupacks_(0), policy_(SPACING_TCL),
+		tokens_(0), tokenTime_(-1), pendAck_(0), pendTime_(0),
+		pendHead_(0), pendMask_(-1), timer_(this) {
 			bind("lastTime_", &lastTime_);
 			bind("lastAck_", &lastAck_);
 			bind("lastRealTime_", &lastRealTime_);
@@ -75,17 +94,23 @@ public:
 			bind("adaptive_", &adaptive_);
 			bind("alpha_", &alpha_);
 			bind("size_", &size_);
+			bind("ackRate_", &ackRate_);
+			bind("ackBurst_", &ackBurst_);
 		}
+	~AckRecons();
 	int command(int argc, const char*const* argv);
-	void handle(Event *e);
+	void timeout(int tno);
 	void recv(Packet *p);
 	SemanticPacketQueue *spq_; /* the corresponding queue of packets */
 private:
-	void sendack(int ack, double t); /* send ack pkt at time t */
+	void spacing(int ack, double now);
+	double release(double t);
+	void queueack(int ack, double t); /* send ack pkt at time t */
+	void sendack(int ack);
 	nsaddr_t src_;		/* src addr:port */
 	nsaddr_t dst_;		/* dst addr:port */
 	Packet	*ackTemplate_;	/* used as a template for generated acks */
-	int	ackPending_;
+	int	ackPending_;	/* number of acks in the pending ring */
 	int	lastAck_;	/* last ack sent by recons, maybe generated */
 	int	lastRealAck_;	/* last ack actually received on link */
 	double	lastTime_;	/* time when last ack was sent */
@@ -100,6 +125,22 @@ private:
 	int	delack_;	/* generate ack at least every delack_ acks */
 	int	adaptive_;	/* whether to adapt ack bandwidth? */
 	double	alpha_;	/* used in linear filter for ack rate est. */
+	int	policy_;	/* SPACING_* */
+	double	ackRate_;	/* token rate (acks/s) for SPACING_TOKEN */
+	int	ackBurst_;	/* bucket depth (acks) for SPACING_TOKEN */
+	double	tokens_;	/* tokens in the bucket at tokenTime_ */
+	double	tokenTime_;
+
+	/*
+	 * Acks scheduled for transmission, in time order: a ring of
+	 * ackPending_ entries from pendHead_, with a power of two size.
+	 * timer_ runs for the time of the one at pendHead_.
+	 */
+	int	*pendAck_;
+	double	*pendTime_;
+	int	pendHead_;
+	int	pendMask_;
+	AckReconsTimer timer_;
 };
 
 #endif
@@ -52,6 +52,142 @@ CorresHost::CorresHost() : slink(), TcpFsAgent(),
 	closecwTS_ = 0;
 	connIter_ = new Islist_iter<IntTcpAgent> (conns_);
 	rtt_seg_ = NULL;
+	seglast_ = NULL;
+	segPool_ = NULL;
+	sessHash_ = NULL;
+	rehash_segs(64);
+}
+
+CorresHost::~CorresHost()
+{
+	Segment *seg;
+
+	while ((seg = seglist_.get()) != NULL)
+		delete seg;
+	while ((seg = segPool_) != NULL) {
+		segPool_ = (Segment *) seg->next_;
+		delete seg;
+	}
+	delete [] sessHash_;
+	delete connIter_;
+}
+
+Segment *
+CorresHost::alloc_seg()
+{
+	Segment *seg = segPool_;
+
+	if (seg == NULL)
+		return (new Segment);
+	segPool_ = (Segment *) seg->next_;
+	return (seg);
+}
+
+/*
+ * The segment being timed is deleted rather than pooled.  rtt_seg_ is
+ * not cleared when it is freed on a retransmission, and a later new can
+ * still reuse its address, as it could before the pool; pooling it would
+ * make the very next segment match it.  rtt_seg_ is never dereferenced:
+ * rmv_old_segs() clears it when an acked segment matches, and
+ * TcpSessionAgent::newack() only checks it for NULL, so a stale match
+ * just ends the RTT sample early.
+ */
+void
+CorresHost::free_seg(Segment *seg)
+{
+	if (seg == rtt_seg_) {
+		delete seg;
+		return;
+	}
+	seg->next_ = segPool_;
+	segPool_ = seg;
+}
+
+/*
+ * Hash chains hold their segments in the reverse of their seglist_
+ * order, as segments are only appended to seglist_.
+ */
+void
+CorresHost::rehash_segs(int size)
+{
+	Segment *seg;
+
+	delete [] sessHash_;
+	sessHashSize_ = size;
+	sessHash_ = new Segment*[size];
+	for (int i = 0; i < size; i++)
+		sessHash_[i] = NULL;
+	Islist_iter<Segment> seg_iter(seglist_);
+	while ((seg = seg_iter()) != NULL) {
+		Segment **bucket = &sessHash_[seg->sessionSeqno_ & (size-1)];
+		seg->hnext_ = *bucket;
+		*bucket = seg;
+	}
+}
+
+void
+CorresHost::seg_append(Segment *seg)
+{
+	IntTcpAgent *sender = seg->sender_;
+
+	seg->prev_ = seglast_;
+	seglist_.append(seg);
+	seglast_ = seg;
+	if (seglist_.count() > sessHashSize_)
+		rehash_segs(2*sessHashSize_);
+	else {
+		Segment **bucket = 
+			&sessHash_[seg->sessionSeqno_ & (sessHashSize_-1)];
+		seg->hnext_ = *bucket;
+		*bucket = seg;
+	}
+	seg->cprev_ = sender->segTail_;
+	seg->cnext_ = NULL;
+	if (sender->segTail_)
+		sender->segTail_->cnext_ = seg;
+	else
+		sender->segHead_ = seg;
+	sender->segTail_ = seg;
+}
+
+void
+CorresHost::seg_remove(Segment *seg)
+{
+	IntTcpAgent *sender = seg->sender_;
+	Segment **pp;
+
+	if (seg == seglast_)
+		seglast_ = seg->prev_;
+	else
+		((Segment *) seg->next_)->prev_ = seg->prev_;
+	seglist_.remove(seg, seg->prev_);
+	pp = &sessHash_[seg->sessionSeqno_ & (sessHashSize_-1)];
+	while (*pp != seg)
+		pp = &(*pp)->hnext_;
+	*pp = seg->hnext_;
+	if (seg->cprev_)
+		seg->cprev_->cnext_ = seg->cnext_;
+	else
+		sender->segHead_ = seg->cnext_;
+	if (seg->cnext_)
+		seg->cnext_->cprev_ = seg->cprev_;
+	else
+		sender->segTail_ = seg->cprev_;
+}
+
+/*
+ * Return the first segment in seglist_ with this sessionSeqno, if any.
+ */
+Segment *
+CorresHost::find_seg(int sessionSeqno)
+{
+	Segment *seg, *found = NULL;
+
+	for (seg = sessHash_[sessionSeqno & (sessHashSize_-1)]; seg; 
+	     seg = seg->hnext_)
+		if (seg->sessionSeqno_ == sessionSeqno)
+			found = seg;
+	return (found);
 }
 
 
@@ -195,7 +331,7 @@ CorresHost::add_pkts(int /*size*/, int seqno, int sessionSeqno, int daddr, int d
 	class Segment *news;
 
 	ownd_ += 1;
-	news = new Segment;
+	news = alloc_seg();
 	news->seqno_ = seqno;
 	news->sessionSeqno_ = sessionSeqno;
 	news->daddr_ = daddr;
@@ -209,7 +345,7 @@ CorresHost::add_pkts(int /*size*/, int seqno, int sessionSeqno, int daddr, int d
 	news->partialack_ = 0;
 	news->rxmitted_ = 0;
 	news->sender_ = sender;
-	seglist_.append(news);
+	seg_append(news);
 	return news;
 }
 
@@ -226,7 +362,7 @@ CorresHost::adjust_ownd(int size)
 int
 CorresHost::clean_segs(int /*size*/, Packet *pkt, IntTcpAgent *sender, int sessionSeqno, int amt_data_acked)
 { 
-    Segment *cur, *prev=NULL, *newseg;
+    Segment *cur, *newseg;
     int i;
     //int rval = -1;
 
@@ -252,7 +388,6 @@ CorresHost::clean_segs(int /*size*/, Packet *pkt, IntTcpAgent *sender, int sessi
      */
 
     for (i=0; i < rexmtSegCount_; i++) {
-	    int remove_flag = 0;
 	    /* 
 	     * curArray_ only contains segments that are the first oldest
 	     * unacked segments of their connection (i.e., they are at the left
@@ -264,7 +399,6 @@ CorresHost::clean_segs(int /*size*/, Packet *pkt, IntTcpAgent *sender, int sessi
 	     * through all the segments.
 	     */
 	    cur = curArray_[i];
-	    prev = prevArray_[i];
 	    if (cur->partialack_ || cur->dupacks_ > 0 || 
 		cur->sender_->num_thresh_dupack_segs_ > 1 ) {
 		    if (cur->thresh_dupacks_) {
@@ -296,17 +430,9 @@ CorresHost::clean_segs(int /*size*/, Packet *pkt, IntTcpAgent *sender, int sessi
 					    min(double(ownd_),cur->dupacks_);
 				    ownd_ -= min(double(ownd_),cur->dupacks_);
 			    }
-			    seglist_.remove(cur, prev);
-			    remove_flag = 1;
-			    delete cur;
+			    seg_remove(cur);
+			    free_seg(cur);
 		    }
-		    /* 
-		     * if segment just removed used to be the one just previous
-		     * to the next segment in the array, update prev for the
-		     * next segment
-		     */
-		    if (remove_flag && cur == prevArray_[i+1])
-			    prevArray_[i+1] = prev;
 	    }
     }
     rexmtSegCount_ = 0;
@@ -349,7 +475,7 @@ CorresHost::rmv_old_segs(Packet *pkt, IntTcpAgent *sender, int amt_data_acked)
 			/* higher ack => clean up acked packets */
 			if (tcph->seqno() >= cur->seqno_) {
 				adjust_ownd(cur->size_);
-				seglist_.remove(cur, prev);
+				seg_remove(cur);
 				remove_flag = 1;
 				new_data_acked += cur->size_;
 				if (new_data_acked >= amt_data_acked)
@@ -358,7 +484,6 @@ CorresHost::rmv_old_segs(Packet *pkt, IntTcpAgent *sender, int amt_data_acked)
 					prev = NULL;
 				if (cur == rtt_seg_)
 					rtt_seg_ = NULL;
-				delete cur;
 				if (seg_iter.get_cur() && prev)
 					seg_iter.set_cur(prev);
 				else if (seg_iter.get_cur())
@@ -408,11 +533,12 @@ CorresHost::rmv_old_segs(Packet *pkt, IntTcpAgent *sender, int amt_data_acked)
 		    (cur->dupacks_ + cur->later_acks_ >= sender->numdupacks_ ||
 		     cur->partialack_)) {
 			curArray_[rexmtSegCount_] = cur;
-			prevArray_[rexmtSegCount_] = prev;
 			rexmtSegCount_++;
 		}
 		if (!remove_flag)
 			prev = cur;
+		else
+			free_seg(cur);
 	}
 	/* partial ack => terminate fast start mode */
 	if (partialack && fs_enable_ && fs_mode_) {
@@ -49,7 +49,8 @@ class Segment : public slink {
   public:
 	Segment() {ts_ = 0;
 	seqno_ = later_acks_ = dupacks_ = dport_ = sport_ = size_ = rxmitted_ = 
-		daddr_ = 0; thresh_dupacks_ = 0; partialack_ = 0;};
+		daddr_ = 0; thresh_dupacks_ = 0; partialack_ = 0;
+	prev_ = hnext_ = cprev_ = cnext_ = NULL;};
   protected:
 	int seqno_;
 	int sessionSeqno_;
@@ -65,12 +66,17 @@ class Segment : public slink {
 	int partialack_;  /* whether a partial ack points to this segment */
 	short rxmitted_;
 	class IntTcpAgent *sender_;
+	Segment *prev_;		/* previous segment in seglist_ */
+	Segment *hnext_;	/* next in the sessionSeqno hash chain */
+	Segment *cprev_;	/* previous and next segments */
+	Segment *cnext_;	/*   of the same sender */
 };
 
 class CorresHost : public slink, public TcpFsAgent {
 	friend class IntTcpAgent;
   public:
 	CorresHost();
+	virtual ~CorresHost();
 	/* add pkt to pipe */
 	virtual Segment* add_pkts(int size, int seqno, int sessionSeqno, int daddr, 
 		      int dport, int sport, double ts, IntTcpAgent *sender); 
@@ -108,6 +114,23 @@ class CorresHost : public slink, public TcpFsAgent {
 			        of distinct users (like those from a proxy) */
 	int fixedIw_;        /* fixed initial window (not a function of # conn) */
 	Islist<Segment> seglist_;	/* list of unack'd segments to peer */
+	/*
+	 * The segments in seglist_ are also linked backwards (prev_), hashed
+	 * by sessionSeqno_ (sessHash_), and chained per sender (from
+	 * IntTcpAgent::segHead_), so that none of these lookups need to scan
+	 * seglist_.  seg_append() and seg_remove() keep all of these in
+	 * step.  Removed segments are kept in segPool_ for reuse.
+	 */
+	Segment *seglast_;
+	Segment **sessHash_;
+	int sessHashSize_;	/* a power of two */
+	Segment *segPool_;
+	Segment *alloc_seg();
+	void free_seg(Segment *seg);
+	void seg_append(Segment *seg);
+	void seg_remove(Segment *seg);
+	Segment *find_seg(int sessionSeqno);
+	void rehash_segs(int size);
 	double lastackTS_;
 	/*
 	 * State encompassing the round-trip-time estimate.
@@ -125,7 +148,6 @@ class CorresHost : public slink, public TcpFsAgent {
 
 	/* possible candidates for rxmission */
 	Segment *curArray_[MAX_PARALLEL_CONN]; 
-	Segment *prevArray_[MAX_PARALLEL_CONN]; /* prev segs */
 	/* variables for fast start */
 	class IntTcpAgent *connWithPktBeforeFS_;
 	
@@ -104,20 +104,68 @@ struct cc_param_list* find_param_by_proto_name(const char* proto, const char* na
 		q->type = NULL;
 		q->description = NULL;
 		q->ptr = NULL;
+		q->slot = -1;
 		q->next = p->param_head;
 		p->param_head = q;
 	};
 	return q;
 };
-void record_linux_param(const char* proto, const char* name, const char* type, void* ptr) {
-	struct cc_param_list* p = find_param_by_proto_name(proto, name);
+/* the global value of each slot of the parameter blocks */
+static int** param_addr = NULL;
+static int param_count = 0;
+
+int linux_param_count(void) {
+	return param_count;
+};
+int* linux_param_addr(int slot) {
+	return param_addr[slot];
+};
+
+/* returns the slot of the parameter */
+int record_linux_param(const char* proto, const char* name, const char* type, void* ptr) {
+	struct cc_param_list* p = cc_list_frozen ? NULL : find_param_by_proto_name(proto, name);
 	if (p) {
 		p->type = type;
 		p->ptr = ptr;
+		if (p->slot < 0) {
+			param_addr = (int**) realloc(param_addr, sizeof(int*) * (param_count + 1));
+			p->slot = param_count++;
+		};
+		param_addr[p->slot] = (int*)ptr;
 		//printf("%s %s %s %p\n", proto, name, type, ptr);
+		return p->slot;
 	} else {
 		printf("failed to register a parameter: %s %s %s %p\n", proto, name, type, ptr);
+		return -1;
+	};
+};
+/* the registered congestion control algorithm called name, or NULL */
+struct tcp_congestion_ops* find_ca_by_name(const char* name) {
+	struct tcp_congestion_ops *e;
+	if (strcmp(name, tcp_reno.name) == 0) return &tcp_reno;
+	list_for_each_entry_rcu(e, &ns_tcp_cong_list, list) {
+		if (strcmp(name, e->name) == 0) return e;
 	};
+	return NULL;
+};
+/* the slot of parameter name of proto, or -1; unlike find_param_by_proto_name, this never adds to the lists */
+static int lookup_param_slot(const char* proto, const char* name) {
+	struct cc_list* p = cc_list_head;
+	struct cc_param_list* q;
+	while (p!=NULL && (strcmp(p->proto, proto)!=0)) p=p->next;
+	if (!p) return -1;
+	q = p->param_head;
+	while (q!=NULL && (strcmp(q->name, name)!=0)) q=q->next;
+	return q ? q->slot : -1;
+};
+/* the slot of parameter name of algorithm ca, or of the shim (e.g. tcp_max_burst); -1 if none */
+int find_param_slot(const char* ca, const char* name) {
+	char proto[100];
+	int slot;
+	snprintf(proto, 100, "tcp_%s.c", ca);
+	slot = lookup_param_slot(proto, name);
+	if (slot < 0) slot = lookup_param_slot(NS_LINUX_PARAM_PROTOCOL, name);
+	return slot;
 };
 void record_linux_param_description(const char* proto, const char* name, const char* exp) {
 	struct cc_param_list* p = find_param_by_proto_name(proto, name);
@@ -51,7 +51,7 @@ typedef int (*registerFunctionPointer)(void);
 // for new source codes that defines NS_PROTOCOL, we support module parameters
 // set the file name of last_added file
 extern void set_linux_file_name(const char*);
-extern void record_linux_param(const char*, const char*, const char*, void*);
+extern int record_linux_param(const char*, const char*, const char*, void*);
 extern void record_linux_param_description(const char*, const char*, const char*);
 #define module_init(x) \
 	static void module_register(void) __attribute__((constructor));\
@@ -66,9 +66,14 @@ extern void record_linux_param_description(const char*, const char*, const char*
 		if (0) x();\
 	};
 
+// name##_param_slot is the slot of the parameter in the parameter blocks
+#ifndef NS_PARAM_SLOT
+#define NS_PARAM_SLOT static int
+#endif
 #define module_param(name, type, mode) \
+	NS_PARAM_SLOT name##_param_slot = -1;\
 	static void module_param_##name(void) __attribute__((constructor));\
-	static void module_param_##name(void) { record_linux_param(NS_PROTOCOL, #name, #type, &name); };
+	static void module_param_##name(void) { name##_param_slot = record_linux_param(NS_PROTOCOL, #name, #type, &name); };
 
 #define MODULE_PARM_DESC(name, exp) \
 	static void module_param_desc_##name(void) __attribute__((constructor));\
@@ -110,7 +115,7 @@ extern void record_linux_param_description(const char*, const char*, const char*
 #define ENOMEM 5
 #define EPERM 6
 #define BUG_ON(x) 
-#define BUILD_BUG_ON(x)
+#define BUILD_BUG_ON(x) ((void)sizeof(char[1 - 2*!!(x)]))
 #define WARN_ON(x)
 //please make sure the system can run
 
@@ -0,0 +1,252 @@
+/*
+ * TCP-Linux module for NS2
+ *
+ * Module: linux/ns-linux-param-bench.c
+ *      A standalone benchmark of the per-flow module parameters, without NS2.
+ *
+ *	Many flows of one congestion control module, each with its own values
+ *	of some of the module parameters (as set by set_ca_param), take ACKs in
+ *	turn.  Every ACK makes the calls LinuxTcpAgent::recv makes (pkts_acked,
+ *	cong_avoid, and ssthresh on a loss), in two ways:
+ *		block	tcp_sock.params points to the parameter block of the
+ *			flow, as LinuxTcpAgent does now;
+ *		swap	the local values are swapped into the module globals
+ *			before the calls and swapped back after them, walking a
+ *			list per flow, as the ParamList of LinuxTcpAgent did.
+ *	Both must end with the same windows; the ACKs per second of each are
+ *	reported.
+ *
+ *	Build:  cc -O2 -o ns-linux-param-bench ns-linux-param-bench.c ns-linux-c.c \
+ *		    ns-linux-param.c ns-linux-stats.c ns-linux-trace.c \
+ *		    ns-linux-util.cc tcp_naivereno.c src/tcp_*.c -lm
+ *	Usage:  ns-linux-param-bench [-f flows] [-a acks] [-l loss-interval]
+ *		    cc param=value...
+ *
+ *	Every flow sets all the given params.  -a is the number of ACKs per
+ *	flow, and every flow sees a loss each loss-interval ACKs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ns-linux-util.h"
+
+#define BENCH_MSS 1460
+#define BENCH_RTT 0.1		/* seconds */
+#define BENCH_MAX_PARAMS 16
+
+/* one local value of the old per-flow list */
+struct param_node {
+	int* addr;
+	int value;
+	int default_value;
+	struct param_node* next;
+};
+
+struct flow {
+	struct tcp_sock tp;
+	int** block;
+	int* local;
+	struct param_node* head;
+};
+
+static int nparams;
+static int slot[BENCH_MAX_PARAMS];
+static int value[BENCH_MAX_PARAMS];
+
+/* ParamList::load_local */
+static void load_local(struct flow* f)
+{
+	struct param_node* p;
+
+	for (p = f->head; p; p = p->next) {
+		p->default_value = *(p->addr);
+		*(p->addr) = p->value;
+	}
+}
+
+/* ParamList::restore_default */
+static void restore_default(struct flow* f)
+{
+	struct param_node* p;
+
+	for (p = f->head; p; p = p->next) {
+		p->value = *(p->addr);
+		*(p->addr) = p->default_value;
+	}
+}
+
+static void init_flow(struct flow* f, struct tcp_congestion_ops* ops, int swap)
+{
+	struct tcp_sock* tp = &f->tp;
+	int i, n = linux_param_count();
+
+	memset(f, 0, sizeof(*f));
+	tp->snd_cwnd = 2;
+	tp->snd_cwnd_clamp = 65535;
+	tp->snd_ssthresh = tp->snd_cwnd_clamp;
+	tp->mss_cache = BENCH_MSS;
+	tp->icsk_ca_state = TCP_CA_Open;
+	tp->icsk_ca_ops = ops;
+	if (swap) {
+		for (i = 0; i < nparams; i++) {
+			struct param_node* p = (struct param_node*) malloc(sizeof(*p));
+			p->addr = linux_param_addr(slot[i]);
+			p->value = value[i];
+			p->default_value = *(p->addr);
+			p->next = f->head;
+			f->head = p;
+		}
+	} else {
+		f->block = (int**) malloc(sizeof(int*) * n);
+		f->local = (int*) malloc(sizeof(int) * n);
+		for (i = 0; i < n; i++)
+			f->block[i] = linux_param_addr(i);
+		for (i = 0; i < nparams; i++) {
+			f->local[slot[i]] = value[i];
+			f->block[slot[i]] = &f->local[slot[i]];
+		}
+		tp->params = f->block;
+	}
+	if (swap)
+		load_local(f);
+	if (ops->init)
+		ops->init(tp);
+	if (swap)
+		restore_default(f);
+}
+
+static void free_flow(struct flow* f)
+{
+	if (f->tp.icsk_ca_ops->release)
+		f->tp.icsk_ca_ops->release(&f->tp);
+	while (f->head) {
+		struct param_node* p = f->head;
+		f->head = p->next;
+		free(p);
+	}
+	free(f->block);
+	free(f->local);
+}
+
+/* the ACK k of flow f */
+static inline void ack(struct flow* f, int k, int loss_interval, int swap)
+{
+	struct tcp_sock* tp = &f->tp;
+	struct tcp_congestion_ops* ops = tp->icsk_ca_ops;
+	double now = k * BENCH_RTT / 10;
+
+	if (swap)
+		load_local(f);
+	tcp_time_stamp = (unsigned long) (now * JIFFY_RATIO);
+	ktime_get_real = (s64) (now * 1000000000);
+	tp->current_time = now;
+	tp->snd_una = k * tp->mss_cache;
+	tp->snd_nxt = (k + tp->snd_cwnd) * tp->mss_cache;
+	tp->srtt = (u32) (BENCH_RTT * JIFFY_RATIO) << 3;
+	tp->rx_opt.rcv_tsecr = (u32) ((now - BENCH_RTT) * JIFFY_RATIO);
+	tp->rx_opt.saw_tstamp = 1;
+	if (ops->pkts_acked)
+		ops->pkts_acked(tp, 1, (s64) ((now - BENCH_RTT) * 1000000000));
+	if (k % loss_interval == 0) {
+		tp->snd_ssthresh = ops->ssthresh(tp);
+		tp->snd_cwnd = tp->snd_ssthresh;
+		tp->bytes_acked = 0;
+	} else {
+		tp->bytes_acked += tp->mss_cache;
+		ops->cong_avoid(tp, tp->snd_una, (u32) (BENCH_RTT * JIFFY_RATIO), tp->snd_cwnd, 1);
+	}
+	if (swap)
+		restore_default(f);
+}
+
+/* runs all the flows, returns the seconds taken and the sum of the windows */
+static double run(struct tcp_congestion_ops* ops, int nflows, int acks,
+		  int loss_interval, int swap, unsigned long* sum)
+{
+	struct flow* f = (struct flow*) malloc(sizeof(struct flow) * nflows);
+	struct timespec t0, t1;
+	int i, k;
+
+	/* the modules read the clock in init */
+	tcp_time_stamp = 0;
+	ktime_get_real = 0;
+	for (i = 0; i < nflows; i++)
+		init_flow(&f[i], ops, swap);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (k = 1; k <= acks; k++)
+		for (i = 0; i < nflows; i++)
+			ack(&f[i], k, loss_interval, swap);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	*sum = 0;
+	for (i = 0; i < nflows; i++) {
+		*sum += f[i].tp.snd_cwnd;
+		free_flow(&f[i]);
+	}
+	free(f);
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+static void usage(const char* prog)
+{
+	fprintf(stderr, "Usage: %s [-f flows] [-a acks] [-l loss-interval] cc param=value...\n", prog);
+	exit(1);
+}
+
+int main(int argc, char** argv)
+{
+	struct tcp_congestion_ops* ops;
+	const char* ca;
+	int nflows = 1000, acks = 20000, loss_interval = 500;
+	unsigned long sum_block, sum_swap;
+	double t_block, t_swap, total;
+	int i;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+			nflows = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+			acks = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+			loss_interval = atoi(argv[++i]);
+		else
+			usage(argv[0]);
+	}
+	if (i == argc || nflows < 1 || acks < 1 || loss_interval < 1)
+		usage(argv[0]);
+	ca = argv[i++];
+
+	/* the modules are all registered: the registry is read-only from now on */
+	cc_list_frozen = 1;
+	ops = find_ca_by_name(ca);
+	if (!ops) {
+		fprintf(stderr, "Error: do not find %s as a congestion control algorithm\n", ca);
+		return 1;
+	}
+	for (; i < argc; i++) {
+		char* eq = strchr(argv[i], '=');
+		if (!eq || nparams == BENCH_MAX_PARAMS)
+			usage(argv[0]);
+		*eq = 0;
+		slot[nparams] = find_param_slot(ca, argv[i]);
+		if (slot[nparams] < 0) {
+			fprintf(stderr, "Error: do not find %s as a parameter for congestion control algorithm %s\n", argv[i], ca);
+			return 1;
+		}
+		value[nparams++] = atoi(eq + 1);
+	}
+
+	t_swap = run(ops, nflows, acks, loss_interval, 1, &sum_swap);
+	t_block = run(ops, nflows, acks, loss_interval, 0, &sum_block);
+	total = (double)nflows * acks;
+	printf("%s, %d flows, %d local params, %.0f ACKs\n", ca, nflows, nparams, total);
+	printf("swap:  %.3f s, %.0f ACKs/s, %.1f ns/ACK\n", t_swap, total / t_swap, t_swap * 1e9 / total);
+	printf("block: %.3f s, %.0f ACKs/s, %.1f ns/ACK\n", t_block, total / t_block, t_block * 1e9 / total);
+	printf("speedup %.2f\n", t_swap / t_block);
+	if (sum_swap != sum_block) {
+		fprintf(stderr, "Error: the windows differ (%lu with swap, %lu with block)\n", sum_swap, sum_block);
+		return 2;
+	}
+	return 0;
+}
@@ -15,17 +15,18 @@
  * See a mini-tutorial about TCP-Linux at: http://netlab.caltech.edu/projects/ns2tcplinux/
  *
  */
-#define NS_PROTOCOL "tcp_linux.c"
+#define NS_PROTOCOL NS_LINUX_PARAM_PROTOCOL
+#define NS_PARAM_SLOT int	/* the slots are used outside of this file */
 #include "ns-linux-c.h"
-unsigned char sysctl_tcp_abc=1;
+int sysctl_tcp_abc=1;
 module_param(sysctl_tcp_abc, int, 0644);
 MODULE_PARM_DESC(sysctl_tcp_abc, "whether we needs ABC or not");
 
-unsigned char tcp_max_burst=3;
+int tcp_max_burst=3;
 module_param(tcp_max_burst, int, 0644);
 MODULE_PARM_DESC(tcp_max_burst, "the maximum burst size of a TCP");
 
-unsigned char debug_level=1;
+int debug_level=1;
 module_param(debug_level, int, 0644);
 MODULE_PARM_DESC(debug_level, "The debug level: 0: INFO; <=1: NOTICE; <=2: ERROR");
 
@@ -19,8 +19,33 @@
 #define NS_LINUX_PARAM_H
 
 
-extern unsigned char sysctl_tcp_abc;
-extern unsigned char tcp_max_burst;
-extern unsigned char debug_level;
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the module the parameters below are registered for (set_ca_param linux ...) */
+#define NS_LINUX_PARAM_PROTOCOL "tcp_linux.c"
+
+extern int sysctl_tcp_abc;
+extern int tcp_max_burst;
+extern int debug_level;
+
+/* slots of the parameters above in the parameter blocks */
+extern int sysctl_tcp_abc_param_slot;
+extern int tcp_max_burst_param_slot;
+
+/*
+ * Every module parameter gets a slot when it is registered (see
+ * module_param() in ns-linux-c.h).  A TCP may carry its own parameter
+ * block in tcp_sock.params, where params[slot] points either to the
+ * global value of the parameter (the default) or to the value local
+ * to this TCP.  Modules read their parameters through param_sk().
+ */
+extern int linux_param_count(void);
+extern int* linux_param_addr(int slot);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
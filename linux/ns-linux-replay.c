@@ -0,0 +1,430 @@
+/*
+ * TCP-Linux module for NS2
+ *
+ * Module: linux/ns-linux-replay.c
+ *      A standalone driver that replays the ACKs of TCP-Linux binary traces
+ *	(see ns-linux-trace.h) into a congestion control module, without NS2.
+ *
+ *	The ACK records of a trace are fed to the module through a tcp_sock,
+ *	with the calls LinuxTcpAgent::recv makes: the ACK clock estimator,
+ *	pkts_acked, cwnd_event and cong_avoid.  Three duplicate ACKs start a
+ *	fast recovery (ssthresh), which ends when the ACKs pass the data sent
+ *	before it.  The window the module computes does not change the ACKs,
+ *	which come from the trace.
+ *
+ *	The packets the traced sender sent are rebuilt from the ACK records:
+ *	the cwnd of a record is the window after the previous ACK, so the
+ *	sender had sent up to that ACK plus cwnd.  Once the module sets
+ *	sod_start, these packets and one retransmission per fast recovery are
+ *	counted in sod_diff, as LinuxTcpAgent::send_much does.  A SOD record
+ *	(written by TCP-SOD in the traced run) resets sod_diff to the count
+ *	of the traced sender.
+ *
+ *	Every pair of a parameter set and a trace is one replay; the replays
+ *	are run on several threads (see ns-linux-sweep.c).
+ *
+ *	Build:  cc -O2 -pthread -o ns-linux-replay ns-linux-replay.c ns-linux-c.c \
+ *		    ns-linux-param.c ns-linux-stats.c ns-linux-trace.c \
+ *		    ns-linux-util.cc tcp_naivereno.c src/tcp_*.c -lm
+ *	Usage:  ns-linux-replay [-j threads] [-o dir] [-p param=value[,param=value...]]...
+ *		    [-w history] [-m mss] cc trace-file...
+ *
+ *	Every -p gives one parameter set of cc (as in set_ca_param); without -p,
+ *	the defaults are used.  With -o, the cwnd trajectory of each replay is
+ *	written to dir/<trace>.<set>.csv, one line per change of cwnd or ssthresh.
+ *	-w is the size of the ACK inter-arrival history (0 turns the ACK clock
+ *	estimator off).  A summary line per replay is printed on stdout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "ns-linux-util.h"
+
+#define REPLAY_MAX_PARAMS 8
+#define REPLAY_DUPACKS 3
+#define REPLAY_BATCH 4096	/* records read at a time */
+
+struct param_set {
+	const char* spec;
+	int nparams;
+	int slot[REPLAY_MAX_PARAMS];
+	int value[REPLAY_MAX_PARAMS];
+};
+
+struct replay {
+	const char* path;
+	int set;		/* index of the parameter set */
+
+	/* results */
+	int error;
+	unsigned long acks;
+	unsigned long cuts;	/* fast recoveries */
+	unsigned int cwnd;	/* at the end of the trace */
+	double avg_cwnd;	/* time average */
+	double secs;		/* wall-clock time of the replay */
+};
+
+struct replay_sweep {
+	struct tcp_congestion_ops* ops;
+	struct param_set* sets;
+	struct replay* r;
+	int n;
+	int next;		/* next replay to run */
+	const char* outdir;
+	int history;
+	int mss;
+};
+
+static int parse_set(struct param_set* p, const char* ca, const char* spec)
+{
+	char* buf = strdup(spec);
+	char* tok;
+
+	memset(p, 0, sizeof(*p));
+	p->spec = spec;
+	for (tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+		char* eq = strchr(tok, '=');
+		if (!eq || p->nparams == REPLAY_MAX_PARAMS)
+			break;
+		*eq = 0;
+		p->slot[p->nparams] = find_param_slot(ca, tok);
+		if (p->slot[p->nparams] < 0) {
+			fprintf(stderr, "Error: do not find %s as a parameter for congestion control algorithm %s\n", tok, ca);
+			break;
+		}
+		p->value[p->nparams++] = atoi(eq + 1);
+	}
+	free(buf);
+	return tok ? -1 : 0;
+}
+
+static FILE* open_trace(const char* path)
+{
+	struct ns_linux_trace_hdr hdr;
+	FILE* fp = fopen(path, "rb");
+
+	if (!fp) {
+		fprintf(stderr, "Error: cannot open %s\n", path);
+		return NULL;
+	}
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    memcmp(hdr.magic, NS_LINUX_TRACE_MAGIC, sizeof(hdr.magic)) != 0 ||
+	    hdr.version != NS_LINUX_TRACE_VERSION ||
+	    hdr.rec_size != sizeof(struct ns_linux_trace_rec)) {
+		fprintf(stderr, "Error: %s is not a TCP-Linux trace of version %u\n",
+			path, NS_LINUX_TRACE_VERSION);
+		fclose(fp);
+		return NULL;
+	}
+	return fp;
+}
+
+static FILE* open_output(const struct replay_sweep* w, const struct replay* r)
+{
+	const char* base = strrchr(r->path, '/');
+	char path[1024];
+	FILE* out;
+
+	snprintf(path, sizeof(path), "%s/%s.%d.csv", w->outdir,
+		 base ? base + 1 : r->path, r->set);
+	out = fopen(path, "w");
+	if (!out)
+		fprintf(stderr, "Error: cannot open %s\n", path);
+	else
+		fprintf(out, "now,ack,cwnd,ssthresh,trace_cwnd\n");
+	return out;
+}
+
+static void set_ca_state(struct tcp_sock* tp, u8 state)
+{
+	if (tp->icsk_ca_ops->set_state)
+		tp->icsk_ca_ops->set_state(tp, state);
+	tp->icsk_ca_state = state;
+}
+
+/* the ACK clock estimator of LinuxTcpAgent::recv */
+static void ack_clock(struct tcp_sock* tp, const struct ns_linux_trace_ack* a)
+{
+	if (tp->prev_ts != 0) {
+		win_var_put(&tp->td_i, a->now - tp->prev_ts);
+		win_var_put(&tp->td_i_ts, (a->ts > tp->prev_rcv_ts ? a->ts - tp->prev_rcv_ts : 0));
+		tp->clock_rate = win_var_sum(&tp->td_i) / win_var_sum(&tp->td_i_ts);
+		tp->ack_var = win_var_sum(&tp->td_i) - win_var_sum(&tp->td_i_ts);
+		tp->prev_rcv_ts = (a->ts > tp->prev_rcv_ts ? a->ts : tp->prev_rcv_ts);
+	} else {
+		tp->prev_rcv_ts = a->ts;
+		tp->clock_rate = 1;
+	}
+	tp->prev_ts = a->now;
+}
+
+static void run_replay(struct replay_sweep* w, struct replay* r)
+{
+	struct ns_linux_trace_rec* recs;
+	struct tcp_sock tcp, *tp = &tcp;
+	struct tcp_congestion_ops* ops = w->ops;
+	const struct param_set* p = &w->sets[r->set];
+	int** block = NULL;
+	int* local = NULL;
+	FILE* fp;
+	FILE* out = NULL;
+	struct timespec t0, t1;
+	unsigned int snd_una = 0, recover = 0, last_cwnd = 0, last_ssthresh = 0;
+	unsigned int sent = 0;	/* highest packet sent by the traced sender */
+	int dupacks = 0, started = 0;
+	double start = 0, last = 0, cwnd_time = 0;
+	size_t n, i;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	fp = open_trace(r->path);
+	if (!fp) {
+		r->error = 1;
+		return;
+	}
+	if (w->outdir && !(out = open_output(w, r))) {
+		fclose(fp);
+		r->error = 1;
+		return;
+	}
+	recs = (struct ns_linux_trace_rec*) malloc(sizeof(*recs) * REPLAY_BATCH);
+
+	memset(tp, 0, sizeof(*tp));
+	tp->snd_cwnd = 2;
+	tp->snd_cwnd_clamp = 65535;
+	tp->snd_ssthresh = tp->snd_cwnd_clamp;
+	tp->mss_cache = w->mss;
+	tp->icsk_ca_state = TCP_CA_Open;
+	tp->icsk_ca_ops = ops;
+	if (w->history > 0) {
+		win_var_init(&tp->td_i, w->history);
+		win_var_init(&tp->td_i_ts, w->history);
+	}
+	if (p->nparams) {
+		int count = linux_param_count();
+		block = (int**) malloc(sizeof(int*) * count);
+		local = (int*) malloc(sizeof(int) * count);
+		for (i = 0; i < (size_t)count; i++)
+			block[i] = linux_param_addr(i);
+		for (i = 0; i < (size_t)p->nparams; i++) {
+			local[p->slot[i]] = p->value[i];
+			block[p->slot[i]] = &local[p->slot[i]];
+		}
+		tp->params = block;
+	}
+
+	while ((n = fread(recs, sizeof(*recs), REPLAY_BATCH, fp)) > 0) {
+		for (i = 0; i < n; i++) {
+			const struct ns_linux_trace_ack* a = &recs[i].u.ack;
+
+			if (recs[i].type == NS_LINUX_TRACE_SOD) {
+				/* the count of the traced sender, after the last ACK */
+				if (tp->sod_start)
+					tp->sod_diff = recs[i].u.sod.sod_diff;
+				continue;
+			}
+			if (recs[i].type != NS_LINUX_TRACE_ACK)
+				continue;
+			tcp_time_stamp = (unsigned long) (a->now * JIFFY_RATIO);
+			ktime_get_real = (s64) (a->now * 1000000000);
+			tp->current_time = a->now;
+			if (!started) {
+				started = 1;
+				start = last = a->now;
+				snd_una = a->ack;
+				sent = snd_una + a->cwnd;
+				if (ops->init)
+					ops->init(tp);
+			}
+			if (snd_una + a->cwnd > sent) {
+				if (tp->sod_start)
+					tp->sod_diff += snd_una + a->cwnd - sent;
+				sent = snd_una + a->cwnd;
+			}
+			cwnd_time += tp->snd_cwnd * (a->now - last);
+			last = a->now;
+			r->acks++;
+			if (w->history > 0)
+				ack_clock(tp, a);
+
+			tp->rx_opt.rcv_tsval = (u32) (a->ts * JIFFY_RATIO);
+			tp->rx_opt.rcv_tsecr = (u32) (a->ts_echo * JIFFY_RATIO);
+			tp->rx_opt.saw_tstamp = 1;
+			if (a->t_rtt > 0)
+				tp->srtt = tp->srtt ? tp->srtt - (tp->srtt >> 3) + a->t_rtt : a->t_rtt << 3;
+
+			if (a->ack > snd_una) {
+				u32 acked = a->ack - snd_una;
+
+				snd_una = a->ack;
+				dupacks = 0;
+				tp->snd_una = snd_una * tp->mss_cache;
+				tp->snd_nxt = (snd_una + tp->snd_cwnd) * tp->mss_cache;
+				tp->bytes_acked += acked * tp->mss_cache;
+				if (ops->pkts_acked)
+					ops->pkts_acked(tp, acked, (s64) (a->ts_echo * 1000000000));
+				if (tp->icsk_ca_state != TCP_CA_Open && snd_una >= recover) {
+					if (tp->snd_cwnd < tp->snd_ssthresh)
+						tp->snd_cwnd = tp->snd_ssthresh;
+					set_ca_state(tp, TCP_CA_Open);
+				}
+				if (ops->cwnd_event)
+					ops->cwnd_event(tp, tp->icsk_ca_state == TCP_CA_Open ?
+							CA_EVENT_FAST_ACK : CA_EVENT_SLOW_ACK);
+				if (tp->icsk_ca_state == TCP_CA_Open) {
+					/* the window is refilled on every ACK */
+					ops->cong_avoid(tp, snd_una * tp->mss_cache, a->t_rtt,
+							tp->snd_cwnd, 1);
+					tp->snd_cwnd_stamp = tcp_time_stamp;
+				}
+			} else if (a->ack == snd_una &&
+				   ++dupacks == REPLAY_DUPACKS &&
+				   tp->icsk_ca_state == TCP_CA_Open) {
+				recover = snd_una + tp->snd_cwnd;
+				tp->snd_ssthresh = ops->ssthresh(tp);
+				tp->snd_cwnd_cnt = 0;
+				tp->bytes_acked = 0;
+				if (ops->min_cwnd)
+					tp->snd_cwnd = ops->min_cwnd(tp);
+				else
+					tp->snd_cwnd = tp->snd_ssthresh;
+				if (tp->snd_cwnd < 1)
+					tp->snd_cwnd = 1;
+				set_ca_state(tp, TCP_CA_Recovery);
+				if (tp->sod_start)
+					tp->sod_diff++;	/* the retransmission */
+				r->cuts++;
+			}
+
+			if (out && (tp->snd_cwnd != last_cwnd || tp->snd_ssthresh != last_ssthresh)) {
+				fprintf(out, "%.9f,%u,%lu,%lu,%u\n", a->now, a->ack,
+					tp->snd_cwnd, tp->snd_ssthresh, a->cwnd);
+				last_cwnd = tp->snd_cwnd;
+				last_ssthresh = tp->snd_ssthresh;
+			}
+		}
+	}
+
+	r->cwnd = tp->snd_cwnd;
+	r->avg_cwnd = last > start ? cwnd_time / (last - start) : tp->snd_cwnd;
+	if (started && ops->release)
+		ops->release(tp);
+	win_var_free(&tp->td_i);
+	win_var_free(&tp->td_i_ts);
+	free(block);
+	free(local);
+	free(recs);
+	if (out)
+		fclose(out);
+	fclose(fp);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	r->secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+static void* replay_thread(void* arg)
+{
+	struct replay_sweep* w = (struct replay_sweep*) arg;
+	int i;
+
+	while ((i = __sync_fetch_and_add(&w->next, 1)) < w->n)
+		run_replay(w, &w->r[i]);
+	return NULL;
+}
+
+static void usage(const char* prog)
+{
+	fprintf(stderr, "Usage: %s [-j threads] [-o dir] [-p param=value[,param=value...]]... [-w history] [-m mss] cc trace-file...\n", prog);
+	exit(1);
+}
+
+int main(int argc, char** argv)
+{
+	struct replay_sweep w;
+	const char** specs;
+	const char* ca = NULL;
+	int nspecs = 0, nthreads = 1, ntraces, error = 0;
+	unsigned long acks = 0;
+	pthread_t* tid;
+	struct timespec t0, t1;
+	double secs;
+	int i, j;
+
+	memset(&w, 0, sizeof(w));
+	w.history = TD_DEFAULT_CAPACITY;
+	w.mss = 1000;
+	specs = (const char**) malloc(sizeof(char*) * argc);
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (i + 1 == argc)
+			usage(argv[0]);
+		if (strcmp(argv[i], "-j") == 0)
+			nthreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-o") == 0)
+			w.outdir = argv[++i];
+		else if (strcmp(argv[i], "-p") == 0)
+			specs[nspecs++] = argv[++i];
+		else if (strcmp(argv[i], "-w") == 0)
+			w.history = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-m") == 0)
+			w.mss = atoi(argv[++i]);
+		else
+			usage(argv[0]);
+	}
+	if (i + 2 > argc || nthreads < 1 || w.mss < 1)
+		usage(argv[0]);
+	ca = argv[i++];
+	ntraces = argc - i;
+
+	/* the modules are all registered: the registry is read-only from now on */
+	cc_list_frozen = 1;
+	w.ops = find_ca_by_name(ca);
+	if (!w.ops) {
+		fprintf(stderr, "Error: do not find %s as a congestion control algorithm\n", ca);
+		return 1;
+	}
+	if (nspecs == 0)
+		specs[nspecs++] = "";
+	w.sets = (struct param_set*) malloc(sizeof(struct param_set) * nspecs);
+	for (j = 0; j < nspecs; j++) {
+		if (parse_set(&w.sets[j], ca, specs[j]) < 0) {
+			fprintf(stderr, "Error: bad parameter set: %s\n", specs[j]);
+			return 1;
+		}
+	}
+	w.n = nspecs * ntraces;
+	w.r = (struct replay*) calloc(w.n, sizeof(struct replay));
+	for (j = 0; j < nspecs; j++) {
+		int k;
+		for (k = 0; k < ntraces; k++) {
+			w.r[j * ntraces + k].path = argv[i + k];
+			w.r[j * ntraces + k].set = j;
+		}
+	}
+
+	tid = (pthread_t*) malloc(sizeof(pthread_t) * nthreads);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (j = 0; j < nthreads; j++)
+		pthread_create(&tid[j], NULL, replay_thread, &w);
+	for (j = 0; j < nthreads; j++)
+		pthread_join(tid[j], NULL);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+	printf("# trace,set,params,acks,fast_recoveries,cwnd,avg_cwnd,acks_per_sec\n");
+	for (j = 0; j < w.n; j++) {
+		struct replay* r = &w.r[j];
+		if (r->error) {
+			error = 1;
+			continue;
+		}
+		acks += r->acks;
+		printf("%s,%d,%s,%lu,%lu,%u,%.3f,%.0f\n", r->path, r->set,
+		       w.sets[r->set].spec, r->acks, r->cuts, r->cwnd, r->avg_cwnd,
+		       r->secs > 0 ? r->acks / r->secs : 0);
+	}
+	fprintf(stderr, "%d replays, %lu ACKs: %.3f s on %d threads, %.0f ACKs/s\n",
+		w.n, acks, secs, nthreads, secs > 0 ? acks / secs : 0);
+	free(tid);
+	return error;
+}
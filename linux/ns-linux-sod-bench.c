@@ -0,0 +1,304 @@
+/*
+ * TCP-Linux module for NS2
+ *
+ * Module: linux/ns-linux-sod-bench.c
+ *      A standalone micro-benchmark of the bandwidth window of TCP-SOD on
+ *	recorded ACK traces (see ns-linux-trace.h).
+ *
+ *	The ACKs of each trace are fed to two windows, with the calls
+ *	tcp_sod_pkts_acked and tcp_sod_cong_avoid make: one sample per new ACK,
+ *	and an estimate of the bandwidth every update period.  The first window
+ *	is the slideWindow TCP-SOD used before the win_sum ring of
+ *	ns-linux-stats.c, kept here as it was; the second is the win_sum.  The
+ *	estimates of both must be the same, and the time per ACK of each is
+ *	reported.
+ *
+ *	Build:  cc -O2 -o ns-linux-sod-bench ns-linux-sod-bench.c ns-linux-stats.c
+ *	Usage:  ns-linux-sod-bench [-n repeats] [-c capacity] trace-file...
+ *
+ *	Traces can be recorded with ns-linux-sweep -r or open_linux_trace.
+ *	-c is the size of both windows (1024 in TCP-SOD).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "ns-linux-stats.h"
+#include "ns-linux-trace.h"
+
+#define BENCH_UPDATE_PERIOD 0.05	/* sod->update_period */
+#define BENCH_ESTIMATE_PERIOD 0.05	/* sod->estimate_period */
+
+/* the slideWindow of TCP-SOD before win_sum */
+struct Packet
+{
+    double time;
+    int32_t len;
+};
+
+typedef struct
+{
+    struct Packet *window;
+    int32_t _size, capacity;
+    int32_t _total;
+}slideWindow;
+
+static void initSlideWindow(slideWindow *sw, int size)
+{
+    sw->capacity = size;
+    sw->_size = 0;
+    sw->_total = 0;
+    sw->window = (struct Packet *)malloc(sizeof(struct Packet)*size);
+    int i;
+    for (i = 0; i < sw->capacity; i ++)
+    {
+        sw->window[i].time = sw->window[i].len = 0;
+    }
+}
+
+static void delSlideWindow(slideWindow *sw)
+{
+    free(sw->window);
+}
+
+static int isEmpty(slideWindow *sw)
+{
+    if (!sw->_total)
+        return 1;
+    else
+        return 0;
+}
+
+static double timeInterval(slideWindow *sw, double current_time)
+{
+    if (isEmpty(sw))
+        return 0;
+    else
+        return (current_time <= sw->window[0].time ? 0 : current_time - sw->window[0].time);
+}
+
+static void shift(slideWindow *sw)
+{
+    int i = 0;
+    sw->_total -= sw->window[0].len;
+    for (i = 0; i < sw->_size - 1; i ++)
+    {
+        sw->window[i].time = sw->window[i+1].time;
+        sw->window[i].len = sw->window[i+1].len;
+    }
+}
+
+static void timeShift(slideWindow *sw, double current_time, double thresh)
+{
+    while (timeInterval(sw, current_time) > thresh)
+    {
+        shift(sw);
+        sw->_size --;
+
+    }
+}
+
+static void put(slideWindow *sw, double time, int count)
+{
+    if (sw->_size < sw->capacity)
+    {
+        sw->window[sw->_size].time = time;
+        sw->window[sw->_size].len = count;
+        sw->_size ++;
+    }
+    else
+    {
+        shift(sw);
+        sw->window[sw->_size-1].time = time;
+        sw->window[sw->_size-1].len = count;
+    }
+
+    sw->_total += count;
+}
+
+/* the new ACKs of a trace */
+struct acks {
+	double* now;
+	int* cnt;
+	long n;
+	long updates;		/* estimates made */
+	double* bw;		/* the estimates of the slideWindow */
+};
+
+static int read_trace(const char* path, struct acks* a)
+{
+	struct ns_linux_trace_hdr hdr;
+	struct ns_linux_trace_rec rec;
+	long capacity = 0;
+	int first = 1;
+	unsigned int last = 0;
+	FILE* fp = fopen(path, "rb");
+
+	memset(a, 0, sizeof(*a));
+	if (!fp) {
+		fprintf(stderr, "Error: cannot open %s\n", path);
+		return -1;
+	}
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    memcmp(hdr.magic, NS_LINUX_TRACE_MAGIC, sizeof(hdr.magic)) != 0 ||
+	    hdr.version != NS_LINUX_TRACE_VERSION ||
+	    hdr.rec_size != sizeof(struct ns_linux_trace_rec)) {
+		fprintf(stderr, "Error: %s is not a TCP-Linux trace of version %u\n",
+			path, NS_LINUX_TRACE_VERSION);
+		fclose(fp);
+		return -1;
+	}
+	while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+		if (rec.type != NS_LINUX_TRACE_ACK)
+			continue;
+		/* pkts_acked is only called for an ACK of new data */
+		if (!first && (int)(rec.u.ack.ack - last) <= 0)
+			continue;
+		if (a->n == capacity) {
+			capacity = capacity ? 2 * capacity : 4096;
+			a->now = (double*) realloc(a->now, sizeof(double) * capacity);
+			a->cnt = (int*) realloc(a->cnt, sizeof(int) * capacity);
+		}
+		a->now[a->n] = rec.u.ack.now;
+		a->cnt[a->n++] = first ? 1 : (int)(rec.u.ack.ack - last);
+		last = rec.u.ack.ack;
+		first = 0;
+	}
+	fclose(fp);
+	a->bw = (double*) malloc(sizeof(double) * (a->n + 1));
+	return 0;
+}
+
+static double now_secs()
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* the estimate of tcp_sod_cong_avoid */
+static void run_old(struct acks* a, int capacity)
+{
+	slideWindow sw;
+	double start = a->n ? a->now[0] : 0, bw;
+	long i, k = 0;
+
+	initSlideWindow(&sw, capacity);
+	for (i = 0; i < a->n; i++) {
+		double now = a->now[i];
+
+		put(&sw, now, a->cnt[i]);
+		if (now - start < BENCH_UPDATE_PERIOD)
+			continue;
+		if (timeInterval(&sw, now) >= BENCH_ESTIMATE_PERIOD) {
+			bw = sw._total / timeInterval(&sw, now);
+			timeShift(&sw, now, BENCH_ESTIMATE_PERIOD);
+		} else if (!timeInterval(&sw, now))
+			bw = 0;
+		else
+			bw = sw._total / timeInterval(&sw, now);
+		a->bw[k++] = bw;
+		start = now;
+	}
+	a->updates = k;
+	delSlideWindow(&sw);
+}
+
+/* the same with win_sum; returns the number of estimates that differ */
+static long run_new(const struct acks* a, int capacity)
+{
+	struct win_sum w;
+	double start = a->n ? a->now[0] : 0, bw;
+	long i, k = 0, diff = 0;
+
+	win_sum_init(&w, capacity);
+	for (i = 0; i < a->n; i++) {
+		double now = a->now[i];
+
+		win_sum_put(&w, now, a->cnt[i]);
+		if (now - start < BENCH_UPDATE_PERIOD)
+			continue;
+		if (win_sum_interval(&w, now) >= BENCH_ESTIMATE_PERIOD) {
+			bw = win_sum_total(&w) / win_sum_interval(&w, now);
+			win_sum_expire(&w, now, BENCH_ESTIMATE_PERIOD);
+		} else if (!win_sum_interval(&w, now))
+			bw = 0;
+		else
+			bw = win_sum_total(&w) / win_sum_interval(&w, now);
+		if (k >= a->updates || bw != a->bw[k])
+			diff++;
+		k++;
+		start = now;
+	}
+	if (k != a->updates)
+		diff++;
+	win_sum_free(&w);
+	return diff;
+}
+
+static void usage(const char* prog)
+{
+	fprintf(stderr, "Usage: %s [-n repeats] [-c capacity] trace-file...\n", prog);
+	exit(1);
+}
+
+int main(int argc, char** argv)
+{
+	int repeats = 10, capacity = 1024;
+	double old_total = 0, new_total = 0;
+	long acks_total = 0, diff_total = 0;
+	int i, r, ntraces = 0;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			repeats = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+			capacity = atoi(argv[++i]);
+		else
+			usage(argv[0]);
+	}
+	if (i == argc || repeats < 1 || capacity < 1)
+		usage(argv[0]);
+
+	printf("# trace,acks,updates,differences,old(ns/ack),new(ns/ack),speedup\n");
+	for (; i < argc; i++) {
+		struct acks a;
+		double t0, t_old, t_new;
+		long diff = 0;
+
+		if (read_trace(argv[i], &a) < 0)
+			return 1;
+		if (a.n == 0)
+			continue;
+		t0 = now_secs();
+		for (r = 0; r < repeats; r++)
+			run_old(&a, capacity);
+		t_old = now_secs() - t0;
+		t0 = now_secs();
+		for (r = 0; r < repeats; r++)
+			diff += run_new(&a, capacity);
+		t_new = now_secs() - t0;
+		diff /= repeats;
+		printf("%s,%ld,%ld,%ld,%.1f,%.1f,%.2f\n", argv[i], a.n, a.updates, diff,
+		       t_old * 1e9 / (a.n * (double)repeats), t_new * 1e9 / (a.n * (double)repeats),
+		       t_new > 0 ? t_old / t_new : 0);
+		old_total += t_old;
+		new_total += t_new;
+		acks_total += a.n;
+		diff_total += diff;
+		ntraces++;
+		free(a.now);
+		free(a.cnt);
+		free(a.bw);
+	}
+	if (ntraces > 0)
+		fprintf(stderr, "%d traces, %ld ACKs, %ld different estimates: %.1f ns/ACK before, %.1f ns/ACK after, speedup %.2f\n",
+			ntraces, acks_total, diff_total,
+			old_total * 1e9 / (acks_total * (double)repeats),
+			new_total * 1e9 / (acks_total * (double)repeats),
+			new_total > 0 ? old_total / new_total : 0);
+	return diff_total ? 2 : 0;
+}
@@ -0,0 +1,200 @@
+/*
+ * TCP-Linux module for NS2
+ *
+ * Module: linux/ns-linux-stats.c
+ *      This is the streaming estimators shared by the congestion control modules.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ns-linux-stats.h"
+
+#define RING_NEXT(i, cap) ((i) + 1 == (cap) ? 0 : (i) + 1)
+#define RING_PREV(i, cap) ((i) == 0 ? (cap) - 1 : (i) - 1)
+
+/////////////// win_sum ///////////////
+int win_sum_init(struct win_sum *w, int capacity)
+{
+	w->s = (struct stat_sample *)malloc(sizeof(struct stat_sample) * capacity);
+	if (!w->s)
+		return -1;
+	w->capacity = capacity;
+	win_sum_reset(w);
+	return 0;
+}
+
+void win_sum_free(struct win_sum *w)
+{
+	free(w->s);
+	memset(w, 0, sizeof(*w));
+}
+
+void win_sum_reset(struct win_sum *w)
+{
+	w->head = w->count = 0;
+	w->total = 0;
+}
+
+static inline void win_sum_drop(struct win_sum *w)
+{
+	w->total -= w->s[w->head].v;
+	w->head = RING_NEXT(w->head, w->capacity);
+	w->count--;
+}
+
+void win_sum_put(struct win_sum *w, double t, double v)
+{
+	int tail;
+
+	if (w->count == w->capacity)
+		win_sum_drop(w);
+	tail = w->head + w->count;
+	if (tail >= w->capacity)
+		tail -= w->capacity;
+	w->s[tail].t = t;
+	w->s[tail].v = v;
+	w->count++;
+	w->total += v;
+}
+
+void win_sum_expire(struct win_sum *w, double now, double span)
+{
+	while (w->count > 0 && now - w->s[w->head].t > span)
+		win_sum_drop(w);
+	if (w->count == 0)
+		w->total = 0;	/* no rounding residue */
+}
+
+double win_sum_interval(const struct win_sum *w, double now)
+{
+	double oldest;
+
+	if (w->count == 0)
+		return 0;
+	oldest = w->s[w->head].t;
+	return (now <= oldest ? 0 : now - oldest);
+}
+
+/////////////// win_minmax ///////////////
+int win_minmax_init(struct win_minmax *w, int capacity, double span, int is_max)
+{
+	if (span <= 0)
+		capacity = 1;	/* only the all-time min/max is ever needed */
+	w->s = (struct stat_sample *)malloc(sizeof(struct stat_sample) * capacity);
+	if (!w->s)
+		return -1;
+	w->capacity = capacity;
+	w->head = w->count = 0;
+	w->is_max = is_max;
+	w->span = span;
+	return 0;
+}
+
+void win_minmax_free(struct win_minmax *w)
+{
+	free(w->s);
+	memset(w, 0, sizeof(*w));
+}
+
+/*
+ * Double the deque, with its samples moved to the start of the new buffer.
+ * Every sample in it is still a candidate, so none can be dropped.
+ */
+static int win_minmax_grow(struct win_minmax *w)
+{
+	struct stat_sample *s;
+	int first;
+
+	s = (struct stat_sample *)malloc(sizeof(struct stat_sample) * 2 * w->capacity);
+	if (!s)
+		return -1;
+	first = w->capacity - w->head;
+	if (first > w->count)
+		first = w->count;
+	memcpy(s, w->s + w->head, sizeof(struct stat_sample) * first);
+	memcpy(s + first, w->s, sizeof(struct stat_sample) * (w->count - first));
+	free(w->s);
+	w->s = s;
+	w->head = 0;
+	w->capacity *= 2;
+	return 0;
+}
+
+/* true if a is at least as good a min/max as b */
+#define MINMAX_BETTER(w, a, b) ((w)->is_max ? (a) >= (b) : (a) <= (b))
+
+void win_minmax_put(struct win_minmax *w, double t, double v)
+{
+	int tail;
+
+	/* drop the samples that can no longer be the min/max */
+	while (w->count > 0) {
+		tail = w->head + w->count - 1;
+		if (tail >= w->capacity)
+			tail -= w->capacity;
+		if (!MINMAX_BETTER(w, v, w->s[tail].v))
+			break;
+		w->count--;
+	}
+	if (w->span <= 0) {
+		if (w->count > 0)
+			return;
+	} else {
+		/* expire the samples out of the window */
+		while (w->count > 0 && t - w->s[w->head].t > w->span) {
+			w->head = RING_NEXT(w->head, w->capacity);
+			w->count--;
+		}
+		if (w->count == w->capacity && win_minmax_grow(w) < 0) {
+			/* out of memory: the new sample takes the slot of
+			 * the newest one */
+			w->count--;
+		}
+	}
+	tail = w->head + w->count;
+	if (tail >= w->capacity)
+		tail -= w->capacity;
+	w->s[tail].t = t;
+	w->s[tail].v = v;
+	w->count++;
+}
+
+/////////////// win_var ///////////////
+int win_var_init(struct win_var *w, int capacity)
+{
+	w->v = (double *)malloc(sizeof(double) * capacity);
+	if (!w->v)
+		return -1;
+	w->capacity = capacity;
+	win_var_reset(w);
+	return 0;
+}
+
+void win_var_free(struct win_var *w)
+{
+	free(w->v);
+	memset(w, 0, sizeof(*w));
+}
+
+void win_var_reset(struct win_var *w)
+{
+	w->head = w->count = 0;
+	w->sum = w->sumsq = 0;
+}
+
+void win_var_put(struct win_var *w, double v)
+{
+	if (w->count == w->capacity) {
+		/* v[head] is also the oldest sample */
+		double old = w->v[w->head];
+		w->sum -= old;
+		w->sumsq -= old * old;
+	} else {
+		w->count++;
+	}
+	w->v[w->head] = v;
+	w->sum += v;
+	w->sumsq += v * v;
+	w->head = RING_NEXT(w->head, w->capacity);
+}
@@ -0,0 +1,87 @@
+/*
+ * TCP-Linux module for NS2
+ *
+ * Module: linux/ns-linux-stats.h
+ *      This is the header file of the streaming estimators shared by the
+ *	congestion control modules (kept in their inet_csk_ca state) and by TCP-Linux.
+ *	Every update is O(1) amortized.  The sample buffers are allocated by the
+ *	*_init functions and released by the *_free functions; a zeroed estimator
+ *	is "not initialized".
+ *
+ */
+
+#ifndef NS_LINUX_STATS_H
+#define NS_LINUX_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct stat_sample {
+	double t;
+	double v;
+};
+
+/* Sum of the samples in a time window (e.g. bytes acked in the last period) */
+struct win_sum {
+	struct stat_sample *s;
+	int capacity, head, count;	/* s[head] is the oldest sample */
+	double total;
+};
+
+extern int win_sum_init(struct win_sum *w, int capacity);
+extern void win_sum_free(struct win_sum *w);
+extern void win_sum_reset(struct win_sum *w);
+/* add a sample; the oldest sample is dropped if the window is full */
+extern void win_sum_put(struct win_sum *w, double t, double v);
+/* drop the samples while now - oldest > span */
+extern void win_sum_expire(struct win_sum *w, double now, double span);
+/* now - time of the oldest sample, or 0 if the window is empty */
+extern double win_sum_interval(const struct win_sum *w, double now);
+#define win_sum_total(w) ((w)->total)
+
+
+/* Minimum (or maximum) of the samples in the last `span' seconds, kept in a
+ * monotonic deque.  With span <= 0 the estimator keeps the all-time min/max.
+ * The deque starts with `capacity' slots and grows when a window holds more
+ * candidates than that.
+ */
+struct win_minmax {
+	struct stat_sample *s;
+	int capacity, head, count;	/* s[head] is the current min/max */
+	int is_max;
+	double span;
+};
+
+extern int win_minmax_init(struct win_minmax *w, int capacity, double span, int is_max);
+extern void win_minmax_free(struct win_minmax *w);
+#define win_minmax_reset(w) ((w)->count = 0)
+extern void win_minmax_put(struct win_minmax *w, double t, double v);
+/* current min/max, or dflt if there is no sample */
+#define win_minmax_get(w, dflt) ((w)->count ? (w)->s[(w)->head].v : (dflt))
+
+
+/* Sum, mean and variance of the last `capacity' samples */
+struct win_var {
+	double *v;
+	int capacity, head, count;	/* v[head] is the next slot to fill */
+	double sum, sumsq;
+};
+
+extern int win_var_init(struct win_var *w, int capacity);
+extern void win_var_free(struct win_var *w);
+extern void win_var_reset(struct win_var *w);
+extern void win_var_put(struct win_var *w, double v);
+#define win_var_full(w) ((w)->v && (w)->count == (w)->capacity)
+#define win_var_sum(w) ((w)->sum)
+#define win_var_mean(w) ((w)->count ? (w)->sum / (w)->count : 0)
+/* the sample put `age' samples ago (0 is the latest), age < count */
+#define win_var_at(w, age) \
+	((w)->v[((w)->head + (w)->capacity - 1 - (age)) % (w)->capacity])
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,453 @@
+/*
+ * TCP-Linux module for NS2
+ *
+ * Module: linux/ns-linux-sweep.c
+ *      A standalone driver that runs a parameter sweep of the congestion
+ *	control modules on several threads of one process.
+ *
+ *	Each scenario is a single flow over a single bottleneck, simulated
+ *	round by round (one window per RTT) without NS2: the module sees one
+ *	ACK per delivered packet, with the same calls as in LinuxTcpAgent.
+ *	A scenario has its own tcp_sock and parameter block, and the clock of
+ *	the shim is thread-local, so the scenarios need no locking.
+ *
+ *	Build:  cc -O2 -pthread -o ns-linux-sweep ns-linux-sweep.c ns-linux-c.c \
+ *		    ns-linux-param.c ns-linux-stats.c ns-linux-trace.c \
+ *		    ns-linux-util.cc tcp_naivereno.c src/tcp_*.c -lm
+ *	Usage:  ns-linux-sweep [-j threads] [-n replicas] [-t seconds] [-r dir]
+ *		    scenario-file
+ *
+ *	Each line of the scenario file is
+ *		cc bandwidth(Mbps) rtt(ms) buffer(packets) loss-rate [param=value ...]
+ *	where the params are module parameters of cc (as in set_ca_param).
+ *	Every line is run `replicas' times with different random losses.
+ *	With more than one thread, the sweep is run first on one thread, and
+ *	the speedup is reported on stderr.
+ *
+ *	With -r, the ACKs of scenario i are recorded in the binary trace
+ *	dir/<i>.trace (see ns-linux-trace.h), as LinuxTcpAgent::recv records
+ *	them, for ns-linux-replay and ns-linux-sod-bench.  A round with a loss
+ *	ends with three duplicate ACKs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "ns-linux-util.h"
+#include "ns-linux-trace.h"
+
+#define SWEEP_MSS 1460
+#define SWEEP_MAX_PARAMS 8
+#define SWEEP_LINE_MAX 1024
+#define SWEEP_DUPACKS 3
+
+struct scenario {
+	struct tcp_congestion_ops *ops;
+	double bw;		/* bottleneck capacity, packets per second */
+	double rtt;		/* propagation RTT, seconds */
+	int buffer;		/* bottleneck buffer, packets */
+	double loss;		/* random loss rate */
+	unsigned int seed;
+	int nparams;
+	int slot[SWEEP_MAX_PARAMS];
+	int value[SWEEP_MAX_PARAMS];
+	const char* line;	/* the line of the scenario file */
+	int id;			/* index in the sweep */
+
+	/* results */
+	unsigned long delivered;
+	unsigned long lost;
+	unsigned long cuts;	/* loss events */
+	double avg_cwnd;
+};
+
+struct sweep {
+	struct scenario* s;
+	int n;
+	double duration;
+	const char* tracedir;
+	int next;		/* next scenario to run */
+	double* cpu;		/* CPU time of each thread of the last run */
+};
+
+struct worker {
+	struct sweep* w;
+	int id;
+};
+
+static double thread_cpu_time()
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static int parse_scenario(struct scenario* s, char* line)
+{
+	char cc[TCP_CA_NAME_MAX + 1];
+	double bw, rtt, loss;
+	int buffer, n;
+	char* tok;
+
+	memset(s, 0, sizeof(*s));
+	s->line = strdup(line);
+	if (sscanf(line, "%16s %lf %lf %d %lf%n", cc, &bw, &rtt, &buffer, &loss, &n) < 5)
+		return -1;
+	s->ops = find_ca_by_name(cc);
+	if (!s->ops) {
+		fprintf(stderr, "Error: do not find %s as a congestion control algorithm\n", cc);
+		return -1;
+	}
+	s->bw = bw * 1000000 / (8 * SWEEP_MSS);
+	s->rtt = rtt / 1000;
+	s->buffer = buffer;
+	s->loss = loss;
+	for (tok = strtok(line + n, " \t\n"); tok; tok = strtok(NULL, " \t\n")) {
+		char* eq = strchr(tok, '=');
+		if (!eq || s->nparams == SWEEP_MAX_PARAMS)
+			return -1;
+		*eq = 0;
+		s->slot[s->nparams] = find_param_slot(cc, tok);
+		if (s->slot[s->nparams] < 0) {
+			fprintf(stderr, "Error: do not find %s as a parameter for congestion control algorithm %s\n", tok, cc);
+			return -1;
+		}
+		s->value[s->nparams++] = atoi(eq + 1);
+	}
+	return 0;
+}
+
+static inline void set_clock(struct tcp_sock* tp, double now)
+{
+	tcp_time_stamp = (unsigned long) (now * JIFFY_RATIO);
+	ktime_get_real = (s64) (now * 1000000000);
+	tp->current_time = now;
+}
+
+static void set_ca_state(struct tcp_sock* tp, u8 state)
+{
+	if (tp->icsk_ca_ops->set_state)
+		tp->icsk_ca_ops->set_state(tp, state);
+	tp->icsk_ca_state = state;
+}
+
+static struct ns_linux_trace* open_trace(const char* dir, const struct scenario* s)
+{
+	struct ns_linux_trace* t;
+	char path[1024];
+
+	snprintf(path, sizeof(path), "%s/%d.trace", dir, s->id);
+	t = ns_linux_trace_open(path, 0);
+	if (!t)
+		fprintf(stderr, "Error: cannot open %s as the trace file\n", path);
+	return t;
+}
+
+/* the ACK of a packet sent at `sent', received now */
+static void trace_ack(struct tcp_sock* tp, u32 ack, double sent, double round)
+{
+	struct ns_linux_trace_rec rec;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.type = NS_LINUX_TRACE_ACK;
+	rec.u.ack.ts = sent + round / 2;
+	rec.u.ack.ts_echo = sent;
+	rec.u.ack.now = tp->current_time;
+	rec.u.ack.rtt = tp->current_time - sent;
+	rec.u.ack.seqno = ack;
+	rec.u.ack.ack = ack;
+	rec.u.ack.cwnd = tp->snd_cwnd;
+	rec.u.ack.ssthresh = tp->snd_ssthresh;
+	rec.u.ack.t_rtt = (int) (round * JIFFY_RATIO);
+	ns_linux_trace_write(tp->trace, &rec);
+}
+
+/*
+ * Every round sends a window.  The packets beyond bw*rtt + buffer are
+ * dropped at the bottleneck, the others at random with rate loss; the
+ * delivered ones are ACKed over the round, which lasts rtt plus the
+ * queueing delay.  A round with a loss ends with a window reduction, as
+ * in a fast recovery.
+ *
+ * tp->sod_diff counts the packets sent once sod_start is set, as
+ * LinuxTcpAgent::send_much does.  Each ACK clocks out one packet of the
+ * next round; when that round starts, the count is corrected to the
+ * window it actually sends.
+ */
+static void run_scenario(struct scenario* s, double duration, const char* tracedir)
+{
+	struct tcp_sock tcp, *tp = &tcp;
+	struct tcp_congestion_ops* ops = s->ops;
+	int** block = NULL;
+	int* local = NULL;
+	double now = 0, cwnd_time = 0;
+	unsigned int seed = s->seed;
+	u32 ack = 0;
+	long clocked = 0;	/* packets of the next round counted in sod_diff */
+	int i;
+
+	memset(tp, 0, sizeof(*tp));
+	tp->snd_cwnd = 2;
+	tp->snd_cwnd_clamp = 65535;
+	tp->snd_ssthresh = tp->snd_cwnd_clamp;
+	tp->mss_cache = SWEEP_MSS;
+	tp->icsk_ca_state = TCP_CA_Open;
+	tp->icsk_ca_ops = ops;
+	if (s->nparams) {
+		int n = linux_param_count();
+		block = (int**) malloc(sizeof(int*) * n);
+		local = (int*) malloc(sizeof(int) * n);
+		for (i = 0; i < n; i++)
+			block[i] = linux_param_addr(i);
+		for (i = 0; i < s->nparams; i++) {
+			local[s->slot[i]] = s->value[i];
+			block[s->slot[i]] = &local[s->slot[i]];
+		}
+		tp->params = block;
+	}
+	if (tracedir)
+		tp->trace = open_trace(tracedir, s);
+
+	set_clock(tp, 0);
+	if (ops->init)
+		ops->init(tp);
+	while (now < duration) {
+		u32 cwnd = tp->snd_cwnd;
+		double queue = cwnd - s->bw * s->rtt;
+		double drop, round;
+		unsigned long lost = 0;
+
+		if (queue < 0)
+			queue = 0;
+		drop = queue > s->buffer ? queue - s->buffer : 0;
+		if (queue > s->buffer)
+			queue = s->buffer;
+		round = s->rtt + queue / s->bw;
+		if (tp->sod_start)
+			tp->sod_diff += (long)cwnd - clocked;
+		clocked = 0;
+		for (i = 0; i < (int)cwnd; i++) {
+			double sent = now + round * i / cwnd;
+
+			if (i >= cwnd - drop ||
+			    (s->loss > 0 && rand_r(&seed) < s->loss * RAND_MAX)) {
+				lost++;
+				continue;
+			}
+			set_clock(tp, sent + round);
+			if (tp->trace)
+				trace_ack(tp, ack + 1, sent, round);
+			ack++;
+			s->delivered++;
+			/* as LinuxTcpAgent keeps them */
+			tp->snd_una = ack * tp->mss_cache;
+			tp->snd_nxt = (ack + tp->snd_cwnd) * tp->mss_cache;
+			tp->srtt = (u32) (round * JIFFY_RATIO) << 3;
+			tp->rx_opt.rcv_tsecr = (u32) (sent * JIFFY_RATIO);
+			tp->rx_opt.saw_tstamp = 1;
+			if (ops->pkts_acked)
+				ops->pkts_acked(tp, 1, (s64) (sent * 1000000000));
+			if (ops->rtt_sample)
+				ops->rtt_sample(tp, (u32) (round * US_RATIO));
+			if (ops->cwnd_event)
+				ops->cwnd_event(tp, lost ? CA_EVENT_SLOW_ACK : CA_EVENT_FAST_ACK);
+			if (tp->icsk_ca_state == TCP_CA_Open && !lost) {
+				tp->bytes_acked += tp->mss_cache;
+				/* the window is refilled on every ACK */
+				ops->cong_avoid(tp, ack * tp->mss_cache,
+						(u32) (round * JIFFY_RATIO), tp->snd_cwnd, 1);
+				tp->snd_cwnd_stamp = tcp_time_stamp;
+			}
+			if (tp->sod_start) {
+				tp->sod_diff++;
+				clocked++;
+			}
+		}
+		cwnd_time += cwnd * round;
+		now += round;
+		if (lost) {
+			s->lost += lost;
+			s->cuts++;
+			for (i = 0; tp->trace && i < SWEEP_DUPACKS; i++)
+				trace_ack(tp, ack, now - round, round);
+			set_ca_state(tp, TCP_CA_Recovery);
+			tp->snd_ssthresh = ops->ssthresh(tp);
+			tp->snd_cwnd_cnt = 0;
+			tp->bytes_acked = 0;
+			if (ops->min_cwnd)
+				tp->snd_cwnd = ops->min_cwnd(tp);
+			else
+				tp->snd_cwnd = tp->snd_ssthresh;
+			if (tp->snd_cwnd < 1)
+				tp->snd_cwnd = 1;
+			set_ca_state(tp, TCP_CA_Open);
+		}
+	}
+	s->avg_cwnd = now > 0 ? cwnd_time / now : 0;
+	if (ops->release)
+		ops->release(tp);
+	ns_linux_trace_close(tp->trace);
+	free(block);
+	free(local);
+}
+
+static void* sweep_thread(void* arg)
+{
+	struct worker* k = (struct worker*) arg;
+	struct sweep* w = k->w;
+	double t0 = thread_cpu_time();
+	int i;
+
+	while ((i = __sync_fetch_and_add(&w->next, 1)) < w->n)
+		run_scenario(&w->s[i], w->duration, w->tracedir);
+	w->cpu[k->id] = thread_cpu_time() - t0;
+	return NULL;
+}
+
+/* run the sweep on nthreads threads, and return the wall-clock time */
+static double run_sweep(struct sweep* w, int nthreads)
+{
+	pthread_t* tid = (pthread_t*) malloc(sizeof(pthread_t) * nthreads);
+	struct worker* k = (struct worker*) malloc(sizeof(struct worker) * nthreads);
+	struct timespec t0, t1;
+	int i;
+
+	w->next = 0;
+	w->cpu = (double*) realloc(w->cpu, sizeof(double) * nthreads);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < nthreads; i++) {
+		k[i].w = w;
+		k[i].id = i;
+		pthread_create(&tid[i], NULL, sweep_thread, &k[i]);
+	}
+	for (i = 0; i < nthreads; i++)
+		pthread_join(tid[i], NULL);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	free(tid);
+	free(k);
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+static void reset_results(struct sweep* w)
+{
+	int i;
+
+	for (i = 0; i < w->n; i++) {
+		w->s[i].delivered = w->s[i].lost = w->s[i].cuts = 0;
+		w->s[i].avg_cwnd = 0;
+	}
+}
+
+static void usage(const char* prog)
+{
+	fprintf(stderr, "Usage: %s [-j threads] [-n replicas] [-t seconds] [-r dir] scenario-file\n", prog);
+	exit(1);
+}
+
+int main(int argc, char** argv)
+{
+	struct sweep w;
+	struct scenario* serial = NULL;
+	const char* path = NULL;
+	char line[SWEEP_LINE_MAX];
+	int nthreads = 1, replicas = 1, capacity = 0;
+	double t1 = 0, tn;
+	FILE* fp;
+	int i, r;
+
+	memset(&w, 0, sizeof(w));
+	w.duration = 100;
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			nthreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			replicas = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			w.duration = atof(argv[++i]);
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			w.tracedir = argv[++i];
+		else if (!path)
+			path = argv[i];
+		else
+			usage(argv[0]);
+	}
+	if (!path || nthreads < 1 || replicas < 1)
+		usage(argv[0]);
+	fp = fopen(path, "r");
+	if (!fp) {
+		perror(path);
+		return 1;
+	}
+
+	/* the modules are all registered: the registry is read-only from now on */
+	cc_list_frozen = 1;
+	while (fgets(line, sizeof(line), fp)) {
+		struct scenario s;
+
+		if (line[strspn(line, " \t\n")] == 0 || line[strspn(line, " \t")] == '#')
+			continue;
+		line[strcspn(line, "\n")] = 0;
+		if (parse_scenario(&s, line) < 0) {
+			fprintf(stderr, "Error: bad scenario: %s\n", s.line);
+			return 1;
+		}
+		for (r = 0; r < replicas; r++) {
+			if (w.n == capacity) {
+				capacity = capacity ? 2 * capacity : 64;
+				w.s = (struct scenario*) realloc(w.s, sizeof(struct scenario) * capacity);
+			}
+			s.seed = r + 1;
+			s.id = w.n;
+			w.s[w.n++] = s;
+		}
+	}
+	fclose(fp);
+
+	if (nthreads > 1) {
+		t1 = run_sweep(&w, 1);
+		serial = (struct scenario*) malloc(sizeof(struct scenario) * w.n);
+		memcpy(serial, w.s, sizeof(struct scenario) * w.n);
+		reset_results(&w);
+	}
+	tn = run_sweep(&w, nthreads);
+
+	printf("# scenario,seed,goodput(Mbps),lost,loss_events,avg_cwnd\n");
+	for (i = 0; i < w.n; i++) {
+		struct scenario* s = &w.s[i];
+		printf("%s,%u,%.6f,%lu,%lu,%.3f\n", s->line, s->seed,
+		       s->delivered * 8.0 * SWEEP_MSS / w.duration / 1000000,
+		       s->lost, s->cuts, s->avg_cwnd);
+		if (serial && (serial[i].delivered != s->delivered ||
+			       serial[i].lost != s->lost ||
+			       serial[i].avg_cwnd != s->avg_cwnd))
+			fprintf(stderr, "Error: %s (seed %u) differs from the run on one thread\n",
+				s->line, s->seed);
+	}
+	if (serial) {
+		/*
+		 * The threads share nothing but w.next, so with one core per
+		 * thread the sweep takes as long as its busiest thread.  The
+		 * ratio of all the CPU time to that of the busiest thread is
+		 * the speedup the sweep allows, even on a machine with fewer
+		 * cores than threads.
+		 */
+		double total = 0, busiest = 0;
+
+		for (i = 0; i < nthreads; i++) {
+			total += w.cpu[i];
+			if (w.cpu[i] > busiest)
+				busiest = w.cpu[i];
+		}
+		fprintf(stderr, "%d scenarios: %.3f s on 1 thread, %.3f s on %d threads, speedup %.2f\n",
+			w.n, t1, tn, nthreads, t1 / tn);
+		fprintf(stderr, "CPU time: %.3f s in all, %.3f s in the busiest thread, speedup bound %.2f\n",
+			total, busiest, busiest > 0 ? total / busiest : 0);
+	} else
+		fprintf(stderr, "%d scenarios: %.3f s\n", w.n, tn);
+	free(serial);
+	free(w.cpu);
+	return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * TCP-Linux module for NS2
+ *
+ * Module: linux/ns-linux-trace-dump.c
+ *      A standalone decoder that converts a TCP-Linux binary trace into CSV.
+ *
+ *	Build:  cc -o ns-linux-trace-dump ns-linux-trace-dump.c
+ *	Usage:  ns-linux-trace-dump [-t ack|sod] trace-file
+ *
+ *	Without -t, every record is printed with its type in the first column.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ns-linux-trace.h"
+
+static const char* ack_columns = "ts,ts_echo,now,seqno,ack,cwnd,ssthresh,clock_rate,rtt,t_rtt,ack_var";
+static const char* sod_columns = "now,start_time,ack,cwnd,queue_len,target_queue_len,sod_diff,bw,bdp,phase";
+
+static void print_ack(const struct ns_linux_trace_ack* a)
+{
+	printf("%.9f,%.9f,%.9f,%d,%u,%u,%u,%.9g,%.9f,%d,%.9g\n",
+	       a->ts, a->ts_echo, a->now, a->seqno, a->ack, a->cwnd, a->ssthresh,
+	       a->clock_rate, a->rtt, a->t_rtt, a->ack_var);
+}
+
+static void print_sod(const struct ns_linux_trace_sod* s)
+{
+	printf("%.9f,%.9f,%u,%u,%lld,%lld,%lld,%.9g,%.9g,%d\n",
+	       s->now, s->start_time, s->ack, s->cwnd, s->queue_len,
+	       s->target_queue_len, s->sod_diff, s->bw, s->bdp, s->phase);
+}
+
+static void usage(const char* prog)
+{
+	fprintf(stderr, "Usage: %s [-t ack|sod] trace-file\n", prog);
+	exit(1);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int only = 0;
+	const char* path = NULL;
+	struct ns_linux_trace_hdr hdr;
+	struct ns_linux_trace_rec rec;
+	FILE* fp;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "ack") == 0)
+				only = NS_LINUX_TRACE_ACK;
+			else if (strcmp(argv[i], "sod") == 0)
+				only = NS_LINUX_TRACE_SOD;
+			else
+				usage(argv[0]);
+		} else if (!path) {
+			path = argv[i];
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if (!path)
+		usage(argv[0]);
+
+	fp = fopen(path, "rb");
+	if (!fp) {
+		fprintf(stderr, "Error: cannot open %s\n", path);
+		return 1;
+	}
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    memcmp(hdr.magic, NS_LINUX_TRACE_MAGIC, sizeof(hdr.magic)) != 0) {
+		fprintf(stderr, "Error: %s is not a TCP-Linux trace\n", path);
+		return 1;
+	}
+	if (hdr.version != NS_LINUX_TRACE_VERSION || hdr.rec_size != sizeof(rec)) {
+		fprintf(stderr, "Error: %s has version %u record size %u, expected version %u record size %u\n",
+			path, hdr.version, hdr.rec_size, NS_LINUX_TRACE_VERSION, (unsigned int)sizeof(rec));
+		return 1;
+	}
+
+	if (only == NS_LINUX_TRACE_ACK)
+		printf("%s\n", ack_columns);
+	else if (only == NS_LINUX_TRACE_SOD)
+		printf("%s\n", sod_columns);
+	else
+		printf("# ack,%s\n# sod,%s\n", ack_columns, sod_columns);
+
+	while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+		if (only && rec.type != only)
+			continue;
+		switch (rec.type) {
+		case NS_LINUX_TRACE_ACK:
+			if (!only)
+				printf("ack,");
+			print_ack(&rec.u.ack);
+			break;
+		case NS_LINUX_TRACE_SOD:
+			if (!only)
+				printf("sod,");
+			print_sod(&rec.u.sod);
+			break;
+		default:
+			fprintf(stderr, "Warning: unknown record type %u\n", rec.type);
+		}
+	}
+	fclose(fp);
+	return 0;
+}
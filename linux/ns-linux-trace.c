@@ -0,0 +1,172 @@
+/*
+ * TCP-Linux module for NS2
+ *
+ * Module: linux/ns-linux-trace.c
+ *      This is the per-flow binary trace of TCP-Linux.
+ *	Records are copied into a window [buf, buf+cap).  When the window is full,
+ *	it is either written out with fwrite (buffered mode) or the next part of the
+ *	file is mapped in (mmap mode).
+ *
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include "ns-linux-trace.h"
+
+#define TRACE_BUF_SIZE (64*1024)		/* buffered mode */
+#define TRACE_MAP_SIZE (4*1024*1024)		/* mmap mode, multiple of the page size */
+
+struct ns_linux_trace {
+	char* buf;
+	size_t pos;
+	size_t cap;
+	int use_mmap;
+	FILE* fp;		/* buffered mode */
+	int fd;			/* mmap mode */
+	off_t map_off;		/* file offset of buf in mmap mode */
+	int failed;		/* a write failed, drop further records */
+};
+
+/* map the window starting at t->map_off, growing the file as needed */
+static int trace_map(struct ns_linux_trace* t)
+{
+	void* p;
+
+	if (ftruncate(t->fd, t->map_off + TRACE_MAP_SIZE) < 0)
+		return -1;
+	p = mmap(NULL, TRACE_MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, t->fd, t->map_off);
+	if (p == MAP_FAILED)
+		return -1;
+	t->buf = (char*)p;
+	t->cap = TRACE_MAP_SIZE;
+	t->pos = 0;
+	return 0;
+}
+
+/* the window is full: hand it to the file and start a new one */
+static int trace_advance(struct ns_linux_trace* t)
+{
+	if (!t->use_mmap) {
+		if (t->pos > 0 && fwrite(t->buf, 1, t->pos, t->fp) != t->pos)
+			return -1;
+		t->pos = 0;
+		return 0;
+	}
+	munmap(t->buf, t->cap);
+	t->map_off += t->cap;
+	t->buf = NULL;
+	t->cap = t->pos = 0;
+	return trace_map(t);
+}
+
+static void trace_put(struct ns_linux_trace* t, const void* data, size_t len)
+{
+	const char* p = (const char*)data;
+
+	if (t->failed)
+		return;
+	while (len > 0) {
+		size_t n = t->cap - t->pos;
+		if (n == 0) {
+			if (trace_advance(t) < 0) {
+				fprintf(stderr, "ns-linux-trace: cannot write trace, tracing stopped\n");
+				t->failed = 1;
+				return;
+			}
+			continue;
+		}
+		if (n > len)
+			n = len;
+		memcpy(t->buf + t->pos, p, n);
+		t->pos += n;
+		p += n;
+		len -= n;
+	}
+}
+
+struct ns_linux_trace* ns_linux_trace_open(const char* path, int use_mmap)
+{
+	struct ns_linux_trace* t;
+	struct ns_linux_trace_hdr hdr;
+
+	t = (struct ns_linux_trace*)malloc(sizeof(struct ns_linux_trace));
+	if (!t)
+		return NULL;
+	memset(t, 0, sizeof(struct ns_linux_trace));
+	t->use_mmap = use_mmap;
+	t->fd = -1;
+
+	if (use_mmap) {
+		t->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (t->fd < 0 || trace_map(t) < 0) {
+			if (t->fd >= 0)
+				close(t->fd);
+			free(t);
+			return NULL;
+		}
+	} else {
+		t->fp = fopen(path, "wb");
+		t->buf = (char*)malloc(TRACE_BUF_SIZE);
+		if (!t->fp || !t->buf) {
+			if (t->fp)
+				fclose(t->fp);
+			free(t->buf);
+			free(t);
+			return NULL;
+		}
+		t->cap = TRACE_BUF_SIZE;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, NS_LINUX_TRACE_MAGIC, sizeof(hdr.magic));
+	hdr.version = NS_LINUX_TRACE_VERSION;
+	hdr.rec_size = sizeof(struct ns_linux_trace_rec);
+	trace_put(t, &hdr, sizeof(hdr));
+	return t;
+}
+
+void ns_linux_trace_write(struct ns_linux_trace* t, const struct ns_linux_trace_rec* rec)
+{
+	if (t->cap - t->pos >= sizeof(*rec)) {
+		memcpy(t->buf + t->pos, rec, sizeof(*rec));
+		t->pos += sizeof(*rec);
+	} else {
+		trace_put(t, rec, sizeof(*rec));
+	}
+}
+
+void ns_linux_trace_flush(struct ns_linux_trace* t)
+{
+	if (t->use_mmap) {
+		if (t->buf)
+			msync(t->buf, t->cap, MS_ASYNC);
+		return;
+	}
+	if (t->pos > 0 && fwrite(t->buf, 1, t->pos, t->fp) == t->pos)
+		t->pos = 0;
+	fflush(t->fp);
+}
+
+void ns_linux_trace_close(struct ns_linux_trace* t)
+{
+	if (!t)
+		return;
+	if (t->use_mmap) {
+		if (t->buf)
+			munmap(t->buf, t->cap);
+		/* drop the unused tail of the last window */
+		if (ftruncate(t->fd, t->map_off + t->pos) < 0)
+			fprintf(stderr, "ns-linux-trace: cannot truncate trace\n");
+		close(t->fd);
+	} else {
+		ns_linux_trace_flush(t);
+		fclose(t->fp);
+		free(t->buf);
+	}
+	free(t);
+}
@@ -0,0 +1,89 @@
+/*
+ * TCP-Linux module for NS2
+ *
+ * Module: linux/ns-linux-trace.h
+ *      This is the header file of the per-flow binary trace of TCP-Linux.
+ *	Each LinuxTcpAgent may own one trace; the agent and its congestion control
+ *	module append fixed-width records to it.  Use ns-linux-trace-dump to convert
+ *	a trace file into CSV.
+ *
+ *	This header is shared by C++ (tcp-linux.cc), the C modules in linux/src and the
+ *	standalone decoder, so it only uses plain C types.
+ *
+ */
+
+#ifndef NS_LINUX_TRACE_H
+#define NS_LINUX_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NS_LINUX_TRACE_MAGIC "NSLTRACE"
+#define NS_LINUX_TRACE_VERSION 1
+
+/* Record types */
+#define NS_LINUX_TRACE_ACK 1		/* one per ACK processed by LinuxTcpAgent::recv */
+#define NS_LINUX_TRACE_SOD 2		/* one per SOD cwnd update */
+
+/* File header, written once at the beginning of the file */
+struct ns_linux_trace_hdr {
+	char magic[8];
+	unsigned int version;
+	unsigned int rec_size;		/* sizeof(struct ns_linux_trace_rec) */
+};
+
+struct ns_linux_trace_ack {
+	double ts;			/* timestamp carried by the ACK */
+	double ts_echo;			/* echoed timestamp of the data packet */
+	double now;			/* simulation time the ACK is received */
+	double clock_rate;		/* ACK clock rate estimation */
+	double rtt;			/* now - ts_echo */
+	double ack_var;			/* ACK inter-arrival variation */
+	int seqno;
+	unsigned int ack;
+	unsigned int cwnd;
+	unsigned int ssthresh;
+	int t_rtt;			/* RTT in tcp ticks */
+	int pad;
+};
+
+struct ns_linux_trace_sod {
+	double now;
+	double start_time;		/* start of the current update period */
+	double bw;			/* estimated bandwidth (pkts/s) */
+	double bdp;			/* bw * (baseRTT + ack_var) */
+	long long queue_len;		/* estimated queue length */
+	long long target_queue_len;
+	long long sod_diff;
+	unsigned int ack;
+	unsigned int cwnd;
+	int phase;			/* 1: full estimate period, 2: partial */
+	int pad;
+};
+
+struct ns_linux_trace_rec {
+	unsigned int type;
+	unsigned int pad;
+	union {
+		struct ns_linux_trace_ack ack;
+		struct ns_linux_trace_sod sod;
+	} u;
+};
+
+struct ns_linux_trace;
+
+/* Open a trace file.  If use_mmap is non-zero, records are copied straight into
+ * a memory mapped window of the file; otherwise they are buffered and written
+ * with fwrite.  Returns NULL if the file cannot be opened.
+ */
+extern struct ns_linux_trace* ns_linux_trace_open(const char* path, int use_mmap);
+extern void ns_linux_trace_write(struct ns_linux_trace* t, const struct ns_linux_trace_rec* rec);
+extern void ns_linux_trace_flush(struct ns_linux_trace* t);
+extern void ns_linux_trace_close(struct ns_linux_trace* t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,8 +17,8 @@
  */
 #include <string.h>
 #include "ns-linux-util.h"
-__u32 tcp_time_stamp=0;
-s64 ktime_get_real=0;
+__thread __u32 tcp_time_stamp=0;
+__thread s64 ktime_get_real=0;
 
 struct list_head ns_tcp_cong_list={&ns_tcp_cong_list, &ns_tcp_cong_list};
 struct list_head *last_added = &ns_tcp_cong_list;
@@ -39,5 +39,6 @@ struct cc_list {
 struct cc_list* cc_list_head = NULL;
 
 unsigned char cc_list_changed = 0;
+unsigned char cc_list_frozen = 0;
 
 
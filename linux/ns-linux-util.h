@@ -20,11 +20,26 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "ns-linux-param.h"
+#include "ns-linux-trace.h"
+#include "ns-linux-stats.h"
 
 extern struct tcp_congestion_ops tcp_reno;
 
-extern unsigned long tcp_time_stamp;
-extern long long ktime_get_real;
+/* Lookups for the standalone drivers (see ns-linux-sweep.c) */
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern struct tcp_congestion_ops* find_ca_by_name(const char* name);
+extern int find_param_slot(const char* ca, const char* name);
+#ifdef __cplusplus
+}
+#endif
+
+/* The clock of the TCP being served, set by its agent before any call into
+ * the congestion control module.  It is thread-local, so that independent
+ * simulations may run on different threads of one process. */
+extern __thread unsigned long tcp_time_stamp;
+extern __thread long long ktime_get_real;
 
 #define JIFFY_RATIO 1000
 #define US_RATIO 1000000
@@ -96,6 +111,7 @@ struct cc_param_list {
 	const char* type;
 	const char* description;
 	const void* ptr;
+	int slot;		/* slot in the parameter blocks */
 	struct cc_param_list* next;
 };
 
@@ -113,16 +129,11 @@ struct list_head {
 	const char* file_name;
 };
 
-struct td {
-	double td_i;
-        
-        double td_i_ts; //Liu Ke's code
-	
-        struct td* next;
-	struct td* prev;
-};
-
 extern unsigned char cc_list_changed;
+/* Set once the simulation has started; from then on the list of congestion
+ * control algorithms (and their parameters) is read-only, and may be read
+ * from any thread without locking. */
+extern unsigned char cc_list_frozen;
 extern struct list_head ns_tcp_cong_list;
 extern struct list_head *last_added;
 #define list_for_each_entry_rcu(pos, head, member) \
@@ -211,7 +222,7 @@ struct tcp_options_received {
 //	__u16	mss_clamp;	/* Maximal mss, negotiated at connection setup */
 };
 
-#define TD_ARRAY_CAPACITY 5500
+#define TD_DEFAULT_CAPACITY 5500	/* samples in the ACK inter-arrival history */
 
         
 struct tcp_sock {
@@ -350,31 +361,38 @@ struct tcp_sock {
         double prev_ts;
 	
         double prev_rcv_ts;
-        double td_interval;
-        double td_interval_ts;        
         double clock_rate;
         double ack_var;
         double current_time;
-        FILE *output_file;
+        struct ns_linux_trace *trace;	/* per-flow binary trace, NULL if off */
         
         
-        __u32 td_count;
-	struct td *head;
-	struct td *last;
-	struct td ary_td[TD_ARRAY_CAPACITY];
-	__u32 td_head_index;
-	__u32 td_last_index;
+	/* ACK inter-arrival history; the buffers are allocated by LinuxTcpAgent
+	 * only when the ACK clock-rate estimator runs */
+	struct win_var td_i;	/* inter-arrival time of the ACKs at the sender */
+	struct win_var td_i_ts;	/* inter-departure time of the ACKs at the receiver */
 	double prev_time;
         
         long long sod_diff; 
         int sod_start;
         
+	/* Pacing: a congestion control module that sets pacing_rate (in packets
+	 * per second) has LinuxTcpAgent release its window at that rate, a few
+	 * packets at a time, instead of back to back.  0 turns pacing off. */
+	double pacing_rate;
+
+	int **params;		/* parameter block, NULL if all are the defaults */
+
 	struct tcp_congestion_ops *icsk_ca_ops;
 	__u8			  icsk_ca_state;
-	u32			  icsk_ca_priv[16];
-#define ICSK_CA_PRIV_SIZE	(16 * sizeof(u32))
+	u32			  icsk_ca_priv[32];
+#define ICSK_CA_PRIV_SIZE	(32 * sizeof(u32))
 };
 
+/* the value of module parameter `name' for this TCP (see ns-linux-param.h) */
+#define param_sk(sk, name) \
+	((sk)->params ? *(sk)->params[name##_param_slot] : (name))
+
 struct sk_buff {
 
 };
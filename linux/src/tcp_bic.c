@@ -73,14 +73,14 @@ static inline void bictcp_reset(struct bictcp *ca)
 static void bictcp_init(struct sock *sk)
 {
 	bictcp_reset(inet_csk_ca(sk));
-	if (initial_ssthresh)
-		tcp_sk(sk)->snd_ssthresh = initial_ssthresh;
+	if (param_sk(sk, initial_ssthresh))
+		tcp_sk(sk)->snd_ssthresh = param_sk(sk, initial_ssthresh);
 }
 
 /*
  * Compute congestion window to use.
  */
-static inline void bictcp_update(struct bictcp *ca, u32 cwnd)
+static inline void bictcp_update(struct sock *sk, struct bictcp *ca, u32 cwnd)
 {
 	if (ca->last_cwnd == cwnd &&
 	    (s32)(tcp_time_stamp - ca->last_time) <= HZ / 32)
@@ -93,7 +93,7 @@ static inline void bictcp_update(struct bictcp *ca, u32 cwnd)
 		ca->epoch_start = tcp_time_stamp;
 
 	/* start off normal */
-	if (cwnd <= low_window) {
+	if (cwnd <= param_sk(sk, low_window)) {
 		ca->cnt = cwnd;
 		return;
 	}
@@ -103,12 +103,12 @@ static inline void bictcp_update(struct bictcp *ca, u32 cwnd)
 		__u32 	dist = (ca->last_max_cwnd - cwnd)
 			/ BICTCP_B;
 
-		if (dist > max_increment)
+		if (dist > param_sk(sk, max_increment))
 			/* linear increase */
-			ca->cnt = cwnd / max_increment;
+			ca->cnt = cwnd / param_sk(sk, max_increment);
 		else if (dist <= 1U)
 			/* binary search increase */
-			ca->cnt = (cwnd * smooth_part) / BICTCP_B;
+			ca->cnt = (cwnd * param_sk(sk, smooth_part)) / BICTCP_B;
 		else
 			/* binary search increase */
 			ca->cnt = cwnd / dist;
@@ -116,14 +116,14 @@ static inline void bictcp_update(struct bictcp *ca, u32 cwnd)
 		/* slow start AMD linear increase */
 		if (cwnd < ca->last_max_cwnd + BICTCP_B)
 			/* slow start */
-			ca->cnt = (cwnd * smooth_part) / BICTCP_B;
-		else if (cwnd < ca->last_max_cwnd + max_increment*(BICTCP_B-1))
+			ca->cnt = (cwnd * param_sk(sk, smooth_part)) / BICTCP_B;
+		else if (cwnd < ca->last_max_cwnd + param_sk(sk, max_increment)*(BICTCP_B-1))
 			/* slow start */
 			ca->cnt = (cwnd * (BICTCP_B-1))
 				/ (cwnd - ca->last_max_cwnd);
 		else
 			/* linear increase */
-			ca->cnt = cwnd / max_increment;
+			ca->cnt = cwnd / param_sk(sk, max_increment);
 	}
 
 	/* if in slow start or link utilization is very low */
@@ -149,7 +149,7 @@ static void bictcp_cong_avoid(struct sock *sk, u32 ack,
 	if (tp->snd_cwnd <= tp->snd_ssthresh)
 		tcp_slow_start(tp);
 	else {
-		bictcp_update(ca, tp->snd_cwnd);
+		bictcp_update(sk, ca, tp->snd_cwnd);
 
 		/* In dangerous area, increase slowly.
 		 * In theory this is tp->snd_cwnd += 1 / tp->snd_cwnd
@@ -176,8 +176,8 @@ static u32 bictcp_recalc_ssthresh(struct sock *sk)
 	ca->epoch_start = 0;	/* end of epoch */
 
 	/* Wmax and fast convergence */
-	if (tp->snd_cwnd < ca->last_max_cwnd && fast_convergence)
-		ca->last_max_cwnd = (tp->snd_cwnd * (BICTCP_BETA_SCALE + beta))
+	if (tp->snd_cwnd < ca->last_max_cwnd && param_sk(sk, fast_convergence))
+		ca->last_max_cwnd = (tp->snd_cwnd * (BICTCP_BETA_SCALE + param_sk(sk, beta)))
 			/ (2 * BICTCP_BETA_SCALE);
 	else
 		ca->last_max_cwnd = tp->snd_cwnd;
@@ -185,10 +185,10 @@ static u32 bictcp_recalc_ssthresh(struct sock *sk)
 	ca->loss_cwnd = tp->snd_cwnd;
 
 
-	if (tp->snd_cwnd <= low_window)
+	if (tp->snd_cwnd <= param_sk(sk, low_window))
 		return max(tp->snd_cwnd >> 1U, 2U);
 	else
-		return max((tp->snd_cwnd * beta) / BICTCP_BETA_SCALE, 2U);
+		return max((tp->snd_cwnd * param_sk(sk, beta)) / BICTCP_BETA_SCALE, 2U);
 }
 
 static u32 bictcp_undo_cwnd(struct sock *sk)
@@ -44,6 +44,12 @@ int tcp_register_congestion_control(struct tcp_congestion_ops *ca)
 		return -EINVAL;
 	}
 
+	if (cc_list_frozen) {
+		printk(KERN_ERR "TCP %s registered after the simulation started\n",
+		       ca->name);
+		return -EBUSY;
+	}
+
 	spin_lock(&tcp_cong_list_lock);
 	if (tcp_ca_find(ca->name)) {
 		printk(KERN_NOTICE "TCP %s already registered\n", ca->name);
@@ -66,6 +72,8 @@ EXPORT_SYMBOL_GPL(tcp_register_congestion_control);
  */
 void tcp_unregister_congestion_control(struct tcp_congestion_ops *ca)
 {
+	if (cc_list_frozen)
+		return;
 	spin_lock(&tcp_cong_list_lock);
 	list_del_rcu(&ca->list);
 	spin_unlock(&tcp_cong_list_lock);
@@ -294,7 +302,7 @@ void tcp_slow_start(struct tcp_sock *tp)
 	 * previously unacknowledged bytes ACKed by each incoming
 	 * acknowledgment, provided the increase is not more than L
 	 */
-	if (sysctl_tcp_abc && tp->bytes_acked < tp->mss_cache)
+	if (param_sk(tp, sysctl_tcp_abc) && tp->bytes_acked < tp->mss_cache)
 		return;
 
 	if (sysctl_tcp_max_ssthresh > 0 && tp->snd_cwnd > sysctl_tcp_max_ssthresh)
@@ -305,7 +313,7 @@ void tcp_slow_start(struct tcp_sock *tp)
 	/* RFC3465: ABC
 	 * We MAY increase by 2 if discovered delayed ack
 	 */
-	if (sysctl_tcp_abc > 1 && tp->bytes_acked >= 2*tp->mss_cache)
+	if (param_sk(tp, sysctl_tcp_abc) > 1 && tp->bytes_acked >= 2*tp->mss_cache)
 		cnt <<= 1;
 	tp->bytes_acked = 0;
 
@@ -338,7 +346,7 @@ void tcp_reno_cong_avoid(struct sock *sk, u32 ack, u32 rtt, u32 in_flight,
 		tcp_slow_start(tp);
 
 	/* In dangerous area, increase slowly. */
-	else if (sysctl_tcp_abc) {
+	else if (param_sk(tp, sysctl_tcp_abc)) {
 		/* RFC3465: Appropriate Byte Count
 		 * increase once for each full cwnd acked
 		 */
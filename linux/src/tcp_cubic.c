@@ -87,8 +87,8 @@ static inline void bictcp_reset(struct bictcp *ca)
 static void bictcp_init(struct sock *sk)
 {
 	bictcp_reset(inet_csk_ca(sk));
-	if (initial_ssthresh)
-		tcp_sk(sk)->snd_ssthresh = initial_ssthresh;
+	if (param_sk(sk, initial_ssthresh))
+		tcp_sk(sk)->snd_ssthresh = param_sk(sk, initial_ssthresh);
 }
 
 /* calculate the cubic root of x using a table lookup followed by one
@@ -142,7 +142,7 @@ static u32 cubic_root(u64 a)
 /*
  * Compute congestion window to use.
  */
-static inline void bictcp_update(struct bictcp *ca, u32 cwnd)
+static inline void bictcp_update(struct sock *sk, struct bictcp *ca, u32 cwnd)
 {
 	u64 offs;
 	u32 delta, t, bic_target, min_cnt, max_cnt;
@@ -213,7 +213,7 @@ static inline void bictcp_update(struct bictcp *ca, u32 cwnd)
 
 	if (ca->delay_min > 0) {
 		/* max increment = Smax * rtt / 0.1  */
-		min_cnt = (cwnd * HZ * 8)/(10 * max_increment * ca->delay_min);
+		min_cnt = (cwnd * HZ * 8)/(10 * param_sk(sk, max_increment) * ca->delay_min);
 
 		/* use concave growth when the target is above the origin */
 		if (ca->cnt < min_cnt && t >= ca->bic_K)
@@ -225,7 +225,7 @@ static inline void bictcp_update(struct bictcp *ca, u32 cwnd)
 		ca->cnt = 50;
 
 	/* TCP Friendly */
-	if (tcp_friendliness) {
+	if (param_sk(sk, tcp_friendliness)) {
 		u32 scale = beta_scale;
 		delta = (cwnd * scale) >> 3;
 		while (ca->ack_cnt > delta) {		/* update tcp cwnd */
@@ -284,7 +284,7 @@ static void bictcp_cong_avoid(struct sock *sk, u32 ack,
 	if (tp->snd_cwnd <= tp->snd_ssthresh)
 		tcp_slow_start(tp);
 	else {
-		bictcp_update(ca, tp->snd_cwnd);
+		bictcp_update(sk, ca, tp->snd_cwnd);
 
 		/* In dangerous area, increase slowly.
 		 * In theory this is tp->snd_cwnd += 1 / tp->snd_cwnd
@@ -307,15 +307,15 @@ static u32 bictcp_recalc_ssthresh(struct sock *sk)
 	ca->epoch_start = 0;	/* end of epoch */
 
 	/* Wmax and fast convergence */
-	if (tp->snd_cwnd < ca->last_max_cwnd && fast_convergence)
-		ca->last_max_cwnd = (tp->snd_cwnd * (BICTCP_BETA_SCALE + beta))
+	if (tp->snd_cwnd < ca->last_max_cwnd && param_sk(sk, fast_convergence))
+		ca->last_max_cwnd = (tp->snd_cwnd * (BICTCP_BETA_SCALE + param_sk(sk, beta)))
 			/ (2 * BICTCP_BETA_SCALE);
 	else
 		ca->last_max_cwnd = tp->snd_cwnd;
 
 	ca->loss_cwnd = tp->snd_cwnd;
 
-	return max((tp->snd_cwnd * beta) / BICTCP_BETA_SCALE, 2U);
+	return max((tp->snd_cwnd * param_sk(sk, beta)) / BICTCP_BETA_SCALE, 2U);
 }
 
 static u32 bictcp_undo_cwnd(struct sock *sk)
@@ -109,7 +109,7 @@ static void measure_achieved_throughput(struct sock *sk, u32 pkts_acked, ktime_t
 	if (icsk->icsk_ca_state == TCP_CA_Open)
 		ca->pkts_acked = pkts_acked;
 
-	if (!use_bandwidth_switch)
+	if (!param_sk(sk, use_bandwidth_switch))
 		return;
 
 	/* achieved throughput calculations */
@@ -142,9 +142,9 @@ static void measure_achieved_throughput(struct sock *sk, u32 pkts_acked, ktime_t
 	}
 }
 
-static inline void htcp_beta_update(struct htcp *ca, u32 minRTT, u32 maxRTT)
+static inline void htcp_beta_update(struct sock *sk, struct htcp *ca, u32 minRTT, u32 maxRTT)
 {
-	if (use_bandwidth_switch) {
+	if (param_sk(sk, use_bandwidth_switch)) {
 		u32 maxB = ca->maxB;
 		u32 old_maxB = ca->old_maxB;
 		ca->old_maxB = ca->maxB;
@@ -168,7 +168,7 @@ static inline void htcp_beta_update(struct htcp *ca, u32 minRTT, u32 maxRTT)
 	}
 }
 
-static inline void htcp_alpha_update(struct htcp *ca)
+static inline void htcp_alpha_update(struct sock *sk, struct htcp *ca)
 {
 	u32 minRTT = ca->minRTT;
 	u32 factor = 1;
@@ -179,7 +179,7 @@ static inline void htcp_alpha_update(struct htcp *ca)
 		factor = 1 + (10 * diff + ((diff / 2) * (diff / 2) / HZ)) / HZ;
 	}
 
-	if (use_rtt_scaling && minRTT) {
+	if (param_sk(sk, use_rtt_scaling) && minRTT) {
 		u32 scale = (HZ << 3) / (10 * minRTT);
 
 		/* clamping ratio to interval [0.5,10]<<3 */
@@ -209,8 +209,8 @@ static void htcp_param_update(struct sock *sk)
 	u32 minRTT = ca->minRTT;
 	u32 maxRTT = ca->maxRTT;
 
-	htcp_beta_update(ca, minRTT, maxRTT);
-	htcp_alpha_update(ca);
+	htcp_beta_update(sk, ca, minRTT, maxRTT);
+	htcp_alpha_update(sk, ca);
 
 	/* add slowly fading memory for maxRTT to accommodate routing changes */
 	if (minRTT > 0 && maxRTT > minRTT)
@@ -247,7 +247,7 @@ static void htcp_cong_avoid(struct sock *sk, u32 ack, u32 rtt,
 			if (tp->snd_cwnd < tp->snd_cwnd_clamp)
 				tp->snd_cwnd++;
 			tp->snd_cwnd_cnt = 0;
-			htcp_alpha_update(ca);
+			htcp_alpha_update(sk, ca);
 		} else
 			tp->snd_cwnd_cnt += ca->pkts_acked;
 
@@ -137,7 +137,7 @@ static inline u32 avg_delay(const struct illinois *ca)
  *
  * The result is a convex window growth curve.
  */
-static u32 alpha(struct illinois *ca, u32 da, u32 dm)
+static u32 alpha(struct sock *sk, struct illinois *ca, u32 da, u32 dm)
 {
 	u32 d1 = dm / 100;	/* Low threshold */
 
@@ -149,7 +149,7 @@ static u32 alpha(struct illinois *ca, u32 da, u32 dm)
 		/* Wait for 5 good RTT's before allowing alpha to go alpha max.
 		 * This prevents one good RTT from causing sudden window increase.
 		 */
-		if (++ca->rtt_low < theta)
+		if (++ca->rtt_low < param_sk(sk, theta))
 			return ca->alpha;
 
 		ca->rtt_low = 0;
@@ -224,14 +224,14 @@ static void update_params(struct sock *sk)
 	struct tcp_sock *tp = tcp_sk(sk);
 	struct illinois *ca = inet_csk_ca(sk);
 
-	if (tp->snd_cwnd < win_thresh) {
+	if (tp->snd_cwnd < param_sk(sk, win_thresh)) {
 		ca->alpha = ALPHA_BASE;
 		ca->beta = BETA_BASE;
 	} else if (ca->cnt_rtt > 0) {
 		u32 dm = max_delay(ca);
 		u32 da = avg_delay(ca);
 
-		ca->alpha = alpha(ca, da, dm);
+		ca->alpha = alpha(sk, ca, da, dm);
 		ca->beta = beta(da, dm);
 	}
 
@@ -8,6 +8,9 @@
 
 
 #include "tcp_sod.h"
+
+#define BW_WINDOW_SAMPLES 1024
+#define BASE_RTT_SAMPLES 256	/* initial deque size of the windowed baseRTT filter */
 /*
 
 */
@@ -23,6 +26,15 @@ module_param(init_cwnd, int, 0644);
 MODULE_PARM_DESC(init_cwnd, "Initial congestion window size");
 module_param(init_cwnd_on, int, 0644);
 MODULE_PARM_DESC(init_cwnd_on, "Initial congestion window on");
+static int base_rtt_win = 0;
+module_param(base_rtt_win, int, 0644);
+MODULE_PARM_DESC(base_rtt_win, "Window of the baseRTT filter in ms (0: minimum of all RTT samples)");
+static int pacing = 0;
+module_param(pacing, int, 0644);
+MODULE_PARM_DESC(pacing, "Pace at the estimated bandwidth (0: send at the window)");
+static int pacing_gain = 125;
+module_param(pacing_gain, int, 0644);
+MODULE_PARM_DESC(pacing_gain, "Pacing rate in percent of the estimated bandwidth (at least 100)");
 
 
 static void sod_enable(struct sock *sk)
@@ -49,30 +61,41 @@ void tcp_sod_init(struct sock *sk)
 	struct tcp_sock *tp = tcp_sk(sk);
 	struct sod *sod = inet_csk_ca(sk);
         
-	if (init_cwnd_on != 0)
+	if (param_sk(sk, init_cwnd_on) != 0)
         {
-            tp->snd_cwnd = init_cwnd;
-            printf("initial congestion window: %lu %d\n", tp->snd_cwnd, init_cwnd_on);
+            tp->snd_cwnd = param_sk(sk, init_cwnd);
+            printf("initial congestion window: %lu %d\n", tp->snd_cwnd, param_sk(sk, init_cwnd_on));
         }
-	sod->baseRTT = 0x7fffffff;
+	win_minmax_free(&sod->baseRTT);
+	win_minmax_init(&sod->baseRTT, BASE_RTT_SAMPLES, (double)param_sk(sk, base_rtt_win)/(double)1000, 0);
+	win_minmax_free(&sod->minRTT);
+	win_minmax_init(&sod->minRTT, 1, 0, 0);
 	sod->currentQueueLen = 0x7fffffff;
-	sod->minRTT = 0x7fffffff;
 	sod->cntRTT = 0;
         sod->targetQueueLen = 10;
         sod->update_period = 0.05;
         sod->estimate_period = 0.05;        
         sod->is_1st_ack_rcv = 0;
                 
-       
-        sod->output = fopen("sod-output", "w");
-        
-        initSlideWindow(&sod->bwWindow, 1024);
+        win_sum_free(&sod->bwWindow);
+        win_sum_init(&sod->bwWindow, BW_WINDOW_SAMPLES);
 	sod_enable(sk);
         
         
 }
 EXPORT_SYMBOL_GPL(tcp_sod_init);
 
+void tcp_sod_release(struct sock *sk)
+{
+	struct sod *sod = inet_csk_ca(sk);
+
+	win_minmax_free(&sod->baseRTT);
+	win_minmax_free(&sod->minRTT);
+	win_sum_free(&sod->bwWindow);
+	tcp_sk(sk)->pacing_rate = 0;
+}
+EXPORT_SYMBOL_GPL(tcp_sod_release);
+
 void tcp_sod_pkts_acked(struct sock *sk, u32 cnt, ktime_t last)
 {
         
@@ -89,11 +112,10 @@ void tcp_sod_pkts_acked(struct sock *sk, u32 cnt, ktime_t last)
     
     vrtt = ktime_to_us(net_timedelta(last)) + 1;
            
-    /* Find the minimum propagation delay: */
-    if (vrtt < sod->baseRTT)
-            sod->baseRTT = vrtt;                
-    
     double now = sk->current_time;
+
+    /* Find the minimum propagation delay: */
+    win_minmax_put(&sod->baseRTT, now, vrtt);
     
     if (!sod->is_1st_ack_rcv && sod->doing_sod_now)
     {
@@ -105,11 +127,11 @@ void tcp_sod_pkts_acked(struct sock *sk, u32 cnt, ktime_t last)
     else if (sod->is_1st_ack_rcv && sod->doing_sod_now)
         sk->sod_diff -= (long)cnt;
     
-    sod->minRTT = min(sod->minRTT, vrtt);
+    win_minmax_put(&sod->minRTT, now, vrtt);
     sod->cntRTT++;
     
         
-    put(&sod->bwWindow, now, cnt);
+    win_sum_put(&sod->bwWindow, now, cnt);
                     
 }
 EXPORT_SYMBOL_GPL(tcp_sod_pkts_acked);
@@ -141,6 +163,29 @@ void tcp_sod_cwnd_event(struct sock *sk, enum tcp_ca_event event)
 }
 EXPORT_SYMBOL_GPL(tcp_sod_cwnd_event);
 
+/* record a cwnd update in the per-flow trace */
+static void sod_trace(struct sock *sk, u32 ack, int phase)
+{
+	struct tcp_sock *tp = tcp_sk(sk);
+	struct sod *sod = inet_csk_ca(sk);
+	struct ns_linux_trace_rec rec;
+
+	rec.type = NS_LINUX_TRACE_SOD;
+	rec.pad = 0;
+	rec.u.sod.now = tp->current_time;
+	rec.u.sod.start_time = sod->start_time;
+	rec.u.sod.bw = sod->estimatedBandwidth;
+	rec.u.sod.bdp = sod->estimatedBandwidth * (win_minmax_get(&sod->baseRTT, 0x7fffffff)/(double)1000000 + sk->ack_var);
+	rec.u.sod.queue_len = sod->currentQueueLen;
+	rec.u.sod.target_queue_len = sod->targetQueueLen;
+	rec.u.sod.sod_diff = sk->sod_diff;
+	rec.u.sod.ack = ack;
+	rec.u.sod.cwnd = tp->snd_cwnd;
+	rec.u.sod.phase = phase;
+	rec.u.sod.pad = 0;
+	ns_linux_trace_write(tp->trace, &rec);
+}
+
 static void tcp_sod_cong_avoid(struct sock *sk, u32 ack,
 				 u32 seq_rtt, u32 in_flight, int flag)
 {
@@ -157,41 +202,52 @@ static void tcp_sod_cong_avoid(struct sock *sk, u32 ack,
 		return;
                
         double now = tp->current_time;
+        double baseRTT = win_minmax_get(&sod->baseRTT, 0x7fffffff);
 	if (now - sod->start_time >= sod->update_period)
         {   
           
-            if (timeInterval(&sod->bwWindow, now) >= sod->estimate_period)//(double)sod->baseRTT/(double)1000000 + sk->ack_var)
+            if (win_sum_interval(&sod->bwWindow, now) >= sod->estimate_period)//(double)sod->baseRTT/(double)1000000 + sk->ack_var)
             {                
-                //sod->thruput = sod->bwWindow._total / timeInterval(&sod->bwWindow, now);               
+                //sod->thruput = win_sum_total(&sod->bwWindow) / win_sum_interval(&sod->bwWindow, now);               
                
-                sod->estimatedBandwidth = sod->bwWindow._total / timeInterval(&sod->bwWindow, now); 
-                sod->currentQueueLen = init_cwnd - sod->estimatedBandwidth * ((double)sod->baseRTT/(double)1000000 + sk->ack_var) + sk->sod_diff;
-                timeShift(&sod->bwWindow, now, sod->estimate_period);//(double)sod->baseRTT/(double)1000000 + sk->ack_var);
+                sod->estimatedBandwidth = win_sum_total(&sod->bwWindow) / win_sum_interval(&sod->bwWindow, now); 
+                sod->currentQueueLen = param_sk(sk, init_cwnd) - sod->estimatedBandwidth * (baseRTT/(double)1000000 + sk->ack_var) + sk->sod_diff;
+                win_sum_expire(&sod->bwWindow, now, sod->estimate_period);//(double)sod->baseRTT/(double)1000000 + sk->ack_var);
                 tp->snd_cwnd = ((int32_t)tp->snd_cwnd <= sod->currentQueueLen - sod->targetQueueLen ? 0 : tp->snd_cwnd - (sod->currentQueueLen - sod->targetQueueLen));
                 
-                printf("1 %lf %lf %u %u %ld %u %ld %lf %lf\n", now, sod->start_time, ack, tp->snd_cwnd, sod->currentQueueLen, sod->targetQueueLen, sk->sod_diff, sod->estimatedBandwidth, sod->estimatedBandwidth * ((double)sod->baseRTT/(double)1000000 + sk->ack_var));
+                if (tp->trace)
+                    sod_trace(sk, ack, 1);
                 
             } 
             else
             {                
                 
-                if (!timeInterval(&sod->bwWindow, now))
+                if (!win_sum_interval(&sod->bwWindow, now))
                 {
                     sod->estimatedBandwidth = 0;
                     sod->currentQueueLen = sod->targetQueueLen;
                 }
                 else
                 {
-                    sod->estimatedBandwidth = sod->bwWindow._total / timeInterval(&sod->bwWindow, now);    
-                    sod->currentQueueLen = init_cwnd - sod->estimatedBandwidth * ((double)sod->baseRTT/(double)1000000 + sk->ack_var) + sk->sod_diff;
+                    sod->estimatedBandwidth = win_sum_total(&sod->bwWindow) / win_sum_interval(&sod->bwWindow, now);    
+                    sod->currentQueueLen = param_sk(sk, init_cwnd) - sod->estimatedBandwidth * (baseRTT/(double)1000000 + sk->ack_var) + sk->sod_diff;
                 }
                 
                 //sod->thruput = sod->estimatedBandwidth;
                 tp->snd_cwnd = ((int32_t)tp->snd_cwnd <= sod->currentQueueLen - sod->targetQueueLen ? 0 : tp->snd_cwnd - (sod->currentQueueLen - sod->targetQueueLen));
                 
-                printf("2. %lf %lf %u %u %ld %u %ld %lf %lf\n", now, sod->start_time, ack, tp->snd_cwnd, sod->currentQueueLen, sod->targetQueueLen, sk->sod_diff, sod->estimatedBandwidth, sod->estimatedBandwidth * ((double)sod->baseRTT/(double)1000000 + sk->ack_var));
+                if (tp->trace)
+                    sod_trace(sk, ack, 2);
                 
             }
+
+            /* pace a little above the delivery rate, so that the estimate
+             * can grow back after a dip; an empty estimate keeps the last
+             * rate instead of turning pacing off */
+            if (param_sk(sk, pacing) && sod->estimatedBandwidth > 0) {
+                int gain = param_sk(sk, pacing_gain);
+                tp->pacing_rate = sod->estimatedBandwidth * (gain < 100 ? 100 : gain) / 100.0;
+            }
                                                            
             sod->start_time = now;
                         
@@ -202,9 +258,7 @@ static void tcp_sod_cong_avoid(struct sock *sk, u32 ack,
         else if (tp->snd_cwnd > tp->snd_cwnd_clamp)
                 tp->snd_cwnd = tp->snd_cwnd_clamp;
 	
-	sod->minRTT = 0x7fffffff;
-        
-        //fprintf(sod->output, "%lf %lf %u %u %ld %ld %ld %ld\n", now, sod->start_time, ack, tp->snd_cwnd, sod->currentQueueLen, sod->targetQueueLen, sk->sod_diff, sod->baseRTT);
+	win_minmax_reset(&sod->minRTT);
                 
                 
 }
@@ -243,6 +297,7 @@ EXPORT_SYMBOL_GPL(tcp_sod_ssthresh);
 static struct tcp_congestion_ops tcp_sod = {
 	.flags		= TCP_CONG_RTT_STAMP,
 	.init		= tcp_sod_init,
+	.release	= tcp_sod_release,
 	.ssthresh	= tcp_sod_ssthresh,
 	.cong_avoid	= tcp_sod_cong_avoid,
 	.pkts_acked	= tcp_sod_pkts_acked,
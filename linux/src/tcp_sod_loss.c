@@ -39,6 +39,8 @@
 
 #include "tcp_sod_loss.h"
 
+#define BASE_RTT_SAMPLES 256	/* initial deque size of the windowed baseRTT filter */
+
 /* Default values of the Vegas variables, in fixed-point representation
  * with V_PARAM_SHIFT bits to the right of the binary point.
  */
@@ -51,6 +53,9 @@ static int target_qs = 3<<V_PARAM_SHIFT;
 
 module_param(target_qs, int, 0644);
 MODULE_PARM_DESC(target_qs, "Target Queue Length");
+static int base_rtt_win = 0;
+module_param(base_rtt_win, int, 0644);
+MODULE_PARM_DESC(base_rtt_win, "Window of the baseRTT filter in ms (0: minimum of all RTT samples)");
 
 //module_param(alpha, int, 0644);
 //MODULE_PARM_DESC(alpha, "lower bound of packets in network (scale by 2)");
@@ -99,14 +104,25 @@ void tcp_sod_loss_init(struct sock *sk)
 {
 	struct sod_loss *sod = inet_csk_ca(sk);
 	
-	sod->baseRTT = 0x7fffffff;
+	win_minmax_free(&sod->baseRTT);
+	win_minmax_init(&sod->baseRTT, BASE_RTT_SAMPLES, (double)param_sk(sk, base_rtt_win)/(double)1000, 0);
+	win_minmax_free(&sod->minRTT);
+	win_minmax_init(&sod->minRTT, 1, 0, 0);
 	sod->minQL = 0x7fffffff;
-	sod->minRTT = 0x7fffffff;
 	sod->cntRTT = 0;
 	sod_loss_enable(sk);
 }
 EXPORT_SYMBOL_GPL(tcp_sod_loss_init);
 
+void tcp_sod_loss_release(struct sock *sk)
+{
+	struct sod_loss *sod = inet_csk_ca(sk);
+
+	win_minmax_free(&sod->baseRTT);
+	win_minmax_free(&sod->minRTT);
+}
+EXPORT_SYMBOL_GPL(tcp_sod_loss_release);
+
 /* Do RTT sampling needed for Vegas.
  * Basically we:
  *   o min-filter RTT samples from within an RTT to get the current
@@ -119,7 +135,8 @@ void tcp_sod_loss_pkts_acked(struct sock *sk, u32 cnt, ktime_t last)
 {
 	struct tcp_sock *tp = tcp_sk(sk);
 	struct sod_loss *sod = inet_csk_ca(sk);
-	u64 vrtt;
+	const struct win_var *td = &tp->td_i;
+	u64 vrtt, baseRTT;
 	u64 qd_plus_td, remain_qd;
 	u16 est_ql = 0;
 
@@ -130,33 +147,26 @@ void tcp_sod_loss_pkts_acked(struct sock *sk, u32 cnt, ktime_t last)
 	vrtt = ktime_to_us(net_timedelta(last)) + 1;
 
 	/* Filter to find propagation delay: */
-	if (vrtt < sod->baseRTT)
-		sod->baseRTT = vrtt;
+	win_minmax_put(&sod->baseRTT, tp->current_time, vrtt);
+	baseRTT = win_minmax_get(&sod->baseRTT, vrtt);
 	
-	qd_plus_td = vrtt - sod->baseRTT;
-	if (tp->td_last_index == 0)
+	qd_plus_td = vrtt - baseRTT;
+	/* walk the ACK inter-arrival history from the latest sample */
+	if (!win_var_full(td))
 		est_ql = 0;
 	else
 	{
-		if (qd_plus_td < tp->ary_td[tp->td_last_index -1].td_i)
+		if (qd_plus_td < win_var_at(td, 0))
 			est_ql = 1;
 		else
 		{
-			u32 td_index = tp->td_last_index -1;
-			remain_qd = qd_plus_td - tp->ary_td[td_index].td_i;
-			while (remain_qd > 0 && td_index != tp->td_head_index)
+			int age = 0;
+			remain_qd = qd_plus_td - win_var_at(td, 0);
+			while (remain_qd > 0 && ++age < td->count)
 			{
-				if (tp->td_head_index >= tp->td_last_index && td_index == 0 )
-				{
-					if (tp->td_count > 1)
-						td_index = tp->td_count -1;
-					else break;
-				}
-				else td_index--;
-				
-				if (remain_qd > tp->ary_td[td_index].td_i)
+				if (remain_qd > win_var_at(td, age))
 				{
-					remain_qd -= tp->ary_td[td_index].td_i;
+					remain_qd -= win_var_at(td, age);
 					est_ql++;
 				}
 				else 
@@ -174,7 +184,7 @@ void tcp_sod_loss_pkts_acked(struct sock *sk, u32 cnt, ktime_t last)
 	/* Find the min RTT during the last RTT to find
 	 * the current prop. delay + queuing delay:
 	 */
-	sod->minRTT = min(sod->minRTT, vrtt);
+	win_minmax_put(&sod->minRTT, tp->current_time, vrtt);
 	sod->cntRTT++;
 }
 EXPORT_SYMBOL_GPL(tcp_sod_loss_pkts_acked);
@@ -233,9 +243,9 @@ static void tcp_sod_loss_cong_avoid(struct sock *sk, u32 ack,
 		 * algorithm, we determine the state of the network.
 		 */
 
-		rtt = sod->minRTT;
+		rtt = win_minmax_get(&sod->minRTT, 0x7fffffff);
 
-		target_cwnd = ((tp->snd_cwnd * sod->baseRTT)
+		target_cwnd = ((tp->snd_cwnd * (u64)win_minmax_get(&sod->baseRTT, 0x7fffffff))
 			       << V_PARAM_SHIFT) / rtt;
 
 		diff = (tp->snd_cwnd << V_PARAM_SHIFT) - target_cwnd;
@@ -253,7 +263,7 @@ static void tcp_sod_loss_cong_avoid(struct sock *sk, u32 ack,
 			
 		} else {
 			/* Congestion avoidance. */
-			if (sod->minQL < target_qs) {
+			if (sod->minQL < param_sk(sk, target_qs)) {
 				/* In the "non-congestive state", increase cwnd
 				 *  every rtt.
 				 */
@@ -296,7 +306,7 @@ static void tcp_sod_loss_cong_avoid(struct sock *sk, u32 ack,
 	//printf("cwnd: %lu ssth: %lu minQL: %lu diff: %lu rtt: %lu snd_cwnd_cnt: %lu inc: %lu\n", tp->snd_cwnd, tp->snd_ssthresh, sod->minQL, diff, tp->srtt >> 3, tp->snd_cwnd_cnt, sod->inc);
 	/* Wipe the slate clean for the next rtt. */
 	/* veno->cntrtt = 0; */
-	sod->minRTT = 0x7fffffff;
+	win_minmax_reset(&sod->minRTT);
 	sod->minQL = 0x7fffffff;
 
 }
@@ -327,7 +337,7 @@ static u32 tcp_sod_loss_ssthresh(struct sock *sk)
 	const struct tcp_sock *tp = tcp_sk(sk);
 	struct sod_loss *sod = inet_csk_ca(sk);
 
-	if (sod->prev_QL <= target_qs)
+	if (sod->prev_QL <= param_sk(sk, target_qs))
 		/* in "non-congestive state", cut cwnd by 1/5 */
 		return max(tp->snd_cwnd * 4 / 5, 2U);
 	else
@@ -339,6 +349,7 @@ EXPORT_SYMBOL_GPL(tcp_sod_loss_ssthresh);
 static struct tcp_congestion_ops tcp_sod_loss = {
 	.flags		= TCP_CONG_RTT_STAMP,
 	.init		= tcp_sod_loss_init,
+	.release	= tcp_sod_loss_release,
 	.ssthresh	= tcp_sod_loss_ssthresh,
 	.cong_avoid	= tcp_sod_loss_cong_avoid,
 	.pkts_acked	= tcp_sod_loss_pkts_acked,
@@ -352,7 +363,7 @@ static struct tcp_congestion_ops tcp_sod_loss = {
 
 static int __init tcp_sod_loss_register(void)
 {
-	BUILD_BUG_ON(sizeof(struct sod) > ICSK_CA_PRIV_SIZE);
+	BUILD_BUG_ON(sizeof(struct sod_loss) > ICSK_CA_PRIV_SIZE);
 	tcp_register_congestion_control(&tcp_sod_loss);
 	return 0;
 }
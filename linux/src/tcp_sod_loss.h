@@ -12,15 +12,16 @@ struct sod_loss {
 	u8	doing_sod_now;/* if true, do vegas for this RTT */
 	u16	cntRTT;		/* # of RTTs measured within last RTT */
 	u32	minQL;		/* min of RTTs measured within last RTT (in usec) */
-	u64	minRTT;
+	struct win_minmax minRTT;	/* min RTT within the last RTT (in usec) */
 	u32	curQL;
-	u64	baseRTT;	/* the min of all Vegas RTT measurements seen (in usec) */
+	struct win_minmax baseRTT;	/* propagation delay estimation (in usec) */
 	u32	inc;
 	u32	prev_QL;
 
 };
 
 extern void tcp_sod_loss_init(struct sock *sk);
+extern void tcp_sod_loss_release(struct sock *sk);
 extern void tcp_sod_loss_state(struct sock *sk, u8 ca_state);
 extern void tcp_sod_loss_pkts_acked(struct sock *sk, u32 cnt, ktime_t last);
 extern void tcp_sod_loss_cwnd_event(struct sock *sk, enum tcp_ca_event event);
@@ -267,7 +267,7 @@ static void tcp_vegas_cong_avoid(struct sock *sk, u32 ack,
 			diff = (old_wnd << V_PARAM_SHIFT) - target_cwnd;
 			
 
-			if (diff > gamma && tp->snd_ssthresh > 2 ) {
+			if (diff > param_sk(sk, gamma) && tp->snd_ssthresh > 2 ) {
 				/* Going too fast. Time to slow down
 				 * and switch to congestion avoidance.
 				 */
@@ -294,12 +294,12 @@ static void tcp_vegas_cong_avoid(struct sock *sk, u32 ack,
 				/* Figure out where we would like cwnd
 				 * to be.
 				 */
-				if (diff > beta) {
+				if (diff > param_sk(sk, beta)) {
 					/* The old window was too fast, so
 					 * we slow down.
 					 */
 					next_snd_cwnd = old_snd_cwnd - 1;
-				} else if (diff < alpha) {
+				} else if (diff < param_sk(sk, alpha)) {
 					/* We don't have enough extra packets
 					 * in the network, so speed up.
 					 */
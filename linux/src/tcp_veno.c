@@ -154,7 +154,7 @@ static void tcp_veno_cong_avoid(struct sock *sk, u32 ack,
 			tcp_slow_start(tp);
 		} else {
 			/* Congestion avoidance. */
-			if (veno->diff < beta) {
+			if (veno->diff < param_sk(sk, beta)) {
 				/* In the "non-congestive state", increase cwnd
 				 *  every rtt.
 				 */
@@ -199,7 +199,7 @@ static u32 tcp_veno_ssthresh(struct sock *sk)
 	const struct tcp_sock *tp = tcp_sk(sk);
 	struct veno *veno = inet_csk_ca(sk);
 
-	if (veno->diff < beta)
+	if (veno->diff < param_sk(sk, beta))
 		/* in "non-congestive state", cut cwnd by 1/5 */
 		return max(tp->snd_cwnd * 4 / 5, 2U);
 	else
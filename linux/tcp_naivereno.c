@@ -22,7 +22,7 @@ void tcp_naive_reno_cong_avoid(struct tcp_sock *tp, u32 ack, u32 rtt, u32 in_fli
 		tp->snd_cwnd++;
 	} else {
 		if (tp->snd_cwnd_cnt >= tp->snd_cwnd) {
-			tp->snd_cwnd += alpha;
+			tp->snd_cwnd += param_sk(tp, alpha);
 			tp->snd_cwnd_cnt = 0;
 			if (tp->snd_cwnd > tp->snd_cwnd_clamp)
 				tp->snd_cwnd = tp->snd_cwnd_clamp;
@@ -35,7 +35,7 @@ void tcp_naive_reno_cong_avoid(struct tcp_sock *tp, u32 ack, u32 rtt, u32 in_fli
 /* ssthreshold should be half of the congestion window after a loss */
 u32 tcp_naive_reno_ssthresh(struct tcp_sock *tp)
 {
-	int reduction = tp->snd_cwnd / beta;
+	int reduction = tp->snd_cwnd / param_sk(tp, beta);
         return max(tp->snd_cwnd - reduction, 2U);
 }
 
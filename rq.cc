@@ -86,6 +86,9 @@ ReassemblyQueue::fremove(seginfo* p)
 		p->next_->prev_ = p->prev_;
 	else
 		tail_ = p->prev_;
+
+	if (indexed_)
+		tremove(p);
 }
 
 /*
@@ -133,6 +136,31 @@ ReassemblyQueue::cnts(seginfo *p, int& blkcnt, int& bytecnt)
 	int blks = 0;
 	int bytes = 0;
 
+	if (indexed_ && p != NULL) {
+		// p, its right subtree, and each ancestor we
+		// reach from its left (with its right subtree)
+		blks = 1;
+		bytes = p->endseq_ - p->startseq_;
+		if (p->right_) {
+			blks += p->right_->tcnt_;
+			bytes += p->right_->tbytes_;
+		}
+		for (; p->parent_; p = p->parent_) {
+			seginfo* a = p->parent_;
+			if (a->left_ != p)
+				continue;
+			blks++;
+			bytes += a->endseq_ - a->startseq_;
+			if (a->right_) {
+				blks += a->right_->tcnt_;
+				bytes += a->right_->tbytes_;
+			}
+		}
+		blkcnt = blks;
+		bytecnt = bytes;
+		return;
+	}
+
 	while (p != NULL) {
 		++blks;
 		bytes += (p->endseq_ - p->startseq_);
@@ -144,6 +172,170 @@ ReassemblyQueue::cnts(seginfo *p, int& blkcnt, int& bytecnt)
 }
 
 
+/*
+ * treap maintenance (index mode)
+ */
+
+void
+ReassemblyQueue::tupdate(seginfo* p)
+{
+	p->tcnt_ = 1;
+	p->tbytes_ = p->endseq_ - p->startseq_;
+	if (p->left_) {
+		p->tcnt_ += p->left_->tcnt_;
+		p->tbytes_ += p->left_->tbytes_;
+	}
+	if (p->right_) {
+		p->tcnt_ += p->right_->tcnt_;
+		p->tbytes_ += p->right_->tbytes_;
+	}
+}
+
+/*
+ * rotate p above its parent
+ */
+void
+ReassemblyQueue::rotate(seginfo* p)
+{
+	seginfo* a = p->parent_;
+	seginfo* g = a->parent_;
+
+	if (a->left_ == p) {
+		a->left_ = p->right_;
+		if (p->right_)
+			p->right_->parent_ = a;
+		p->right_ = a;
+	} else {
+		a->right_ = p->left_;
+		if (p->left_)
+			p->left_->parent_ = a;
+		p->left_ = a;
+	}
+	a->parent_ = p;
+	p->parent_ = g;
+	if (g == NULL)
+		root_ = p;
+	else if (g->left_ == a)
+		g->left_ = p;
+	else
+		g->right_ = p;
+	tupdate(a);
+	tupdate(p);
+}
+
+/*
+ * insert n between its FIFO neighbours p and q (either may be NULL).
+ * If q has a left subtree, p is its rightmost node; otherwise n
+ * goes to the left of q.
+ */
+void
+ReassemblyQueue::tinsert(seginfo* n, seginfo* p, seginfo* q)
+{
+	n->left_ = n->right_ = NULL;
+	seed_ = seed_ * 1103515245 + 12345;
+	n->prio_ = seed_ >> 8;
+	tupdate(n);
+
+	if (q && q->left_ == NULL) {
+		n->parent_ = q;
+		q->left_ = n;
+	} else if (p) {
+		n->parent_ = p;
+		p->right_ = n;
+	} else {
+		n->parent_ = NULL;
+		root_ = n;
+		return;
+	}
+	tfix(n->parent_);
+	while (n->parent_ && n->parent_->prio_ < n->prio_)
+		rotate(n);
+}
+
+void
+ReassemblyQueue::tremove(seginfo* n)
+{
+	// rotate n down to where it has at most one child
+	while (n->left_ && n->right_) {
+		if (n->left_->prio_ > n->right_->prio_)
+			rotate(n->left_);
+		else
+			rotate(n->right_);
+	}
+	seginfo* c = n->left_ ? n->left_ : n->right_;
+	seginfo* a = n->parent_;
+	if (c)
+		c->parent_ = a;
+	if (a == NULL)
+		root_ = c;
+	else if (a->left_ == n)
+		a->left_ = c;
+	else
+		a->right_ = c;
+	tfix(a);
+}
+
+/*
+ * blocks are disjoint, so both their start and end seq #s
+ * increase along the FIFO, and can be searched in the treap
+ */
+ReassemblyQueue::seginfo*
+ReassemblyQueue::tfirst_start(TcpSeq seq)
+{
+	seginfo *p = root_, *r = NULL;
+	while (p) {
+		if (p->startseq_ >= seq) {
+			r = p;
+			p = p->left_;
+		} else
+			p = p->right_;
+	}
+	return (r);
+}
+
+ReassemblyQueue::seginfo*
+ReassemblyQueue::tfirst_end(TcpSeq seq)
+{
+	seginfo *p = root_, *r = NULL;
+	while (p) {
+		if (p->endseq_ >= seq) {
+			r = p;
+			p = p->left_;
+		} else
+			p = p->right_;
+	}
+	return (r);
+}
+
+ReassemblyQueue::seginfo*
+ReassemblyQueue::tlast_end(TcpSeq seq)
+{
+	seginfo *p = root_, *r = NULL;
+	while (p) {
+		if (p->endseq_ <= seq) {
+			r = p;
+			p = p->right_;
+		} else
+			p = p->left_;
+	}
+	return (r);
+}
+
+/*
+ * turn the treap index on (building it from the FIFO) or off
+ */
+void
+ReassemblyQueue::index(int on)
+{
+	if (on && !indexed_) {
+		root_ = NULL;
+		for (seginfo* p = head_; p; p = p->next_)
+			tinsert(p, p->prev_, NULL);
+	} else if (!on)
+		root_ = NULL;
+	indexed_ = on;
+}
+
 /*
  * clear out reassembly queue and stack
  */
@@ -153,6 +345,7 @@ ReassemblyQueue::clear()
 {
 	// clear stack and end of queue
 	tail_ = top_ = bottom_ = hint_ = NULL;
+	root_ = NULL;
 
 	seginfo *p = head_;
 	while (head_) {
@@ -191,6 +384,7 @@ ReassemblyQueue::clearto(TcpSeq seq)
 	if (p && p->startseq_ <= seq && p->endseq_ > seq) {
 		total_ -= (seq - p->startseq_);
 		p->startseq_ = seq;
+		reseq(p);
 		flag |= p->pflags_;
 	}
 	return flag;
@@ -328,6 +522,8 @@ ReassemblyQueue::add(TcpSeq start, TcpSeq end, TcpFlag tiflags, RqFlag rqflags)
 		head_->pflags_ = tiflags;
 		head_->rqflags_ = rqflags;
 		head_->cnt_ = initcnt;
+		if (indexed_)
+			tinsert(head_, NULL, NULL);
 
 		total_ = (end - start);
 
@@ -369,13 +565,18 @@ again2:
 		// search for segments before and after
 		// the new one; could be overlapped
 		//
-		q = head_;
-		while (q && q->startseq_ < end)
-			q = q->next_;
+		if (indexed_) {
+			q = tfirst_start(end);
+			p = tlast_end(start);
+		} else {
+			q = head_;
+			while (q && q->startseq_ < end)
+				q = q->next_;
 
-		p = tail_;
-		while (p && p->endseq_ > start)
-			p = p->prev_;
+			p = tail_;
+			while (p && p->endseq_ > start)
+				p = p->prev_;
+		}
 
 #ifdef notdef
 printf("Thinking of merging (s:%d, e:%d), p:%p (%d,%d), q:%p (%d,%d) into: \n",
@@ -438,6 +639,7 @@ start, end, p, q,
 			if (start < p->startseq_) {
 				total_ += (p->startseq_ - start);
 				p->startseq_ = start;
+				reseq(p);
 			}
 			start = p->endseq_;
 			needmerge = TRUE;
@@ -457,6 +659,7 @@ start, end, p, q,
 			if (end > q->endseq_) {
 				total_ += (end - q->endseq_);
 				q->endseq_ = end;
+				reseq(q);
 			}
 			end = q->startseq_;
 			needmerge = TRUE;
@@ -501,6 +704,8 @@ endfast:
 		n->next_ = q;
 
 		push(n);
+		if (indexed_)
+			tinsert(n, p, q);
 
 		if (p)
 			p->next_ = n;
@@ -567,6 +772,7 @@ dumplist();
 		sremove(q);
 		fremove(q);
 		p->endseq_ = q->endseq_;
+		reseq(p);
 		p->cnt_ += (n->cnt_ + q->cnt_);
 		flags = (p->pflags_ |= n->pflags_);
 		ReassemblyQueue::deleteseginfo(n);
@@ -577,6 +783,7 @@ dumplist();
 		sremove(n);
 		fremove(n);
 		p->endseq_ = n->endseq_;
+		reseq(p);
 		flags = (p->pflags_ |= n->pflags_);
 		p->cnt_ += n->cnt_;
 		ReassemblyQueue::deleteseginfo(n);
@@ -586,6 +793,7 @@ dumplist();
 		sremove(n);
 		fremove(n);
 		q->startseq_ = n->startseq_;
+		reseq(q);
 		flags = (q->pflags_ |= n->pflags_);
 		q->cnt_ += n->cnt_;
 		ReassemblyQueue::deleteseginfo(n);
@@ -618,6 +826,9 @@ ReassemblyQueue::nexthole(TcpSeq seq, int& nxtcnt, int& nxtbytes)
 	hint_ = head_;
 
 	seginfo* p;
+	if (indexed_)
+		// skip the blocks wholly below seq
+		hint_ = tfirst_end(seq);
 	for (p = hint_; p; p = p->next_) {
 		// seq# is prior to SACK region
 		// so seq# is a legit hole
@@ -780,3 +991,66 @@ main()
 }
 #endif
 
+#ifdef RQSTRESS
+#include <time.h>
+
+/*
+ * RQSTRESS: a receiver of npkts 1-byte segments, each lost with
+ * probability lossp/100 and retransmitted later in random order.
+ * Prints a checksum of the add()/gensack()/nexthole() results, which
+ * must be the same with and without the index, and the time taken.
+ */
+static void
+stress(int indexed, int npkts, int lossp)
+{
+	int rcvnxt = 0;
+	ReassemblyQueue rq(rcvnxt);
+	int *lost = new int[npkts];
+	int nlost = 0, sacks[2*3], x, y, i;
+	unsigned int seed = 12345;
+	unsigned long sum = 0;
+	clock_t t0 = clock();
+
+	rq.index(indexed);
+	for (i = 0; i < npkts; i++) {
+		seed = seed * 1103515245 + 12345;
+		if ((seed >> 16) % 100 < (unsigned int) lossp) {
+			lost[nlost++] = i;
+			continue;
+		}
+		sum = sum * 31 + rq.add(i, i + 1, i & 0x3f);
+		sum = sum * 31 + rq.gensack(sacks, 3) + sacks[0];
+		sum = sum * 31 + rq.nexthole(rcvnxt, x, y) + x + y;
+		rq.cleartonxt();
+	}
+	// retransmissions, in random order
+	while (nlost > 0) {
+		seed = seed * 1103515245 + 12345;
+		int k = (seed >> 8) % nlost;
+		sum = sum * 31 + rq.add(lost[k], lost[k] + 1, 0);
+		sum = sum * 31 + rq.nexthole(lost[k] / 2, x, y) + x + y;
+		lost[k] = lost[--nlost];
+		rq.cleartonxt();
+	}
+	sum = sum * 31 + rcvnxt + rq.total();
+	printf("stress index:%d pkts:%d loss:%d%% sum:%lx time:%.3fs\n",
+	    indexed, npkts, lossp, sum,
+	    (double) (clock() - t0) / CLOCKS_PER_SEC);
+	delete[] lost;
+}
+
+int
+main()
+{
+	int npkts[] = { 2000, 20000, 100000 };
+	int lossp[] = { 1, 20, 50 };
+
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++) {
+			if (npkts[i] * lossp[j] <= 20000 * 20)
+				stress(0, npkts[i], lossp[j]);
+			stress(1, npkts[i], lossp[j]);
+		}
+	return (0);
+}
+#endif
@@ -87,6 +87,15 @@ typedef int	RqFlag;		// meta data (owned by ReassemblyQueue)
  * overhead in generating SACK blocks good for HSTCP; see scoreboard-rq
  */ 
 
+/*
+ * With index(1), the FIFO is also kept in a treap (a binary search tree
+ * in sequence # order, balanced by random priorities), whose nodes hold
+ * the block and byte counts of their subtree.  add() and nexthole() then
+ * find their place in O(log n) blocks instead of walking the FIFO, which
+ * matters for receivers holding many disjoint blocks.  The LIFO, and so
+ * gensack(), is the same in both modes.
+ */
+
 class ReassemblyQueue {
 	struct seginfo {
 		seginfo* next_;	// next on FIFO list
@@ -99,11 +108,19 @@ class ReassemblyQueue {
 		TcpFlag	pflags_;	// flags derived from tcp hdr
 		RqFlag	rqflags_;	// book-keeping flags
 		int	cnt_;		// refs to this block
+
+		seginfo* parent_;	// treap links (index mode only)
+		seginfo* left_;
+		seginfo* right_;
+		unsigned int prio_;	// treap priority
+		int	tcnt_;		// # blks in subtree
+		int	tbytes_;	// # bytes in subtree
 	};
 
 public:
 	ReassemblyQueue(TcpSeq& rcvnxt) :
-		head_(NULL), tail_(NULL), top_(NULL), bottom_(NULL), hint_(NULL), total_(0), rcv_nxt_(rcvnxt) { };
+		head_(NULL), tail_(NULL), top_(NULL), bottom_(NULL), hint_(NULL), total_(0),
+		root_(NULL), indexed_(FALSE), seed_(1), rcv_nxt_(rcvnxt) { };
 	int empty() { return (head_ == NULL); }
 	int add(TcpSeq sseq, TcpSeq eseq, TcpFlag pflags, RqFlag rqflags = 0);
 	int maxseq() { return (tail_ ? (tail_->endseq_) : -1); }
@@ -121,6 +138,8 @@ public:
 	    return (clearto(rcv_nxt_));
 	}
 	void dumplist();	// for debugging
+	void index(int);	// turn the treap index on/off
+	int indexed() { return indexed_; }
 
 	// cache of allocated seginfo blocks
 	static seginfo* newseginfo();
@@ -137,6 +156,10 @@ protected:
 	seginfo* hint_;	// hint for nexthole() function
 	int total_;	// # bytes in Reassembly Queue
 
+	seginfo* root_;		// root of the treap (index mode)
+	int indexed_;		// keep the treap?
+	unsigned int seed_;	// for treap priorities
+
 	// rcv_nxt_ is a reference to an externally allocated TcpSeq
 	// (aka integer)that will be updated with the highest in-sequence sequence
 	// number added [plus 1] by the user.  This is the value ordinarily used
@@ -149,6 +172,23 @@ protected:
 	void sremove(seginfo*); // remove from LIFO
 	void push(seginfo*); // add to LIFO
 	void cnts(seginfo *, int&, int&); // byte/blk counts
+
+	// treap (index mode)
+	void tupdate(seginfo*);		// recompute subtree counts
+	void tfix(seginfo* p) {		// ... up to the root
+		for (; p; p = p->parent_)
+			tupdate(p);
+	}
+	void reseq(seginfo* p) {	// after p's start/end seq changed
+		if (indexed_)
+			tfix(p);
+	}
+	void rotate(seginfo*);		// move up over its parent
+	void tinsert(seginfo*, seginfo*, seginfo*); // insert between p, q
+	void tremove(seginfo*);
+	seginfo* tfirst_start(TcpSeq);	// first blk with start >= seq
+	seginfo* tfirst_end(TcpSeq);	// first blk with end >= seq
+	seginfo* tlast_end(TcpSeq);	// last blk with end <= seq
 };
 
 #endif
@@ -68,9 +68,11 @@ int ScoreBoard::UpdateScoreBoard (int last_ack, hdr_tcp* tcph)
 				ASSERT1(length_ >= 0);
 				SBNI.ack_flag_ = 1;
 				SBNI.sack_flag_ = 1;
+				ClearBit(unsacked_, i);
 				if (SBNI.retran_) {
 					SBNI.retran_ = 0;
 					SBNI.snd_nxt_ = 0;
+					ClearBit(retran_, i);
 					retran_decr++;
 				}
 				changed_++;
@@ -83,12 +85,9 @@ int ScoreBoard::UpdateScoreBoard (int last_ack, hdr_tcp* tcph)
 	//  If there is no scoreboard, create one.
 	if (length_ == 0 && tcph->sa_length()) {
 		i = last_ack+1;
-		SBNI.seq_no_ = i;
-		SBNI.ack_flag_ = 0;
-		SBNI.sack_flag_ = 0;
-		SBNI.retran_ = 0;
-		SBNI.snd_nxt_ = 0;
+		NewEntry(i);
 		first_ = i;
+		next_retran_ = i;
 		length_++;
 		if (length_ >= sbsize_) {
 			printf ("Error, scoreboard too large (increase sbsize_ for more space)\n");
@@ -111,11 +110,7 @@ int ScoreBoard::UpdateScoreBoard (int last_ack, hdr_tcp* tcph)
 
 			//  Create new entries
 			for (i = SBN[(first_+length_+sbsize_-1)%sbsize_].seq_no_+1; i<sack_right; i++) {
-				SBNI.seq_no_ = i;
-				SBNI.ack_flag_ = 0;
-				SBNI.sack_flag_ = 0;
-				SBNI.retran_ = 0;
-				SBNI.snd_nxt_ = 0;
+				NewEntry(i);
 				length_++;
 				if (length_ >= sbsize_) {
 					fprintf(stderr, "ERROR: Scoreboard got too large!!!\n");
@@ -127,17 +122,22 @@ int ScoreBoard::UpdateScoreBoard (int last_ack, hdr_tcp* tcph)
 			}
 		}
 		
-		for (i=SBN[(first_)%sbsize_].seq_no_; i<sack_right; i++) {
-			//  Check to see if this segment is now covered by the sack block
-			if (SBNI.seq_no_ >= sack_left && SBNI.seq_no_ < sack_right) {
-				if (! SBNI.sack_flag_) {
-					SBNI.sack_flag_ = 1;
-					changed_++;
-				}
-				if (SBNI.retran_) {
-					SBNI.retran_ = 0;
-					retran_decr++;
-				}
+		//  Mark the segments covered by the sack block, visiting
+		//  only those not sacked yet or retransmitted.
+		i = SBN[(first_)%sbsize_].seq_no_;
+		if (i < sack_left)
+			i = sack_left;
+		for (i = FindNext(SB_PENDING, i, sack_right); i < sack_right;
+		     i = FindNext(SB_PENDING, i+1, sack_right)) {
+			if (! SBNI.sack_flag_) {
+				SBNI.sack_flag_ = 1;
+				ClearBit(unsacked_, i);
+				changed_++;
+			}
+			if (SBNI.retran_) {
+				SBNI.retran_ = 0;
+				ClearBit(retran_, i);
+				retran_decr++;
 			}
 		}
 	}
@@ -152,12 +152,16 @@ int ScoreBoard::CheckSndNxt (hdr_tcp* tcph)
 		sack_left = tcph->sa_left(sack_index);
 		sack_right = tcph->sa_right(sack_index);
 
-		for (i=SBN[(first_)%sbsize_].seq_no_; i<sack_right; i++) {
+		for (i = FindNext(SB_RETRAN, SBN[(first_)%sbsize_].seq_no_, sack_right);
+		     i < sack_right; i = FindNext(SB_RETRAN, i+1, sack_right)) {
 			//  Check to see if this segment's snd_nxt_ is now covered by the sack block
-			if (SBNI.retran_ && SBNI.snd_nxt_ < sack_right) {
+			if (SBNI.snd_nxt_ < sack_right) {
 				// the packet was lost again
 				SBNI.retran_ = 0;
 				SBNI.snd_nxt_ = 0;
+				ClearBit(retran_, i);
+				if (i < next_retran_)
+					next_retran_ = i;
 				force_timeout = 1;
 			}
 		}
@@ -168,6 +172,7 @@ int ScoreBoard::CheckSndNxt (hdr_tcp* tcph)
 void ScoreBoard::ClearScoreBoard()
 {
 	length_ = 0;
+	next_retran_ = 0;
 }
 
 /*
@@ -176,15 +181,14 @@ void ScoreBoard::ClearScoreBoard()
  */
 int ScoreBoard::GetNextRetran()	// Returns sequence number of next pkt...
 {
-	int i;
-
 	if (length_) {
-		for (i=SBN[(first_)%sbsize_].seq_no_; 
-		     i<SBN[(first_)%sbsize_].seq_no_+length_; i++) {
-			if (!SBNI.ack_flag_ && !SBNI.sack_flag_ && !SBNI.retran_) {
-				return (i);
-			}
-		}
+		int first = SBN[(first_)%sbsize_].seq_no_;
+		int end = first + length_;
+
+		next_retran_ = FindNext(SB_HOLE, (next_retran_ > first ?
+		    next_retran_ : first), end);
+		if (next_retran_ < end)
+			return (next_retran_);
 	}
 	return (-1);
 }
@@ -204,11 +208,10 @@ int ScoreBoard::GetNextUnacked (int seqno)
 		seqno >= SBN[(first_)%sbsize_].seq_no_+length_) {
 		return (-1);
 	} else {
-		for (i=seqno; i<SBN[(first_)%sbsize_].seq_no_+length_; i++) {
-			if (!SBNI.ack_flag_ && !SBNI.sack_flag_) {
-				return (i);
-			}
-		}
+		//  The packets in the scoreboard are not acked.
+		i = FindNext(SB_UNSACKED, seqno, SBN[(first_)%sbsize_].seq_no_+length_);
+		if (i < SBN[(first_)%sbsize_].seq_no_+length_)
+			return (i);
 	}
 	return (-1);
 
@@ -218,11 +221,13 @@ void ScoreBoard::MarkRetran (int retran_seqno, int snd_nxt)
 {
 	SBN[retran_seqno%sbsize_].retran_ = 1;
 	SBN[retran_seqno%sbsize_].snd_nxt_ = snd_nxt;
+	SetBit(retran_, retran_seqno);
 }
 
 void ScoreBoard::MarkRetran (int retran_seqno)
 {
 	SBN[retran_seqno%sbsize_].retran_ = 1;
+	SetBit(retran_, retran_seqno);
 }
 
 void ScoreBoard::resizeSB(int sz)
@@ -234,14 +239,75 @@ void ScoreBoard::resizeSB(int sz)
 		exit(1);
 	}
 
-	for(int i = SBN[first_%sbsize_].seq_no_;
-	    i<=SBN[(first_)%sbsize_].seq_no_+length_; i++) {
+	int first = SBN[first_%sbsize_].seq_no_;
+	for(int i = first; i<=first+length_; i++) {
 		newSBN[i%sz] = SBN[i%sbsize_];
 	}
 
 	delete[] SBN;
 	SBN = newSBN;
 	sbsize_ = sz;
+
+	//  Rebuild the bitmaps for the new size.
+	AllocMaps();
+	for(int i = first; i<=first+length_; i++) {
+		if (!SBNI.sack_flag_)
+			SetBit(unsacked_, i);
+		if (SBNI.retran_)
+			SetBit(retran_, i);
+	}
+}
+
+void ScoreBoard::AllocMaps()
+{
+	delete[] unsacked_;
+	delete[] retran_;
+	unsacked_ = retran_ = NULL;
+	if (sbsize_ > 0) {
+		int nwords = (sbsize_ + 63) >> 6;
+		unsacked_ = new uint64_t[nwords];
+		retran_ = new uint64_t[nwords];
+		for (int w = 0; w < nwords; w++)
+			unsacked_[w] = retran_[w] = 0;
+	}
+}
+
+void ScoreBoard::NewEntry(int seqno)
+{
+	ScoreBoardNode& n = SBN[seqno%sbsize_];
+
+	n.seq_no_ = seqno;
+	n.ack_flag_ = 0;
+	n.sack_flag_ = 0;
+	n.retran_ = 0;
+	n.snd_nxt_ = 0;
+	SetBit(unsacked_, seqno);
+	ClearBit(retran_, seqno);
+}
+
+/*
+ * FindNext() returns the first seqno in [from, to) whose bit is set in
+ *   the bitmaps selected by kind, or "to" if there is none.  The range is
+ *   searched a word at a time, in runs of slots that do not wrap around SBN.
+ */
+int ScoreBoard::FindNext(int kind, int from, int to) const
+{
+	while (from < to) {
+		int i = from % sbsize_;
+		int end = i + ((to - from < sbsize_ - i) ? to - from : sbsize_ - i);
+
+		for (int w = i >> 6; (w << 6) < end; w++) {
+			uint64_t m = Word(kind, w);
+			if ((w << 6) < i)
+				m &= ~(uint64_t)0 << (i & 63);
+			if (end - (w << 6) < 64)
+				m &= ((uint64_t)1 << (end - (w << 6))) - 1;
+			if (m)
+				return (from + (w << 6) + __builtin_ctzll(m) - i);
+		}
+		from += end - i;
+	}
+	return (to);
 }
 
 void ScoreBoard::Dump()
@@ -44,6 +44,7 @@
 
 //  Definition of the scoreboard class:
 
+#include <stdint.h>
 #include "tcp.h"
 
 class ScoreBoardNode {
@@ -55,10 +56,18 @@ public:
 	int snd_nxt_;		/* snd_nxt at time of retransmission */
 };
 
+/*
+ * Besides the flags in SBN, two bitmaps indexed like SBN (seqno % sbsize_)
+ *   are kept for the packets in the scoreboard: unsacked_ for the packets
+ *   not SACKed, and retran_ for the packets retransmitted.  The holes to
+ *   retransmit are (unsacked_ & ~retran_); the search for the next one
+ *   starts at the cursor next_retran_, below which there is no hole.
+ */
 class ScoreBoard {
   public:
-	ScoreBoard(ScoreBoardNode* sbn, int sz): first_(0), length_(0), sbsize_(sz), changed_(0),SBN(sbn) {}
-	virtual ~ScoreBoard(){if(SBN) delete[] SBN;}
+	ScoreBoard(ScoreBoardNode* sbn, int sz): first_(0), length_(0), sbsize_(sz), changed_(0),SBN(sbn),
+		unsacked_(NULL), retran_(NULL), next_retran_(0) {AllocMaps();}
+	virtual ~ScoreBoard(){if(SBN) delete[] SBN; delete[] unsacked_; delete[] retran_;}
 	virtual int IsEmpty () {return (length_ == 0);}
 	virtual void ClearScoreBoard (); 
 	virtual int GetNextRetran ();
@@ -75,6 +84,31 @@ class ScoreBoard {
 	int first_, length_, sbsize_, changed_;
 	ScoreBoardNode * SBN; 
 	void resizeSB(int sz);
+
+	// Which packets FindNext() looks for
+	enum { SB_UNSACKED, SB_RETRAN, SB_HOLE, SB_PENDING };
+	uint64_t *unsacked_, *retran_;
+	int next_retran_;
+
+	void AllocMaps();
+	inline void SetBit(uint64_t* map, int seqno) {
+		int i = seqno % sbsize_;
+		map[i >> 6] |= (uint64_t)1 << (i & 63);
+	}
+	inline void ClearBit(uint64_t* map, int seqno) {
+		int i = seqno % sbsize_;
+		map[i >> 6] &= ~((uint64_t)1 << (i & 63));
+	}
+	inline uint64_t Word(int kind, int w) const {
+		switch (kind) {
+		case SB_UNSACKED: return unsacked_[w];
+		case SB_RETRAN: return retran_[w];
+		case SB_HOLE: return unsacked_[w] & ~retran_[w];
+		default: return unsacked_[w] | retran_[w];	// SB_PENDING
+		}
+	}
+	int FindNext(int kind, int from, int to) const;
+	void NewEntry(int seqno);
 };
 
 #endif
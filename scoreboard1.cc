@@ -59,14 +59,82 @@
 #define ASSERT1(x) if (!(x)) {printf ("Assert1 SB (length)\n"); exit(1);}
 #define ASSERT2(x,y...) if (!(x)) {printf(y); exit(1); }
 
+ScoreBoard1::~ScoreBoard1()
+{
+	free(slab_);
+}
+
+// Grow the slab until n nodes are free.  The nodes move, so
+//   nxt_to_retrx_ is carried over by its index.
+void ScoreBoard1::Grow(int n)
+{
+	unsigned int size = size_ ? 2*size_ : SB1_SLAB_MIN;
+	while (size - size_ + nfree_ < (unsigned int)n)
+		size *= 2;
+	ASSERT2((size > size_ && size < SB1_NIL), "SB slab is full, %u nodes\n", size_);
+	unsigned int rtx = nxt_to_retrx_ ? nxt_to_retrx_ - slab_ : SB1_NIL;
+	slab_ = (ScoreBoardNode1*)realloc(slab_, size*sizeof(ScoreBoardNode1));
+	ASSERT2((slab_ != NULL), "SB slab: out of memory\n");
+	for (unsigned int i = size; i > size_; i--) {
+		slab_[i-1].next_in_queue_ = free_;
+		free_ = i-1;
+	}
+	nfree_ += size - size_;
+	size_ = size;
+	nxt_to_retrx_ = node(rtx);
+}
+
+unsigned int ScoreBoard1::NewNode(int start, int end, char flag)
+{
+	ASSERT2((free_ != SB1_NIL), "SB slab: no node reserved\n");
+	unsigned int i = free_;
+	ScoreBoardNode1* n = node(i);
+	free_ = n->next_in_queue_;
+	nfree_--;
+	n->Init(start, end, flag);
+	return i;
+}
+
+void ScoreBoard1::Merge(ScoreBoardNode1* n) 
+{ 
+//merge with the next packet: WARNING: call this function ONLY WHEN you check the validity by Mergable.	
+	unsigned int next = n->next_in_queue_;
+	n->nxt_ = node(next)->nxt_;
+	n->next_in_queue_ = node(next)->next_in_queue_;
+	FreeNode(next);
+}
+
+ScoreBoardNode1* ScoreBoard1::Split(ScoreBoardNode1* n, int seq) 
+{
+// split the current node by the seq; the new node starts is [seq, end of the block]; return the new node
+// WARNING: Make sure it is Splittable before this functionis called.
+	unsigned int i = NewNode(seq, n->nxt_, n->flag_);
+	ScoreBoardNode1* next = node(i);
+	next->next_in_queue_ = n->next_in_queue_;
+	n->next_in_queue_ = i;
+	n->nxt_ = seq-1;
+	return next;
+}
+
+void ScoreBoard1::MarkRetran(ScoreBoardNode1* n, int snd_nxt, int retrans_id) 
+// Mark the first packet of this block as a retransmission packet
+// WARNING: Make sure it is a lost block before calling this function
+{
+	if (n->nxt_ > n->seq_ ) Split(n, n->seq_+1);
+	n->flag_ = SKB_FLAG_RETRANSMITTED; 
+	n->nxt_ = snd_nxt; 
+	n->retran_ = retrans_id; 
+}
+
 bool ScoreBoard1::CleanRtxQueue(int last_ack, unsigned char* flag) 
 {
 	int cmp;
 	bool changed_acked_rtx = false;
+	ScoreBoardNode1* head;
 	//clean the acked packets
-	while ((head_) && ((cmp=head_->ShouldClean(last_ack))!=0)) {
-		int pkt_num = (cmp<0) ? head_->GetLength(): cmp;
-		switch (head_->GetFlag()) {
+	while ((head = node(head_)) && ((cmp=head->ShouldClean(last_ack))!=0)) {
+		int pkt_num = (cmp<0) ? head->GetLength(): cmp;
+		switch (head->GetFlag()) {
 		case SKB_FLAG_SACKED: 
 			sack_out_ -= pkt_num;
 			ASSERT2((sack_out_>=0), "SACK_OUT %d get negative when advancing edge, last_ack %d\n", sack_out_, last_ack);
@@ -79,19 +147,19 @@ bool ScoreBoard1::CleanRtxQueue(int last_ack, unsigned char* flag)
 		//printf("%d: %d %d\n", last_ack, cmp, head_->GetFlag());
 
 		if (cmp<0) {
-			ScoreBoardNode1* tmp=head_;
-			head_=head_->GetNext();
-			if (tmp->GetFlag()==SKB_FLAG_RETRANSMITTED) {
-				if (tmp->GetRtx()>acked_rtx_id_) {
+			unsigned int tmp=head_;
+			head_=head->next_in_queue_;
+			if (head->GetFlag()==SKB_FLAG_RETRANSMITTED) {
+				if (head->GetRtx()>acked_rtx_id_) {
 					changed_acked_rtx = true;
-					acked_rtx_id_ = tmp->GetRtx();
+					acked_rtx_id_ = head->GetRtx();
 				}
 				(*flag) |= FLAG_UNSURE_TSTAMP;
 			}
-			if (tmp == nxt_to_retrx_) nxt_to_retrx_ = head_;
-			delete tmp;
+			if (head == nxt_to_retrx_) nxt_to_retrx_ = node(head_);
+			FreeNode(tmp);
 		} else {
-			head_->SetBegin(last_ack+1);
+			head->SetBegin(last_ack+1);
 			break;
 		}
 	}
@@ -114,9 +182,10 @@ int ScoreBoard1::UpdateScoreBoard (int last_ack, hdr_tcp* tcph, int dupack_thres
 	// However, the lost packets will be marked when there is new SACK come back. 
 	//printf("clean rtx\n");
 	unsigned char flag = 0;
+	Reserve(SB1_UPDATE_NODES);
 	bool thorough = CleanRtxQueue(last_ack, &flag);
 
-	if (head_==NULL) {
+	if (head_==SB1_NIL) {
 		ClearScoreBoard();
 		thorough=false;
 		// if there is no outstanding lost packets, we might not need to do the rest
@@ -154,8 +223,8 @@ int ScoreBoard1::UpdateScoreBoard (int last_ack, hdr_tcp* tcph, int dupack_thres
 	}
 
 	//  If there is no scoreboard, create one.
-	if (head_==NULL) {
-		head_ = new ScoreBoardNode1(last_ack+1, fack_,0);
+	if (head_==SB1_NIL) {
+		head_ = NewNode(last_ack+1, fack_,0);
 		//initially, create a block from snd_una to facked, 
 		//  with flag==0 meaning that packets are in flight
 	};
@@ -166,7 +235,7 @@ int ScoreBoard1::UpdateScoreBoard (int last_ack, hdr_tcp* tcph, int dupack_thres
 
 //	printf("start traverse\n");
 	int lost_seq_threshold = fack_ - (dupack_threshold+1);
-	ScoreBoardNode1* now = head_;	// the block we are processing
+	ScoreBoardNode1* now = node(head_);	// the block we are processing
 	ScoreBoardNode1* prev = NULL;
 	int sack_index = 0;	//the sack that is currently focused 
 	while ((now != NULL) && ((sack_index<sa_length)||thorough)) {
@@ -181,12 +250,12 @@ int ScoreBoard1::UpdateScoreBoard (int last_ack, hdr_tcp* tcph, int dupack_thres
 					if (left[sack_index]>now->GetStart()) {
 						//printf("split to make some sackes\n");
 						// the first part of "now" is not SACKED
-						now->Split(left[sack_index]);
+						Split(now, left[sack_index]);
 					} else {
 						if (right[sack_index]<=now->GetEnd()) {
 							//partially sacked
 							//printf("going to split\n");
-							now->Split(right[sack_index]);
+							Split(now, right[sack_index]);
 							//printf("done split\n");
 						};
 						int pktnum = now->GetLength();
@@ -226,7 +295,7 @@ int ScoreBoard1::UpdateScoreBoard (int last_ack, hdr_tcp* tcph, int dupack_thres
 					//some packets might be lost
 						if (lost_seq_threshold<now->GetEnd()) {
 							//partial loss
-							now->Split(lost_seq_threshold+1);
+							Split(now, lost_seq_threshold+1);
 						}
 						now->SetFlag(SKB_FLAG_LOST);
 						fack_out_ += now->GetLength();
@@ -242,20 +311,20 @@ int ScoreBoard1::UpdateScoreBoard (int last_ack, hdr_tcp* tcph, int dupack_thres
 		}
 //printf("now block: %d[%d %d]\n", now->GetFlag(),now->GetStart(), now->GetEnd());
 
-		if ((prev) && (prev->Mergable())) {
+		if ((prev) && (Mergable(prev))) {
 			//Try to merge with previous node
 			//printf("Merging %d [%d,%d] + %d [%d, %d]\n", prev->GetFlag(), prev->GetStart(), prev->GetEnd(), now->GetFlag(), now->GetStart(), now->GetEnd());
-			prev->Merge();
+			Merge(prev);
 		} else {
 			prev = now;
 		}
 
-		if ((prev->GetNext()==NULL) && (prev->GetEnd()<fack_)) {
+		if ((prev->next_in_queue_==SB1_NIL) && (prev->GetEnd()<fack_)) {
 			//printf("appending %d %d\n",prev->GetEnd()+1, fack_);
-			prev->Append(new ScoreBoardNode1(prev->GetEnd()+1, fack_,0));
+			prev->next_in_queue_ = NewNode(prev->GetEnd()+1, fack_,0);
 			//extend the scoreboard
 		}
-		now = prev -> GetNext();
+		now = Next(prev);
 	};
 
 	return (flag);
@@ -263,8 +332,9 @@ int ScoreBoard1::UpdateScoreBoard (int last_ack, hdr_tcp* tcph, int dupack_thres
 }
 
 void ScoreBoard1::MarkLoss(int snd_una, int snd_nxt) {
+	Reserve(1);
 	nxt_to_retrx_ = NULL;
-	ScoreBoardNode1* now = head_;
+	ScoreBoardNode1* now = node(head_);
 	ScoreBoardNode1* prev = NULL;
 	bool last_lost = false;
 	while (now) {
@@ -273,7 +343,7 @@ void ScoreBoard1::MarkLoss(int snd_una, int snd_nxt) {
 				fack_out_ += now->GetEnd() - now->GetStart() + 1;
 			now->SetFlag(SKB_FLAG_LOST);
 			if (last_lost) {
-				prev->Merge();
+				Merge(prev);
 				now=prev;
 			} else {
 				if (nxt_to_retrx_==NULL) nxt_to_retrx_ = now;
@@ -283,17 +353,17 @@ void ScoreBoard1::MarkLoss(int snd_una, int snd_nxt) {
 			last_lost = false;
 		}
 		prev = now;
-		now = now->GetNext();
+		now = Next(now);
 		if ((now==NULL) && ((prev->GetEnd()+1) < snd_nxt)) {
 			//all the packets that we sent have lost
-			now = new ScoreBoardNode1(prev->GetEnd()+1, snd_nxt-1, SKB_FLAG_INFLIGHT);
-			prev->Append(now);
+			prev->next_in_queue_ = NewNode(prev->GetEnd()+1, snd_nxt-1, SKB_FLAG_INFLIGHT);
+			now = Next(prev);
 		}
 	}
 	if ((prev==NULL) && (snd_una<snd_nxt)) {
 		//the score board is empty
-		head_ = new ScoreBoardNode1(snd_una, snd_nxt-1, SKB_FLAG_LOST);
-		nxt_to_retrx_ = head_;
+		head_ = NewNode(snd_una, snd_nxt-1, SKB_FLAG_LOST);
+		nxt_to_retrx_ = node(head_);
 		fack_out_ += snd_nxt - snd_una;
 	}
 	rtx_id_ = 0;
@@ -308,10 +378,10 @@ void ScoreBoard1::ClearScoreBoard()
         sack_out_ = 0;
 	fack_ = 0;
 	nxt_to_retrx_ = NULL;
-	while (head_) {
-		ScoreBoardNode1* temp = head_;
-		head_ = head_->GetNext();
-		delete temp;
+	while (head_ != SB1_NIL) {
+		unsigned int temp = head_;
+		head_ = node(head_)->next_in_queue_;
+		FreeNode(temp);
 	}
 }
 
@@ -322,7 +392,7 @@ void ScoreBoard1::ClearScoreBoard()
 int ScoreBoard1::GetNextRetran()
 {
 	while ((nxt_to_retrx_) && (nxt_to_retrx_->GetFlag() != SKB_FLAG_LOST))
-		nxt_to_retrx_ = nxt_to_retrx_->GetNext();
+		nxt_to_retrx_ = Next(nxt_to_retrx_);
 	if (nxt_to_retrx_) {
 		return nxt_to_retrx_->GetStart();
 	} else
@@ -331,10 +401,11 @@ int ScoreBoard1::GetNextRetran()
 
 void ScoreBoard1::MarkRetran (int retran_seqno, int snd_nxt)
 {
+	Reserve(1);
 	ASSERT2(((nxt_to_retrx_) && (nxt_to_retrx_->Inside(retran_seqno))), "Trying to mark a retransmission outside the recommended one: %p %d, snd_nxt: %d\n", nxt_to_retrx_, retran_seqno, snd_nxt);
 	fack_out_ --;
 	ASSERT2((fack_out_>=0), "fack_out gets negative in Mark Retran, %d, snd_nxt: %d, rtx_seq:%d\n", fack_out_, snd_nxt, retran_seqno);
-	nxt_to_retrx_->MarkRetran(snd_nxt, rtx_id_);
+	MarkRetran(nxt_to_retrx_, snd_nxt, rtx_id_);
 	rtx_id_++;
 	last_rtx_seq_=retran_seqno;
 }
@@ -342,10 +413,10 @@ void ScoreBoard1::MarkRetran (int retran_seqno, int snd_nxt)
 
 void ScoreBoard1::Dump()
 {
-       if (head_ == NULL ) { printf("SB: No entry\n"); return; };
+       if (head_ == SB1_NIL ) { printf("SB: No entry\n"); return; };
 
        printf("SB len:%d fack:%d sack_out:%d fack_out:%d acked_rtx_id:%d next_rtx_id:%d\n", 
-		fack_-head_->GetStart(), 
+		fack_-node(head_)->GetStart(), 
 		fack_, 
 		sack_out_,
 		fack_out_,
@@ -353,13 +424,13 @@ void ScoreBoard1::Dump()
 		rtx_id_
 	);
 
-	ScoreBoardNode1* now=head_;
+	ScoreBoardNode1* now=node(head_);
 	while (now) {
 		if (now->GetFlag()==SKB_FLAG_RETRANSMITTED) 
 			printf("seq:%d (%d snd_nxt:%d rtxid:%d)\n", now->GetStart(), now->GetFlag(), now->GetSndNxt(), now->GetRtx());
 		else
 			printf("seq:[%d,%d] (%d)\n", now->GetStart(), now->GetEnd(), now->GetFlag());
-		now=now->GetNext();
+		now=Next(now);
        }
        printf("\n");
 }
@@ -469,3 +540,201 @@ void ScoreBoard1::test()
 
 	UpdateScoreBoard(3, &test); Dump();
 }
+
+#ifdef SB1BENCH
+#include <time.h>
+
+/*
+ * SB1BENCH: a SACK sender with a window of wnd packets sends one packet
+ * per tick over a path of rtt ticks, which drops each packet (and each
+ * retransmission) with probability lossp/100.  The receiver reports up
+ * to NSA SACK blocks, the newest first.  The scoreboard calls of the
+ * sender are logged once, then replayed into fresh scoreboards and timed.
+ * Prints a checksum of the results of the calls, which must not depend on
+ * how the nodes are allocated, and the time per call.
+ * Build with g++ -O2 -DSB1BENCH (with the ns include flags) scoreboard1.cc.
+ */
+enum { SB_UPDATE, SB_NEXT, SB_RETRAN, SB_LOSS };
+
+struct sb_op {
+	int type;
+	int a, b;
+	int nsack;
+	int sack[NSA][2];
+};
+
+static sb_op* ops;
+static int nops, maxops;
+
+static sb_op*
+sb_log(int type, int a, int b)
+{
+	if (nops == maxops) {
+		maxops = maxops ? 2*maxops : 4096;
+		ops = (sb_op*)realloc(ops, maxops*sizeof(sb_op));
+	}
+	sb_op* op = &ops[nops++];
+	op->type = type;
+	op->a = a;
+	op->b = b;
+	op->nsack = 0;
+	return op;
+}
+
+// the block of received packets around seq, [l, r)
+static void
+sb_block(const char* rcvd, int cum, int seq, int* l, int* r)
+{
+	for (*l = seq; *l - 1 > cum && rcvd[*l - 1]; (*l)--)
+		;
+	for (*r = seq + 1; rcvd[*r]; (*r)++)
+		;
+}
+
+static void
+sb_simulate(int npkts, int wnd, int rtt, int lossp)
+{
+	ScoreBoard1 sb;
+	hdr_tcp h;
+	char* rcvd = (char*)calloc(npkts + 1, 1);
+	int* arrive = (int*)malloc(rtt*sizeof(int));
+	int recent[NSA], nrecent = 0;
+	int highest_ack = -1, snd_nxt = 0, cum = -1, last_progress = 0;
+	unsigned int seed = 12345;
+	int t, i, j;
+
+	nops = 0;
+	for (i = 0; i < rtt; i++)
+		arrive[i] = -1;
+	for (t = 0; highest_ack < npkts - 1; t++) {
+		int slot = t % rtt;
+		int seq = arrive[slot];
+
+		arrive[slot] = -1;
+		if (seq >= 0) {
+			// the receiver
+			rcvd[seq] = 1;
+			while (cum + 1 < npkts && rcvd[cum + 1])
+				cum++;
+			sb_op* op = sb_log(SB_UPDATE, cum, 0);
+			int n = 0, l, r;
+			if (seq > cum) {
+				if (nrecent == NSA) {
+					for (i = 1; i < NSA; i++)
+						recent[i - 1] = recent[i];
+					nrecent--;
+				}
+				recent[nrecent++] = seq;
+			}
+			// the newest block first
+			for (i = nrecent - 1; i >= 0 && n < NSA; i--) {
+				if (recent[i] <= cum)
+					continue;
+				sb_block(rcvd, cum, recent[i], &l, &r);
+				for (j = 0; j < n && op->sack[j][0] != l; j++)
+					;
+				if (j == n) {
+					op->sack[n][0] = l;
+					op->sack[n][1] = r;
+					n++;
+				}
+			}
+			op->nsack = n;
+			// keep the reported blocks, the newest last
+			nrecent = 0;
+			for (i = n - 1; i >= 0; i--)
+				recent[nrecent++] = op->sack[i][0];
+			// the sender
+			if (cum > highest_ack) {
+				highest_ack = cum;
+				last_progress = t;
+			}
+			h.sa_length() = n;
+			for (i = 0; i < n; i++) {
+				h.sa_left(i) = op->sack[i][0];
+				h.sa_right(i) = op->sack[i][1];
+			}
+			sb.UpdateScoreBoard(highest_ack, &h);
+		}
+		if (t - last_progress > 4*rtt) {
+			// retransmission timeout
+			sb_log(SB_LOSS, highest_ack + 1, snd_nxt);
+			sb.MarkLoss(highest_ack + 1, snd_nxt);
+			last_progress = t;
+		}
+		if (sb.packets_in_flight(highest_ack + 1, snd_nxt) >= wnd)
+			continue;
+		int x = sb.GetNextRetran();
+		if (x >= 0) {
+			sb_log(SB_RETRAN, x, snd_nxt);
+			sb.MarkRetran(x, snd_nxt);
+		} else {
+			sb_log(SB_NEXT, 0, 0);
+			if (snd_nxt < npkts)
+				x = snd_nxt++;
+		}
+		seed = seed * 1103515245 + 12345;
+		if (x >= 0 && (seed >> 16) % 100 >= (unsigned int) lossp)
+			arrive[slot] = x;
+	}
+	free(rcvd);
+	free(arrive);
+}
+
+static unsigned long
+sb_replay()
+{
+	ScoreBoard1 sb;
+	hdr_tcp h;
+	unsigned long sum = 0;
+
+	for (int k = 0; k < nops; k++) {
+		sb_op* op = &ops[k];
+		switch (op->type) {
+		case SB_UPDATE:
+			h.sa_length() = op->nsack;
+			for (int i = 0; i < op->nsack; i++) {
+				h.sa_left(i) = op->sack[i][0];
+				h.sa_right(i) = op->sack[i][1];
+			}
+			sum = sum * 31 + sb.UpdateScoreBoard(op->a, &h);
+			sum = sum * 31 + sb.FackOut() + sb.SackOut() + sb.fack();
+			break;
+		case SB_NEXT:
+			sum = sum * 31 + sb.GetNextRetran();
+			break;
+		case SB_RETRAN:
+			sum = sum * 31 + sb.GetNextRetran();
+			sb.MarkRetran(op->a, op->b);
+			break;
+		case SB_LOSS:
+			sb.MarkLoss(op->a, op->b);
+			sum = sum * 31 + sb.FackOut();
+			break;
+		}
+	}
+	return sum;
+}
+
+int
+main()
+{
+	int wnd[] = { 100, 1000, 1000, 10000 };
+	int lossp[] = { 1, 1, 5, 1 };
+	int rounds = 10;
+
+	for (int i = 0; i < 4; i++) {
+		sb_simulate(200000, wnd[i], wnd[i], lossp[i]);
+		unsigned long sum = 0;
+		clock_t t0 = clock();
+		for (int r = 0; r < rounds; r++)
+			sum = sb_replay();
+		double secs = (double) (clock() - t0) / CLOCKS_PER_SEC;
+		printf("sb1bench wnd:%d loss:%d%% calls:%d sum:%lx time:%.3fs (%.1f ns/call)\n",
+		    wnd[i], lossp[i], nops, sum, secs / rounds,
+		    secs * 1e9 / rounds / nops);
+	}
+	free(ops);
+	return (0);
+}
+#endif
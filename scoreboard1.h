@@ -60,14 +60,24 @@
 #define SKB_FLAG_LOST 2			/* lost by FACK signal */
 #define SKB_FLAG_RETRANSMITTED 4	/* in flight, but is retransmitted packets */
 
+/*
+ * The nodes of a scoreboard live in the scoreboard's slab (see
+ *   ScoreBoard1::node()), and are linked by their 32-bit index in it
+ *   instead of a pointer, so a node takes 20 bytes.  The link and the flag
+ *   are not packed in one word: masking the link on every step of a walk
+ *   costs more than the 4 bytes save.
+ */
+#define SB1_NIL 0xffffffff		/* end of list */
+
 class ScoreBoardNode1 {
 public:
-	ScoreBoardNode1(int start, int end, char flag):
-		flag_(flag),
-		seq_(start),
-		nxt_(end),
-		next_in_queue_(NULL)
-	{}
+	inline void Init(int start, int end, char flag) {
+		flag_ = flag;
+		seq_ = start;
+		nxt_ = end;
+		retran_ = 0;
+		next_in_queue_ = SB1_NIL;
+	}
 	inline char GetFlag() { return flag_; }
 
 	inline int GetStart() { return seq_; }
@@ -77,7 +87,6 @@ public:
 	inline int GetSndNxt() { return nxt_; }
 	inline void SetFlag(char flag) { if (flag_==SKB_FLAG_RETRANSMITTED) nxt_=seq_; flag_ = flag;}
 	inline void SetBegin(int seq) { seq_=seq; }
-	inline void Append(ScoreBoardNode1* next) {next_in_queue_ = next;}
 	inline bool Inside(int seq) { return (flag_==SKB_FLAG_RETRANSMITTED)?(seq==seq_):((seq>=seq_) && (seq<=nxt_)); }
 //        inline int Compare(int seq) { if (flag_==SKB_FLAG_RETRANSMITTED) return (seq-seq_); else if (seq<seq_) return -1; else if (seq>nxt_) return 1; else return 0;}
 	inline int ShouldClean(int ackseq) 
@@ -90,47 +99,12 @@ public:
 		else return ackseq+1-seq_;
 	}
 
-	inline ScoreBoardNode1* GetNext() { return next_in_queue_; }
-
-	inline bool Mergable() { return ((next_in_queue_) && (next_in_queue_->flag_!=SKB_FLAG_RETRANSMITTED) && (next_in_queue_->flag_ == flag_)); }
-	//to check if the next packet can be merged to this packet
-
-	void Merge() 
-	{ 
-	//merge with the next packet: WARNING: call this function ONLY WHEN you check the validity by Mergable.	
-		ScoreBoardNode1* next = next_in_queue_;
-		nxt_ = next->nxt_;
-		next_in_queue_ = next->next_in_queue_;
-		delete next;
-	}
-
-
 	inline bool Splittable(int seq) { return (flag_!=SKB_FLAG_RETRANSMITTED) && (seq>seq_) && (seq<=nxt_);}
 	//to check if a node can be split from seq.
 
-	ScoreBoardNode1* Split(int seq) 
-	{
-	// split the current node by the seq; the new node starts is [seq, end of the block]; return the new node
-	// WARNING: Make sure it is Splittable before this functionis called.
-		ScoreBoardNode1* next = new ScoreBoardNode1(seq, nxt_, flag_);
-		next->next_in_queue_ = next_in_queue_;
-		next_in_queue_ = next;
-		nxt_ = seq-1;
-		return next;
-	}
-
-	void MarkRetran(int snd_nxt, int retrans_id) 
-	// Mark the first packet of this block as a retransmission packet
-	// WARNING: Make sure it is a lost block before calling this function
-	{
-		if (nxt_ > seq_ ) Split(seq_+1);
-		flag_ = SKB_FLAG_RETRANSMITTED; 
-		nxt_ = snd_nxt; 
-		retran_ = retrans_id; 
-	}
-
 private:
-	char flag_; 
+	friend class ScoreBoard1;
+
 	int seq_;		/* Packet number */
 	int nxt_;		
 	/* This member has two different meanings: 
@@ -140,15 +114,27 @@ private:
 	int retran_;  /* Packet retransmitted or not. If retran_ == 0: not retransmitted, if retran_>0, it's the rtx_id_ when it is retransmitted. */
 	/* the combination of (retran_, snd_nxt_) can detect the loss of retransmitted packet in an accurate way */
 //	double when;		//We don't have head timeout yet
-	ScoreBoardNode1* next_in_queue_;
+	unsigned int next_in_queue_;	/* index of the next node, or SB1_NIL */
+	unsigned char flag_;
 };
 
+/*
+ * The slab is one array of nodes, which doubles when it runs out.
+ *   Released nodes go to a free list and are reused by the next
+ *   allocation; the slab is only freed with the scoreboard.
+ * Growing the slab moves the nodes, so each public method first reserves
+ *   the nodes it may take (Reserve()), and only nxt_to_retrx_ is kept
+ *   across a Grow().
+ */
+#define SB1_SLAB_MIN 256			/* initial size (4KB) */
+#define SB1_UPDATE_NODES (2*(NSA+1) + 3)	/* most nodes one update takes */
 
 class ScoreBoard1 {
   public:
-	ScoreBoard1(): head_(NULL), last_rtx_seq_(-1) {ClearScoreBoard();} 
-	virtual ~ScoreBoard1(){ClearScoreBoard ();}
-	virtual int IsEmpty () {return (head_ == NULL);}
+	ScoreBoard1(): head_(SB1_NIL), last_rtx_seq_(-1), slab_(NULL), 
+		size_(0), nfree_(0), free_(SB1_NIL) {ClearScoreBoard();} 
+	virtual ~ScoreBoard1();
+	virtual int IsEmpty () {return (head_ == SB1_NIL);}
 	virtual void ClearScoreBoard (); 
 	virtual int GetNextRetran ();
 	virtual void Dump();
@@ -167,7 +153,31 @@ class ScoreBoard1 {
   protected:
 	bool CleanRtxQueue(int last_ack, unsigned char* flag);
 
-	ScoreBoardNode1* head_;
+	// the slab
+	inline ScoreBoardNode1* node(unsigned int i) {
+		return (i == SB1_NIL) ? NULL : &slab_[i];
+	}
+	inline ScoreBoardNode1* Next(ScoreBoardNode1* n) { return node(n->next_in_queue_); }
+	unsigned int NewNode(int start, int end, char flag);
+	inline void FreeNode(unsigned int i) {
+		node(i)->next_in_queue_ = free_;
+		free_ = i;
+		nfree_++;
+	}
+	inline void Reserve(int n) { if (nfree_ < n) Grow(n); }
+	void Grow(int n);
+
+	// list operations (formerly in ScoreBoardNode1)
+	inline bool Mergable(ScoreBoardNode1* n) {
+		ScoreBoardNode1* next = Next(n);
+		return ((next) && (next->flag_!=SKB_FLAG_RETRANSMITTED) && (next->flag_ == n->flag_));
+	}
+	//to check if the next packet can be merged to this packet
+	void Merge(ScoreBoardNode1* n);
+	ScoreBoardNode1* Split(ScoreBoardNode1* n, int seq);
+	void MarkRetran(ScoreBoardNode1* n, int snd_nxt, int retrans_id);
+
+	unsigned int head_;		// index of the first node
 	ScoreBoardNode1* nxt_to_retrx_;
 	//the next packet to be retransmitted. if nxt_to_retrx_==NULL: no packet can be retransmitted.
 
@@ -178,6 +188,10 @@ class ScoreBoard1 {
 	int sack_out_;		//# of packets that are in the scoreboard, which are sacked.
 	int last_rtx_seq_;	// the seqno that we cleaned scoreboard last time. 
 
+	ScoreBoardNode1* slab_;
+	unsigned int size_;		// nodes in the slab
+	int nfree_;			// nodes in the free list
+	unsigned int free_;		// head of the free list
 };
 
 #endif
@@ -68,7 +68,8 @@ public:
 Snoop::Snoop() : NsObject(),
 	fstate_(0), lastSeen_(-1), lastAck_(-1), 
 	expNextAck_(0), expDupacks_(0), bufhead_(0), 
-	toutPending_(0), buftail_(0),
+	toutPending_(0), buftail_(0), pkts_(0), nbufs_(0), ncached_(0),
+	cachedBytes_(0), maxCached_(0), hits_(0), misses_(0), evictions_(0),
 	wl_state_(SNOOP_WLEMPTY), wl_lastSeen_(-1), wl_lastAck_(-1), 
 	wl_bufhead_(0), wl_buftail_(0)
 {
@@ -85,14 +86,36 @@ Snoop::Snoop() : NsObject(),
 	rxmitHandler_ = new SnoopRxmitHandler(this);
 
 	int i;
-	for (i = 0; i < SNOOP_MAXWIND; i++) /* data from wired->wireless */
-		pkts_[i] = 0;
 	for (i = 0; i < SNOOP_WLSEQS; i++) {/* data from wireless->wired */
 		wlseqs_[i] = (hdr_seq *) malloc(sizeof(hdr_seq));
 		wlseqs_[i]->seq = wlseqs_[i]->num = 0;
 	}
-	if (maxbufs_ == 0)
+	allocbufs_();		/* data from wired->wireless */
+}
+
+Snoop::~Snoop()
+{
+	reset();
+	delete [] pkts_;
+	delete rxmitHandler_;
+	for (int i = 0; i < SNOOP_WLSEQS; i++)
+		free(wlseqs_[i]);
+}
+
+/*
+ * (Re)size the cache to maxbufs_ pkt bufs.  The cache must be empty.
+ */
+void
+Snoop::allocbufs_()
+{
+	if (maxbufs_ <= 0)
 		maxbufs_ = SNOOP_MAXWIND;
+	delete [] pkts_;
+	nbufs_ = maxbufs_;
+	pkts_ = new Packet*[nbufs_];
+	for (int i = 0; i < nbufs_; i++)
+		pkts_[i] = 0;
+	bufhead_ = buftail_ = 0;
 }
 
 void
@@ -104,18 +127,14 @@ Snoop::reset()
 	lastAck_ = -1;
 	expNextAck_ = 0;
 	expDupacks_ = 0;
-	bufhead_ = buftail_ = 0;
 	if (toutPending_) {
 		Scheduler::instance().cancel(toutPending_);
-		// xxx: I think that toutPending_ doesn't need to be freed because snoop didn't allocate it (but I'm not sure).
 		toutPending_ = 0;
 	};
-	for (int i = 0; i < SNOOP_MAXWIND; i++) {
-		if (pkts_[i]) {
-			Packet::free(pkts_[i]);
-			pkts_[i] = 0;
-		}
-	}
+	for (int seq = buftail_; ncached_ > 0 && seq < bufhead_; seq++)
+		if (cached(seq))
+			freepkt_(seq);
+	bufhead_ = buftail_ = 0;
 }
 
 void 
@@ -132,8 +151,17 @@ Snoop::wlreset()
 int 
 Snoop::command(int argc, const char*const* argv)
 {
-	//Tcl& tcl = Tcl::instance();
-
+	Tcl& tcl = Tcl::instance();
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "cache-stats") == 0) {
+			tcl.resultf("nbufs %d cached %d bytes %d maxcached %d "
+				    "hits %d misses %d evictions %d",
+				    nbufs_, ncached_, cachedBytes_, maxCached_,
+				    hits_, misses_, evictions_);
+			return (TCL_OK);
+		}
+	}
 	if (argc == 3) {
 		if (strcmp(argv[1], "llsnoop") == 0) {
 			parent_ = (LLSnoop *) TclObject::lookup(argv[2]);
@@ -148,7 +176,7 @@ Snoop::command(int argc, const char*const* argv)
 				return (TCL_OK);
 			}
 
-			Packet *p = pkts_[buftail_];
+			Packet *p = pkts_[buftail_ % nbufs_];
 			hdr_snoop *sh = hdr_snoop::access(p);
 
 			if (sh->sndTime()!=-1 && sh->sndTime()<atoi(argv[2]) &&
@@ -268,6 +296,8 @@ Snoop::snoop_data(Packet *p)
 	if (fstate_ & SNOOP_ALIVE && seq == 0)
 		reset();
 	fstate_ |= SNOOP_ALIVE;
+	if (nbufs_ != maxbufs_ && empty_())
+		allocbufs_();
 	if ((fstate_ & SNOOP_FULL) && !lru_) {
 //		printf("snoop full, fwd'ing\n t %d h %d", buftail_, bufhead_);
 		if (seq > lastSeen_)
@@ -283,20 +313,19 @@ Snoop::snoop_data(Packet *p)
 		resetPending = snoop_insert(p);
 	if (toutPending_ && resetPending == SNOOP_TAIL) {
 		s.cancel(toutPending_);
-		// xxx: I think that toutPending_ doesn't need to be freed because snoop didn't allocate it (but I'm not sure).
 		toutPending_ = 0;
 	}
 	if (!toutPending_ && !empty_()) {
-		toutPending_ = (Event *) (pkts_[buftail_]);
+		toutPending_ = &rxmitEvent_;
 		s.schedule(rxmitHandler_, toutPending_, timeout());
 	}
 	return;
 }
 
 /* 
- * snoop_insert() does all the hard work for snoop_data(). It traverses the 
- * snoop cache and looks for the right place to insert this packet (or
- * determines if its already been cached). It then decides whether
+ * snoop_insert() does all the hard work for snoop_data(). It looks up
+ * this packet in the snoop cache (by its sequence number), and caches
+ * it if it is not there yet and fits. It then decides whether
  * this is a packet in the normal increasing sequence, whether it
  * is a sender-rexmitted-but-lost-due-to-congestion (or network 
  * out-of-order) packet, or if it is a sender-rexmitted packet that
@@ -305,63 +334,55 @@ Snoop::snoop_data(Packet *p)
 int
 Snoop::snoop_insert(Packet *p)
 {
-
-
-
-	int i, seq = hdr_tcp::access(p)->seqno(), retval=0;
+	int seq = hdr_tcp::access(p)->seqno(), retval=0;
 
 	if (seq <= lastAck_) 
 		return retval;
-	
-	if (fstate_ & SNOOP_FULL) {
-		/* free tail and go on */
-		printf("snoop full, making room\n");
-		Packet::free(pkts_[buftail_]);
-		pkts_[buftail_] = 0;
-		buftail_ = next(buftail_);
-		fstate_ |= ~SNOOP_FULL;
-	}
 
-	if (seq > lastSeen_ || pkts_[buftail_] == 0) { // in-seq or empty cache
-		i = bufhead_;
-		bufhead_ = next(bufhead_);
-	} else if (seq < hdr_snoop::access(pkts_[buftail_])->seqno()) {
-		buftail_ = prev(buftail_);
-		i = buftail_;
-	} else {
-		for (i = buftail_; i != bufhead_; i = next(i)) {
-			hdr_snoop *sh = hdr_snoop::access(pkts_[i]);
-			if (sh->seqno() == seq) {  // cached before
-
-				sh->numRxmit() = 0;
-				sh->senderRxmit() = 1; //must be a sender retr
-				sh->sndTime() = Scheduler::instance().clock();
-				return SNOOP_TAIL;
-			} else if (sh->seqno() > seq) { 
-
-				//not cached before, should insert in the middle
-				// find the position it should be: prev(i)
- 
-				Packet *temp = pkts_[prev(buftail_)];
-				for (int j = buftail_; j != i; j = next(j)) 
-					pkts_[prev(j)] = pkts_[j];
-				i = prev(i);
-				pkts_[i] = temp;   // seems not necessary. Ben comments
-				buftail_ = prev(buftail_);
-				break;
-			}
-		}
+	if (!empty_()) {
+		hdr_snoop *sh = cached(seq) ? hdr_snoop::access(cached(seq)) : 0;
 
-		// This should not happen, since seq must be > lastSeen, which is 
-		// handled before in the first if.   Ben comments
-		if (i == bufhead_)
-			bufhead_ = next(bufhead_);
+		if (seq <= lastSeen_) {
+			if (sh)
+				hits_++;
+			else
+				misses_++;
+		}
+		if (sh) {	// cached before
+			sh->numRxmit() = 0;
+			sh->senderRxmit() = 1; //must be a sender retr
+			sh->sndTime() = Scheduler::instance().clock();
+			return SNOOP_TAIL;
+		}
+		if (seq >= buftail_ + nbufs_) {
+			if (!lru_) {
+				/* no room, forward it uncached */
+				fstate_ |= SNOOP_FULL;
+				if (seq > lastSeen_)
+					lastSeen_ = seq;
+				return retval;
+			}
+			/* free the tail and go on */
+			while (ncached_ > 0 && seq >= buftail_ + nbufs_) {
+				freepkt_(buftail_);
+				evictions_++;
+				while (buftail_ < bufhead_ && !cached(buftail_))
+					buftail_++;
+			}
+		} else if (seq < bufhead_ - nbufs_)
+			/* an old seqno that does not fit any more */
+			return retval;
 	}
-	
+	if (empty_())
+		buftail_ = bufhead_ = seq;
+
 	// save in the buffer
-	savepkt_(p, seq, i);
-	
-	if (bufhead_ == buftail_)
+	savepkt_(p, seq);
+	if (seq < buftail_)
+		buftail_ = seq;
+	if (seq >= bufhead_)
+		bufhead_ = seq + 1;
+	if (bufhead_ - buftail_ >= nbufs_)
 		fstate_ |= SNOOP_FULL;
 	/* 
 	 * If we have one of the following packets:
@@ -374,8 +395,8 @@ Snoop::snoop_insert(Packet *p)
 	 * for this packet go through according to expDupacks_.
 	 */
 	if (seq < lastSeen_) { /* not in-order -- XXX should it be <= ? */
-		if (buftail_ == i) {
-			hdr_snoop *sh = hdr_snoop::access(pkts_[i]);
+		if (buftail_ == seq) {
+			hdr_snoop *sh = hdr_snoop::access(pkts_[seq % nbufs_]);
 			sh->senderRxmit() = 1;
 			sh->numRxmit() = 0;
 		}
@@ -387,16 +408,35 @@ Snoop::snoop_insert(Packet *p)
 	return retval;
 }
 
+/*
+ * Cache a reference to p, which is sent on.  The lower layers may
+ *   change the size and ttl in its (shared) headers, so these are
+ *   saved here and restored in snoop_rxmit().
+ */
 void
-Snoop::savepkt_(Packet *p, int seq, int i)
+Snoop::savepkt_(Packet *p, int seq)
 {
-	pkts_[i] = p->copy();
-	Packet *pkt = pkts_[i];
+	Packet *pkt = pkts_[seq % nbufs_] = p->refcopy();
 	hdr_snoop *sh = hdr_snoop::access(pkt);
 	sh->seqno() = seq;
 	sh->numRxmit() = 0;
 	sh->senderRxmit() = 0;
 	sh->sndTime() = Scheduler::instance().clock();
+	sh->size() = HDR_CMN(pkt)->size();
+	sh->ttl() = HDR_IP(pkt)->ttl();
+	cachedBytes_ += sh->size();
+	if (++ncached_ > maxCached_)
+		maxCached_ = ncached_;
+}
+
+void
+Snoop::freepkt_(int seq)
+{
+	Packet *pkt = pkts_[seq % nbufs_];
+	cachedBytes_ -= hdr_snoop::access(pkt)->size();
+	ncached_--;
+	Packet::free(pkt);
+	pkts_[seq % nbufs_] = 0;
 }
 
 /*
@@ -430,16 +470,15 @@ Snoop::snoop_ack(Packet *p)
 	if (lastAck_ == ack) {	
 		/* A duplicate ack; pure window updates don't occur in ns. */
 
-		pkt = pkts_[buftail_];
-		
-		if (pkt == 0) 
-			return SNOOP_PROPAGATE;
-		
-		hdr_snoop *sh = hdr_snoop::access(pkt);
+		pkt = cached(ack + 1);
 
-		if (pkt == 0 || sh->seqno() > ack + 1) 
+		if (pkt == 0) {
 			/* don't have packet, letting thru' */
-		        return SNOOP_PROPAGATE;
+			misses_++;
+			return SNOOP_PROPAGATE;
+		}
+		hits_++;
+		hdr_snoop *sh = hdr_snoop::access(pkt);
 
 		/* 
 		 * We have the packet: one of 3 possibilities:
@@ -473,10 +512,8 @@ Snoop::snoop_ack(Packet *p)
 			
 			
 			expDupacks_ = bufhead_ - expNextAck_;
-			if (expDupacks_ < 0)
-				expDupacks_ += SNOOP_MAXWIND;
 			expDupacks_ -= RTX_THRESH + 1;
-			expNextAck_ = next(buftail_);
+			expNextAck_ = buftail_ + 1;
 
 			if (sh->numRxmit() == 0) 
 				return snoop_rxmit(pkt);
@@ -615,36 +652,29 @@ Snoop::snoop_cleanbufs_(int ack)
 
 	if (toutPending_) {
 		s.cancel(toutPending_);
-		// xxx: I think that toutPending_ doesn't need to be freed because snoop didn't allocate it (but I'm not sure).
 		toutPending_ = 0;
 	};
 
 	if (empty_())
 		return sndTime;
 
-	int i = buftail_;
-	do {
-		hdr_snoop *sh = hdr_snoop::access(pkts_[i]);
-		int seq = hdr_tcp::access(pkts_[i])->seqno();
-
-		if (seq <= ack) {
-			sndTime = sh->sndTime();
-			Packet::free(pkts_[i]);
-			pkts_[i] = 0;
-			fstate_ &= ~SNOOP_FULL;	/* XXX redundant? */
-		} else if (seq > ack)
-			break;
-		i = next(i);
-	} while (i != bufhead_);
-
-	if ((i != buftail_) || (bufhead_ != buftail_)) {
-		fstate_ &= ~SNOOP_FULL;
-		buftail_ = i;
+	/* free the acked pkts, then skip to the next cached one */
+	for (; buftail_ <= ack && buftail_ < bufhead_; buftail_++) {
+		Packet *pkt = cached(buftail_);
+		if (pkt) {
+			sndTime = hdr_snoop::access(pkt)->sndTime();
+			freepkt_(buftail_);
+		}
 	}
+	while (buftail_ < bufhead_ && !cached(buftail_))
+		buftail_++;
+	if (bufhead_ - buftail_ < nbufs_)
+		fstate_ &= ~SNOOP_FULL;
+
 	if (!empty_()) {
-		toutPending_ = (Event *) (pkts_[buftail_]);
+		toutPending_ = &rxmitEvent_;
 		s.schedule(rxmitHandler_, toutPending_, timeout());
-		hdr_snoop *sh = hdr_snoop::access(pkts_[buftail_]);
+		hdr_snoop *sh = hdr_snoop::access(pkts_[buftail_ % nbufs_]);
 		tailTime_ = sh->sndTime();
 	}
 
@@ -733,16 +763,18 @@ Snoop::snoop_rxmit(Packet *pkt)
 			sh->sndTime() = s.clock();
 			sh->numRxmit() = sh->numRxmit() + 1;
 			Packet *p = pkt->copy();
+			/* undo what the lower layers did to the shared pkt */
+			HDR_CMN(p)->size() = sh->size();
+			HDR_CMN(p)->error() = 0;
+			HDR_IP(p)->ttl() = sh->ttl();
 			parent_->sendDown(p);
 		} else 
 			return SNOOP_PROPAGATE;
 	}
 	/* Reset timeout for later time. */
-	if (toutPending_) {
+	if (toutPending_)
 		s.cancel(toutPending_);
-		// xxx: I think that toutPending_ doesn't need to be freed because snoop didn't allocate it (but I'm not sure).
-	};
-	toutPending_ = (Event *)pkt;
+	toutPending_ = &rxmitEvent_;
 	s.schedule(rxmitHandler_, toutPending_, timeout());
 	return SNOOP_SUPPRESS;
 }
@@ -755,19 +787,15 @@ Snoop::snoop_cleanup()
 void
 SnoopRxmitHandler::handle(Event *)
 {
-	Packet *p = snoop_->pkts_[snoop_->buftail_];
 	snoop_->toutPending_ = 0;
-	if (p == 0)
+	if (snoop_->empty_())
 		return;
-	hdr_snoop *sh = hdr_snoop::access(p);
-	if (sh->seqno() != snoop_->lastAck_ + 1)
+	Packet *p = snoop_->cached(snoop_->lastAck_ + 1);
+	if (p == 0)
 		return;
-	if ((snoop_->bufhead_ != snoop_->buftail_) || 
-	    (snoop_->fstate_ & SNOOP_FULL)) {
-		//		printf("%f Snoop timeout\n", Scheduler::instance().clock());
-		if (snoop_->snoop_rxmit(p) == SNOOP_SUPPRESS)
-			snoop_->expNextAck_ = snoop_->next(snoop_->buftail_);
-	}
+	//		printf("%f Snoop timeout\n", Scheduler::instance().clock());
+	if (snoop_->snoop_rxmit(p) == SNOOP_SUPPRESS)
+		snoop_->expNextAck_ = snoop_->buftail_ + 1;
 }
 
 
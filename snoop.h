@@ -56,7 +56,7 @@
 #define SNOOP_WLALIVE   0x40	/* wl connection has been alive past 1 sec */
 #define SNOOP_WLEMPTY   0x80
 
-#define SNOOP_MAXWIND   100	/* XXX */
+#define SNOOP_MAXWIND   100	/* default number of pkt bufs */
 #define SNOOP_WLSEQS    8
 #define SNOOP_MIN_TIMO  0.100	/* in seconds */
 #define SNOOP_MAX_RXMIT 10	/* quite arbitrary at this point */
@@ -76,6 +76,8 @@ struct hdr_snoop {
 	int numRxmit_;
 	int senderRxmit_;
 	double sndTime_;
+	int size_;		/* size and ttl when cached, as the lower */
+	int ttl_;		/* layers change them in the shared pkt */
 
 	static int offset_;
 	inline static int& offset() { return offset_; }
@@ -87,6 +89,8 @@ struct hdr_snoop {
 	inline int& numRxmit() { return numRxmit_; }
 	inline int& senderRxmit() { return senderRxmit_; }
 	inline double& sndTime() { return sndTime_; }
+	inline int& size() { return size_; }
+	inline int& ttl() { return ttl_; }
 };
 
 class LLSnoop : public LL {
@@ -115,11 +119,15 @@ class Snoop : public NsObject {
 	friend class SnoopPersistHandler;
   public:
 	Snoop();
+	~Snoop();
 	void recv(Packet *, Handler *);
 	void handle(Event *);
 	int snoop_rxmit(Packet *);
-	inline int next(int i) { return (i+1) % maxbufs_; }
-	inline int prev(int i) { return ((i == 0) ? maxbufs_-1 : i-1); };
+	/* the cached pkt with sequence number seq, if any */
+	inline Packet *cached(int seq) {
+		Packet *p = pkts_[seq % nbufs_];
+		return ((p && hdr_snoop::access(p)->seqno() == seq) ? p : 0);
+	}
 	inline int wl_next(int i) { return (i+1) % SNOOP_WLSEQS; }
 	inline int wl_prev(int i) { return ((i == 0) ? SNOOP_WLSEQS-1 : i-1);};
 
@@ -136,9 +144,10 @@ class Snoop : public NsObject {
 	void snoop_rtt(double);
 	int snoop_qlong();
 	int snoop_insert(Packet *);
-	inline int empty_()
-		{return (bufhead_==buftail_ &&!(fstate_&SNOOP_FULL));}
-	void savepkt_(Packet *, int, int);
+	inline int empty_() { return (ncached_ == 0); }
+	void savepkt_(Packet *, int);
+	void freepkt_(int);
+	void allocbufs_();
 	void update_state_();
 	inline double timeout() { 
 		if (!parent_->integrate())
@@ -163,10 +172,26 @@ class Snoop : public NsObject {
 	double   rttvar_;	/* linear deviation */
 	double   tailTime_;	/* time at which earliest unack'd pkt sent */
 	int      rxmitStatus_;
-	short    bufhead_;	/* next pkt goes here */
+	int      bufhead_;	/* seqno after the last cached pkt */
 	Event    *toutPending_;	/* # pending timeouts */
-	short    buftail_;	/* first unack'd pkt */
-	Packet   *pkts_[SNOOP_MAXWIND]; /* ringbuf of cached pkts */
+	Event    rxmitEvent_;	/* the event toutPending_ points to */
+	int      buftail_;	/* seqno of the first cached pkt */
+	/*
+	 * The cached pkts are indexed by seqno: pkt seq is in
+	 *   pkts_[seq % nbufs_], with buftail_ <= seq < bufhead_ and
+	 *   bufhead_ - buftail_ <= nbufs_.  The cache holds references
+	 *   (Packet::refcopy()) to the pkts sent on, not copies of them.
+	 */
+	Packet   **pkts_;	/* ringbuf of cached pkts */
+	int      nbufs_;	/* size of pkts_ */
+	int      ncached_;	/* # pkts in the cache */
+
+	/* cache statistics, see the "cache-stats" command */
+	int      cachedBytes_;	/* bytes in the cached pkts */
+	int      maxCached_;	/* max. ncached_ */
+	int      hits_;		/* lookups of a rexmitted seqno that hit */
+	int      misses_;	/* and that missed */
+	int      evictions_;	/* pkts freed to make room (lru_) */
 	
 	int      wl_state_;
 	int      wl_lastSeen_;
@@ -175,7 +200,7 @@ class Snoop : public NsObject {
 	int      wl_buftail_;
 	hdr_seq  *wlseqs_[SNOOP_WLSEQS];	/* ringbuf of wless data */
 
-	int      maxbufs_;	/* max number of pkt bufs */
+	int      maxbufs_;	/* max number of pkt bufs (nbufs_ follows it) */
 	double   snoopTick_;	/* minimum rxmission timer granularity */
 	double   g_;		/* gain in EWMA for srtt_ and rttvar_ */
 	int      integrate_;	/* integrate loss rec across active conns */
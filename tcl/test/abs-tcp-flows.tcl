@@ -0,0 +1,87 @@
+#
+# Abstract TCP drop benchmark: many short Agent/AbsTCP flows, each with
+# its own flow id, share one DropTail bottleneck that is offered more than
+# it can carry.  Every packet the bottleneck drops is handed to the
+# DropTargetAgent, which finds the flow by its id.  Reports the packets
+# and drops of the bottleneck, and the wall time of the run.
+#
+#   ns abs-tcp-flows.tcl [flows] [duration] [bandwidth] [queue-limit]
+#
+# e.g.  ns abs-tcp-flows.tcl 100000 100 100Mb 100
+#
+# Each flow starts at a random time in [0, duration) and sends 1 to 40
+# packets; 100000 flows over 100s offer about 160Mb/s.  The run is the
+# same from one build to another, so the wall time compares the drop
+# dispatch of two builds.
+#
+
+set nflows 100000
+set duration 100.0
+set bw 100Mb
+set qlimit 100
+if {$argc > 0} { set nflows [lindex $argv 0] }
+if {$argc > 1} { set duration [lindex $argv 1] }
+if {$argc > 2} { set bw [lindex $argv 2] }
+if {$argc > 3} { set qlimit [lindex $argv 3] }
+
+set nsrc 100		;# source nodes, nflows/nsrc flows on each
+set delay 20ms		;# bottleneck delay
+set rtt 0.05		;# the RTT the FSM of each flow is timed by
+set maxpkts 40
+
+set ns [new Simulator]
+set rng [new RNG]
+$rng seed 1
+
+set r0 [$ns node]
+set r1 [$ns node]
+$ns duplex-link $r0 $r1 $bw $delay DropTail
+$ns queue-limit $r0 $r1 $qlimit
+set qmon [$ns monitor-queue $r0 $r1 [open /dev/null w]]
+
+# the drops of the bottleneck go on from its drophead_ to the drop target
+set dt [new DropTargetAgent]
+[[$ns link $r0 $r1] set drophead_] target $dt
+
+# the FSM times the flows, so their acks are not needed
+set null [new Agent/Null]
+$ns attach-agent $r1 $null
+
+for {set i 0} {$i < $nsrc} {incr i} {
+	set src($i) [$ns node]
+	$ns duplex-link $src($i) $r0 1Gb 1ms DropTail
+}
+
+set t_setup [clock clicks -milliseconds]
+for {set i 0} {$i < $nflows} {incr i} {
+	set tcp [new Agent/AbsTCP/RenoDelAck]
+	$tcp set fid_ $i
+	$tcp rtt $rtt
+	$ns attach-agent $src([expr $i % $nsrc]) $tcp
+	$ns connect $tcp $null
+	$ns at [$rng uniform 0 $duration] \
+		"$tcp advance [expr [$rng integer $maxpkts] + 1]"
+}
+set t_setup [expr [clock clicks -milliseconds] - $t_setup]
+
+proc start {} {
+	global t_run
+	set t_run [clock clicks -milliseconds]
+}
+
+proc finish {} {
+	global nflows qmon t_setup t_run
+	set t_run [expr [clock clicks -milliseconds] - $t_run]
+	set arrivals [$qmon set parrivals_]
+	set drops [$qmon set pdrops_]
+	puts [format "%d flows, %d packets, %d drops (%.1f%%)" $nflows \
+		$arrivals $drops [expr 100.0 * $drops / ($arrivals > 0 ? $arrivals : 1)]]
+	puts [format "setup %.2fs, run %.2fs" [expr $t_setup / 1000.0] \
+		[expr $t_run / 1000.0]]
+	exit 0
+}
+
+$ns at 0.0 "start"
+# twice the duration, for the last flows to finish
+$ns at [expr 2 * $duration] "finish"
+$ns run
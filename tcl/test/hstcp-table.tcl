@@ -0,0 +1,105 @@
+#
+# HighSpeed TCP table check: two HighSpeed flows (windowOption_ 8) on two
+# identical paths, one with the analytic parameters (hstcp_table_ 0) and
+# one reading them from the table (hstcp_table_ 1).  The cwnd of both is
+# sampled during the run; the table must follow the analytic trajectory.
+#
+#   ns hstcp-table.tcl [bandwidth] [delay] [duration]
+#
+# e.g.  ns hstcp-table.tcl 1Gb 50ms 100
+#
+# Prints the largest relative difference of the two windows while they
+# take the same losses, the mean window of each, and PASS or FAIL.
+#
+
+set bw 1Gb
+set delay 50ms
+set duration 100.0
+if {$argc > 0} { set bw [lindex $argv 0] }
+if {$argc > 1} { set delay [lindex $argv 1] }
+if {$argc > 2} { set duration [lindex $argv 2] }
+
+set interval 0.1	;# cwnd sampling interval
+set tolerance 0.01	;# on the difference of the mean windows
+
+set ns [new Simulator]
+
+proc hstcp_flow {table} {
+	global ns bw delay
+	set src [$ns node]
+	set dst [$ns node]
+	$ns duplex-link $src $dst $bw $delay DropTail
+	$ns queue-limit $src $dst 2000
+
+	set tcp [new Agent/TCP/Sack1]
+	$tcp set windowOption_ 8
+	$tcp set low_window_ 38
+	$tcp set high_window_ 83000
+	$tcp set high_p_ 0.0000001
+	$tcp set high_decrease_ 0.1
+	$tcp set window_ 100000
+	$tcp set packetSize_ 1460
+	$tcp set hstcp_table_ $table
+	$ns attach-agent $src $tcp
+	set sink [new Agent/TCPSink/Sack1]
+	$ns attach-agent $dst $sink
+	$ns connect $tcp $sink
+
+	set ftp [new Application/FTP]
+	$ftp attach-agent $tcp
+	$ns at 0.1 "$ftp start"
+	return $tcp
+}
+
+set analytic [hstcp_flow 0]
+set table [hstcp_flow 1]
+
+set nsamples 0
+set sum_a 0.0
+set sum_t 0.0
+set maxdiff 0.0
+set maxdiff_time 0.0
+set diverged 0
+
+proc sample {} {
+	global ns analytic table interval nsamples sum_a sum_t
+	global maxdiff maxdiff_time diverged
+	set a [$analytic set cwnd_]
+	set t [$table set cwnd_]
+	incr nsamples
+	set sum_a [expr $sum_a + $a]
+	set sum_t [expr $sum_t + $t]
+	# the trajectories are compared until the flows see different losses
+	if {!$diverged && [$analytic set nrexmit_] != [$table set nrexmit_]} {
+		set diverged [$ns now]
+	}
+	if {!$diverged && $a > 0} {
+		set d [expr abs($t - $a) / $a]
+		if {$d > $maxdiff} {
+			set maxdiff $d
+			set maxdiff_time [$ns now]
+		}
+	}
+	$ns at [expr [$ns now] + $interval] "sample"
+}
+
+proc finish {} {
+	global nsamples sum_a sum_t maxdiff maxdiff_time diverged tolerance
+	set mean_a [expr $sum_a / $nsamples]
+	set mean_t [expr $sum_t / $nsamples]
+	set meandiff [expr abs($mean_t - $mean_a) / $mean_a]
+	puts [format "max relative cwnd difference %.3g at %.1f s%s" $maxdiff $maxdiff_time \
+		[expr {$diverged ? [format " (losses differ from %.1f s)" $diverged] : ""}]]
+	puts [format "mean cwnd: analytic %.2f, table %.2f (difference %.3g)" \
+		$mean_a $mean_t $meandiff]
+	if {$meandiff <= $tolerance} {
+		puts "PASS"
+		exit 0
+	}
+	puts "FAIL"
+	exit 1
+}
+
+$ns at 0.1 "sample"
+$ns at $duration "finish"
+$ns run
@@ -0,0 +1,96 @@
+#
+# TCP-Linux pacing scenario: one flow from a server to a mobile over a
+# fast wired hop and a slower cellular hop, where the base station keeps
+# a large DropTail buffer.  Reports the occupancy of the base station
+# queue and the throughput of the flow, with pacing on or off.
+#
+#   ns linux-pacing.tcl [cc] [on|off] [quantum] [pacing_gain]
+#
+# e.g.  ns linux-pacing.tcl sod off
+#       ns linux-pacing.tcl sod on 2 125
+#
+# With "on", the module parameter "pacing" of cc is set (only SOD has one
+# in this tree) and the agent releases `quantum' packets per pacing
+# interval.
+#
+
+set cc sod
+set pacing off
+set quantum 1
+set gain 125
+if {$argc > 0} { set cc [lindex $argv 0] }
+if {$argc > 1} { set pacing [lindex $argv 1] }
+if {$argc > 2} { set quantum [lindex $argv 2] }
+if {$argc > 3} { set gain [lindex $argv 3] }
+
+set duration 60.0
+set warmup 10.0		;# queue and throughput are measured after this
+set interval 0.01	;# queue sampling interval
+
+set ns [new Simulator]
+
+set server [$ns node]
+set bs [$ns node]
+set mobile [$ns node]
+$ns duplex-link $server $bs 100Mb 10ms DropTail
+$ns duplex-link $bs $mobile 10Mb 30ms DropTail
+$ns queue-limit $bs $mobile 1000
+
+set tcp [new Agent/TCP/Linux]
+$tcp set timestamps_ true
+$tcp set window_ 10000
+$tcp set packetSize_ 1460
+$ns attach-agent $server $tcp
+set sink [new Agent/TCPSink/Sack1]
+$sink set ts_echo_rfc1323_ true
+$ns attach-agent $mobile $sink
+$ns connect $tcp $sink
+$tcp ack_clock on
+$tcp set_pace_quantum $quantum
+if {$pacing == "on"} {
+	$tcp set_ca_param $cc pacing 1
+	$tcp set_ca_param $cc pacing_gain $gain
+}
+$ns at 0 "$tcp select_ca $cc"
+
+set ftp [new Application/FTP]
+$ftp attach-agent $tcp
+
+set qmon [$ns monitor-queue $bs $mobile ""]
+set nsamples 0
+set qsum 0
+set qmax 0
+set bstart 0
+set dstart 0
+
+proc sample {} {
+	global ns qmon interval nsamples qsum qmax
+	set q [$qmon set pkts_]
+	incr nsamples
+	incr qsum $q
+	if {$q > $qmax} { set qmax $q }
+	$ns at [expr [$ns now] + $interval] "sample"
+}
+
+proc start_measure {} {
+	global qmon bstart dstart
+	set bstart [$qmon set bdepartures_]
+	set dstart [$qmon set pdrops_]
+	sample
+}
+
+proc finish {} {
+	global ns qmon cc pacing quantum gain duration warmup
+	global nsamples qsum qmax bstart dstart
+	set secs [expr $duration - $warmup]
+	set bytes [expr [$qmon set bdepartures_] - $bstart]
+	puts [format "%s pacing %s quantum %d gain %d: queue mean %.1f max %d pkts, throughput %.3f Mb/s, drops %d" \
+		$cc $pacing $quantum $gain [expr double($qsum) / $nsamples] $qmax \
+		[expr $bytes * 8.0 / $secs / 1000000] [expr [$qmon set pdrops_] - $dstart]]
+	exit 0
+}
+
+$ns at 0.1 "$ftp start"
+$ns at $warmup "start_measure"
+$ns at $duration "finish"
+$ns run
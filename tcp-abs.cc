@@ -52,25 +52,132 @@
 #include "tcp.h"
 #include "tcp-abs.h"
 
+//AbsFsmTable
+AbsFsmTable* AbsFsmTable::tables_ = NULL;
+
+AbsFsmTable* AbsFsmTable::lookup(FSMState* start)
+{
+	AbsFsmTable* t;
+
+	for (t = tables_; t != NULL; t = t->link_)
+		if (t->start_ == start)
+			return (t);
+	t = new AbsFsmTable(start);
+	t->link_ = tables_;
+	tables_ = t;
+	return (t);
+}
+
+/*
+ * The number of state, numbering it if it is new.  hkey_ is kept at
+ * least twice as large as the number of states.
+ */
+int AbsFsmTable::number(FSMState* state)
+{
+	unsigned long h = ((unsigned long)state >> 4) * 2654435761UL;
+	int i;
+
+	for (i = h & hmask_; hkey_[i] != NULL; i = (i + 1) & hmask_)
+		if (hkey_[i] == state)
+			return (hval_[i]);
+	if (2*(nstates_ + 1) > hmask_ + 1) {
+		FSMState** okey = hkey_;
+		int* oval = hval_;
+		int osize = hmask_ + 1;
+		hmask_ = 2*osize - 1;
+		hkey_ = new FSMState*[hmask_ + 1];
+		hval_ = new int[hmask_ + 1];
+		states_ = (FSMState**)realloc(states_,
+		    (hmask_ + 1) * sizeof(FSMState*));
+		for (i = 0; i <= hmask_; i++)
+			hkey_[i] = NULL;
+		for (int j = 0; j < osize; j++) {
+			if (okey[j] == NULL)
+				continue;
+			h = ((unsigned long)okey[j] >> 4) * 2654435761UL;
+			for (i = h & hmask_; hkey_[i] != NULL;
+			     i = (i + 1) & hmask_)
+				;
+			hkey_[i] = okey[j];
+			hval_[i] = oval[j];
+		}
+		delete [] okey;
+		delete [] oval;
+		return (number(state));
+	}
+	hkey_[i] = state;
+	hval_[i] = nstates_;
+	states_[nstates_] = state;
+	return (nstates_++);
+}
+
+AbsFsmTable::AbsFsmTable(FSMState* start) : start_(start), nstates_(0),
+	link_(NULL)
+{
+	int s, k, n;
+
+	hmask_ = 63;
+	hkey_ = new FSMState*[hmask_ + 1];
+	hval_ = new int[hmask_ + 1];
+	for (k = 0; k <= hmask_; k++)
+		hkey_[k] = NULL;
+	states_ = (FSMState**)malloc((hmask_ + 1) * sizeof(FSMState*));
+	/* number the states breadth first, the new ones at the end */
+	number(start);
+	for (s = 0; s < nstates_; s++)
+		for (k = 0; k < ABS_FSM_WIDTH; k++)
+			if (states_[s]->drop_[k] != NULL)
+				number(states_[s]->drop_[k]);
+
+	batch_ = new int[nstates_];
+	next_ = new int[nstates_ * ABS_FSM_WIDTH];
+	trans_ = new char[nstates_ * ABS_FSM_WIDTH];
+	for (s = 0; s < nstates_; s++) {
+		FSMState* state = states_[s];
+		batch_[s] = state->batch_size_;
+		for (k = 0; k < ABS_FSM_WIDTH; k++) {
+			n = s*ABS_FSM_WIDTH + k;
+			if (state->drop_[k] != NULL) {
+				next_[n] = number(state->drop_[k]);
+				trans_[n] = state->transition_[k];
+			} else if (k == 0) {
+				next_[n] = s;
+				trans_[n] = state->transition_[0] == 0 ?
+					RTT : state->transition_[0];
+			} else {
+				next_[n] = 0;
+				trans_[n] = TIMEOUT;
+			}
+		}
+	}
+	delete [] hkey_;
+	delete [] hval_;
+	hkey_ = NULL;
+	hval_ = NULL;
+}
+
 //AbsTcp
-AbsTcpAgent::AbsTcpAgent() : Agent(PT_TCP), rtt_(0), current_(NULL),offset_(0), seqno_lb_(-1), connection_size_(0), timer_(this), rescheduled_(0)
+AbsTcpAgent::AbsTcpAgent() : Agent(PT_TCP), rtt_(0), fsm_(NULL), state_(0), aggregate_(0), offset_(0), seqno_lb_(-1), connection_size_(0), timer_(this), rescheduled_(0), hashed_(0), hfid_(-1), hprev_(NULL), hnext_(NULL)
 {
 	size_ = 1000;
 }
 
+AbsTcpAgent::~AbsTcpAgent()
+{
+	if (hashed_)
+		DropTargetAgent::instance().remove_tcp(this);
+}
+
 void AbsTcpAgent::timeout()
 {
-	if (rescheduled_ == 0 && current_->transition_[offset_]!= current_->transition_[0]) {
+	if (rescheduled_ == 0 && fsm_->transition(state_, offset_) !=
+	    fsm_->transition(state_, 0)) {
 		set_timer(2*rtt_);
 		rescheduled_ = 1;
 	} else {
 		rescheduled_ = 0;
-		seqno_lb_ += current_->batch_size_;
-		if (current_->drop_[offset_] == NULL) {
-			printf("Error: This fsm can't handle multi losses per connection\n");
-			exit(0);
-		}
-		current_ = current_->drop_[offset_];
+		seqno_lb_ += fsm_->batch(state_);
+		state_ = fsm_->next(state_, offset_);
 		send_batch();
 	}
 }
@@ -90,34 +197,46 @@ void AbsTcpAgent::advanceby(int pktcnt)
 void AbsTcpAgent::start()
 {
 	//printf("starting fsm tcp, %d\n", connection_size_);
+	DropTargetAgent::instance().insert_tcp(this);
 	send_batch();
 }
 
 void AbsTcpAgent::send_batch() 
 {
 	int seqno = seqno_lb_;
+	int batch = fsm_->batch(state_);
 	
 	offset_ = 0;
-	//printf("sending batch, %d\n", current_->batch_size_);
-	for (int i=0; i<current_->batch_size_ && seqno < connection_size_-1; i++) {
-		seqno++;
-		output(seqno);
+	//printf("sending batch, %d\n", batch);
+	if (aggregate_) {
+		/* a drop adds a packet to the connection: go on after it */
+		int sent = 0, npkts;
+		while (sent < batch && seqno < connection_size_-1) {
+			npkts = connection_size_-1 - seqno;
+			if (npkts > batch - sent)
+				npkts = batch - sent;
+			output(seqno+1, npkts);
+			seqno += npkts;
+			sent += npkts;
+		}
+	} else {
+		for (int i=0; i<batch && seqno < connection_size_-1; i++) {
+			seqno++;
+			output(seqno);
+		}
 	}
 	if (seqno == connection_size_-1) {
 		finish();
 	}
 	else if (seqno < connection_size_-1) {
-		if (current_->drop_[offset_] == NULL) {
-			printf("Error: current fsm can't handle this tcp connection flow id %d (possibly too long)\n", fid_);
-			exit(0);
-		} 
-		//printf("start timer %d\n", current_->transition_[offset_]);
-		if (current_->transition_[offset_] == 0) {
-			current_ = current_->drop_[offset_];
+		int transition = fsm_->transition(state_, offset_);
+		//printf("start timer %d\n", transition);
+		if (transition == 0) {
+			state_ = fsm_->next(state_, offset_);
 			send_batch();
-		} else if (current_->transition_[offset_] == RTT) {
+		} else if (transition == RTT) {
 			set_timer(rtt_);
-		} else if (current_->transition_[offset_] == TIMEOUT) {
+		} else if (transition == TIMEOUT) {
 			set_timer(rtt_ * 3);
 		} else {
 			printf("Error: weird transition timer\n");
@@ -131,12 +250,15 @@ void AbsTcpAgent::send_batch()
 
 void AbsTcpAgent::drop(int seqno)
 {
+	int offset = seqno - seqno_lb_;
+
 	//printf("dropped: %d\n", seqno);
-	if (offset_ != 0) {
-		printf("Error: Sorry, can't handle multiple drops per batch\n");
-		exit(0);
-	}
-	offset_ = seqno - seqno_lb_;
+	/*
+	 * The first drop of the batch picks the next state; any other
+	 * drop just adds a packet to send.
+	 */
+	if (offset > 0 && (offset_ == 0 || offset < offset_))
+		offset_ = offset;
 	connection_size_++;
 }
 
@@ -144,13 +266,20 @@ void AbsTcpAgent::finish()
 {
 	//printf("finish: sent %d\n", seqno_lb_+1);
 	cancel_timer();
+	DropTargetAgent::instance().remove_tcp(this);
 }
 
-void AbsTcpAgent::output(int seqno)
+/*
+ * Send packets seqno to seqno+npkts-1, as one packet of npkts times
+ * the size.
+ */
+void AbsTcpAgent::output(int seqno, int npkts)
 {
         Packet* p = allocpkt();
         hdr_tcp *tcph = hdr_tcp::access(p);
         tcph->seqno() = seqno;
+	if (npkts > 1)
+		hdr_cmn::access(p)->size() = npkts * size_;
         send(p, 0);
 }
 
@@ -175,20 +304,24 @@ int AbsTcpAgent::command(int argc, const char*const* argv)
                         advanceby(atoi(argv[2]));
                         return (TCL_OK);
                 }
+                if (strcmp(argv[1], "aggregate") == 0) {
+			aggregate_ = atoi(argv[2]);
+			return (TCL_OK);
+                }
 		if(strcmp(argv[1], "print-stats") == 0) {
 			// xxx: works best if invoked on a new fsm
 			// (otherwise you don't get the whole thing).
 			int n = atoi(argv[2]);
 			if (n < 0 || n >= 17)
 				return TCL_ERROR;
-			FSM::print_FSM_stats(current_, n);
+			FSM::print_FSM_stats(fsm_->state(state_), n);
                         return (TCL_OK);
 		};
 	} else if (argc == 2) {
                 if (strcmp(argv[1], "print") == 0) {
 			// xxx: works best if invoked on a new fsm
 			// (otherwise you don't get the whole thing).
-			FSM::print_FSM(current_);
+			FSM::print_FSM(fsm_->state(state_));
                         return (TCL_OK);
 		};
 	};
@@ -213,8 +346,7 @@ public:
 AbsTcpTahoeAckAgent::AbsTcpTahoeAckAgent() : AbsTcpAgent()
 {
 	size_ = 1000;
-	current_ = TahoeAckFSM::instance().start_state();
-	DropTargetAgent::instance().insert_tcp(this);
+	use_fsm(TahoeAckFSM::instance().start_state());
 }
 
 
@@ -230,8 +362,7 @@ public:
 AbsTcpRenoAckAgent::AbsTcpRenoAckAgent() : AbsTcpAgent()
 {
 	size_ = 1000;
-	current_ = RenoAckFSM::instance().start_state();
-	DropTargetAgent::instance().insert_tcp(this);
+	use_fsm(RenoAckFSM::instance().start_state());
 }
 
 
@@ -247,8 +378,7 @@ public:
 AbsTcpTahoeDelAckAgent::AbsTcpTahoeDelAckAgent() : AbsTcpAgent()
 {
 	size_ = 1000;
-	current_ = TahoeDelAckFSM::instance().start_state();
-	DropTargetAgent::instance().insert_tcp(this);
+	use_fsm(TahoeDelAckFSM::instance().start_state());
 }
 
 
@@ -264,8 +394,7 @@ public:
 AbsTcpRenoDelAckAgent::AbsTcpRenoDelAckAgent() : AbsTcpAgent()
 {
 	size_ = 1000;
-	current_ = RenoDelAckFSM::instance().start_state();
-	DropTargetAgent::instance().insert_tcp(this);
+	use_fsm(RenoDelAckFSM::instance().start_state());
 }
 
 
@@ -341,31 +470,103 @@ public:
         }
 } class_droptarget;
 
-DropTargetAgent::DropTargetAgent(): Connector(), dropper_list_(NULL)
+DropTargetAgent::DropTargetAgent(): Connector(), table_(NULL), mask_(-1),
+	count_(0)
 {
 	instance_ = this;
+	rehash(64);
 }
 
-void DropTargetAgent::recv(Packet* pkt, Handler*)
+DropTargetAgent::~DropTargetAgent()
 {
-	Dropper* tmp = dropper_list_;
+	for (int i = 0; i <= mask_; i++) {
+		AbsTcpAgent* tcp = table_[i];
+		while (tcp != NULL) {
+			AbsTcpAgent* next = tcp->hnext_;
+			tcp->hashed_ = 0;
+			tcp->hprev_ = tcp->hnext_ = NULL;
+			tcp = next;
+		}
+	}
+	delete [] table_;
+	if (instance_ == this)
+		instance_ = NULL;
+}
 
+void DropTargetAgent::recv(Packet* pkt, Handler*)
+{
         hdr_tcp *tcph = hdr_tcp::access(pkt);
         hdr_ip *iph = hdr_ip::access(pkt);
+	int fid = iph->flowid();
         //printf("flow %d dropping seqno %d\n", iph->flowid(),tcph->seqno());
-	while(tmp != NULL) {
-		if(tmp->agent_->flowid() == iph->flowid())
-			tmp->agent_->drop(tcph->seqno());
-		tmp = tmp->next_;
+	for (AbsTcpAgent* tcp = table_[fid & mask_]; tcp != NULL;
+	     tcp = tcp->hnext_) {
+		if (tcp->flowid() == fid)
+			tcp->drop(tcph->seqno());
 	}
 	Packet::free(pkt);
 }
 
+/*
+ * Add tcp under its flow id, or move it if the flow id changed since
+ * it was added.
+ */
 void DropTargetAgent::insert_tcp(AbsTcpAgent* tcp)
 {
-	Dropper* dppr = new Dropper;
-	dppr->agent_=tcp;
-	dppr->next_ = dropper_list_;
-	dropper_list_ = dppr;
+	if (tcp->hashed_) {
+		if (tcp->hfid_ == tcp->flowid())
+			return;
+		remove_tcp(tcp);
+	}
+	if (count_ > mask_)
+		rehash(2 * (mask_ + 1));
+	AbsTcpAgent** head = &table_[tcp->flowid() & mask_];
+	tcp->hfid_ = tcp->flowid();
+	tcp->hprev_ = NULL;
+	tcp->hnext_ = *head;
+	if (*head != NULL)
+		(*head)->hprev_ = tcp;
+	*head = tcp;
+	tcp->hashed_ = 1;
+	count_++;
 }
 
+void DropTargetAgent::remove_tcp(AbsTcpAgent* tcp)
+{
+	if (!tcp->hashed_)
+		return;
+	if (tcp->hprev_ != NULL)
+		tcp->hprev_->hnext_ = tcp->hnext_;
+	else
+		table_[tcp->hfid_ & mask_] = tcp->hnext_;
+	if (tcp->hnext_ != NULL)
+		tcp->hnext_->hprev_ = tcp->hprev_;
+	tcp->hprev_ = tcp->hnext_ = NULL;
+	tcp->hashed_ = 0;
+	count_--;
+}
+
+void DropTargetAgent::rehash(int size)
+{
+	AbsTcpAgent** old = table_;
+	int osize = mask_ + 1;
+
+	table_ = new AbsTcpAgent*[size];
+	for (int i = 0; i < size; i++)
+		table_[i] = NULL;
+	mask_ = size - 1;
+	for (int i = 0; i < osize; i++) {
+		AbsTcpAgent* tcp = old[i];
+		while (tcp != NULL) {
+			AbsTcpAgent* next = tcp->hnext_;
+			AbsTcpAgent** head = &table_[tcp->hfid_ & mask_];
+			tcp->hprev_ = NULL;
+			tcp->hnext_ = *head;
+			if (*head != NULL)
+				(*head)->hprev_ = tcp;
+			*head = tcp;
+			tcp = next;
+		}
+	}
+	delete [] old;
+}
@@ -54,6 +54,43 @@
 
 class AbsTcpAgent;
 
+#define ABS_FSM_WIDTH	17	// transitions per state: no drop, drop 1-16
+
+/*
+ * An FSM compiled into flat arrays indexed by state number, shared by
+ * all the agents using the FSM.  State 0 is the start state.  Where
+ * the FSM ends, the table goes on:
+ * - with no drop, the state repeats every RTT (steady state);
+ * - after a drop, the flow times out and starts over from state 0.
+ */
+class AbsFsmTable {
+public:
+	static AbsFsmTable* lookup(FSMState* start);
+	int batch(int s) const { return batch_[s]; }
+	int next(int s, int off) const {
+		return (off < ABS_FSM_WIDTH ? next_[s*ABS_FSM_WIDTH + off] : 0);
+	}
+	int transition(int s, int off) const {
+		return (off < ABS_FSM_WIDTH ?
+			trans_[s*ABS_FSM_WIDTH + off] : TIMEOUT);
+	}
+	FSMState* state(int s) const { return states_[s]; }
+protected:
+	AbsFsmTable(FSMState* start);
+	int number(FSMState* state);
+	FSMState* start_;
+	int nstates_;
+	FSMState** states_;	// FSMState of each state number
+	int* batch_;		// [state]
+	int* next_;		// [state*ABS_FSM_WIDTH + drop offset]
+	char* trans_;		// [state*ABS_FSM_WIDTH + drop offset]
+	FSMState** hkey_;	// state numbers, while compiling
+	int* hval_;
+	int hmask_;
+	AbsFsmTable* link_;
+	static AbsFsmTable* tables_;
+};
+
 class AbsTcpTimer : public TimerHandler {
 public: 
         AbsTcpTimer(AbsTcpAgent *a) : TimerHandler() { a_ = a; }
@@ -63,8 +100,10 @@ protected:
 };
 
 class AbsTcpAgent : public Agent {
+	friend class DropTargetAgent;
 public:
         AbsTcpAgent();
+        ~AbsTcpAgent();
         void timeout();
         void sendmsg(int pktcnt);
         void advanceby(int pktcnt);
@@ -73,17 +112,28 @@ public:
 	void drop(int seqno);
 	void finish();
 	void recv(Packet* pkt, Handler*);
-	void output(int seqno);
+	void output(int seqno, int npkts = 1);
 	inline int& flowid() { return fid_; }
         int command(int argc, const char*const* argv);
 protected:
+	void use_fsm(FSMState* start) {
+		fsm_ = AbsFsmTable::lookup(start);
+		state_ = 0;
+	}
 	double rtt_;
-	FSMState* current_;
-	int offset_;
+	AbsFsmTable* fsm_;
+	int state_;			// current state of fsm_
+	int aggregate_;			// one packet per batch?
+	int offset_;			// offset of the first drop in the batch
 	int seqno_lb_;                // seqno when finishing last batch
 	int connection_size_;
         AbsTcpTimer timer_;
 	int rescheduled_;
+	/* in DropTargetAgent's hash chain of flow id hfid_, while started */
+	int hashed_;
+	int hfid_;
+	AbsTcpAgent* hprev_;
+	AbsTcpAgent* hnext_;
         void cancel_timer() {
                 timer_.force_cancel();
         }
@@ -144,22 +194,25 @@ protected:
         AbsDelayTimer delay_timer_;
 };
 
-// Dropper Class
-class Dropper {
-public:
-	AbsTcpAgent* agent_;
-        Dropper* next_;
-};
-
+/*
+ * Hands dropped packets to the AbsTcpAgents of their flow id.  The
+ * agents of a flow id are found in a hash table, with a doubly linked
+ * chain per bucket; an agent is in it from start() to finish().
+ */
 class DropTargetAgent : public Connector {
 public:
         DropTargetAgent();
+        ~DropTargetAgent();
         void recv(Packet* pkt, Handler*);
         void insert_tcp(AbsTcpAgent* tcp);
+        void remove_tcp(AbsTcpAgent* tcp);
 	static DropTargetAgent& instance() {
 		return (*instance_);	       // general access to TahoeAckFSM
 	}
 protected:
-	Dropper* dropper_list_;
+	void rehash(int size);
+	AbsTcpAgent** table_;
+	int mask_;			// table size - 1, a power of two
+	int count_;			// number of agents in the table
 	static DropTargetAgent* instance_;
 };
@@ -66,26 +66,18 @@ FastTcpAgent::~FastTcpAgent()
 #endif
 
 	delete scb_;
-
-	if (sendtime_)
-		delete []sendtime_;
-	if (transmits_)
-		delete []transmits_;
-	if (cwnd_array_)
-		delete []cwnd_array_;
 }
 
 /******************************************************************************/
 FastTcpAgent::FastTcpAgent() : TcpAgent(),
 	avgRTT_(0), baseRTT_(0), avg_cwnd_last_RTT_(1),
-	alpha_(0), beta_(0), fastrecov_(FALSE),
+	alpha_(0), beta_(0),
+	sent_(SentTable::TS | SentTable::TRANSMITS | SentTable::CWND, -1.),
+	fastrecov_(FALSE),
 	pipe_(-1), next_pkt_(0), firstpartial_(0),
 	last_natural_ack_number_(-1), on_first_rtt_(true),
 	gamma_(0.5)
 {
-	sendtime_ = NULL;
-	transmits_ = NULL;
-	cwnd_array_ = NULL;
 	bind_bool("partial_ack_", &partial_ack_);
 	/* Use the Reassembly Queue based scoreboard as
 	 * ScoreBoard is O(cwnd) which is bad for HSTCP
@@ -467,22 +459,17 @@ FastTcpAgent::recv(Packet *pkt, Handler *)
 				
 				cwnd_ = t_seqno_ - tcph->seqno() + 1;
 				dupacks_ = 0;
-				for (int i=0;i<maxwnd_;i++)
-					cwnd_array_[i]=cwnd_;
+				sent_.fill_cwnd(cwnd_);
 			}
 #endif
 
 			firstpartial_ = 0;
 
 			// reset sendtime for acked pkts and incr transmits_
-			double sendTime = sendtime_[tcph->seqno()%maxwnd_];
-			double old_pif=cwnd_array_[tcph->seqno()%maxwnd_];
-			int transmits = transmits_[tcph->seqno()% maxwnd_];
-			for(int k= (last_natural_ack_number_+1); k<=tcph->seqno(); ++k) {
-				sendtime_[k%maxwnd_] = -1.0;
-				transmits_[k%maxwnd_] = 0;
-				cwnd_array_[k%maxwnd_]=-1;
-			}
+			double sendTime = sent_.ts(tcph->seqno());
+			double old_pif = sent_.cwnd(tcph->seqno());
+			int transmits = sent_.transmits(tcph->seqno());
+			sent_.clear(last_natural_ack_number_+1, tcph->seqno());
 			if (t_seqno_ > tcph->seqno()){
 				if ((transmits == 1) && (currentTime - sendTime > 0))
 					rtt_ = currentTime - sendTime;
@@ -768,7 +755,7 @@ void FastTcpAgent::send_much(int force, int reason, int maxburst)
 			found = 0;
 			int oldest_unacked_pkt = scb_->GetNextUnacked(last_ack_);
 			if (oldest_unacked_pkt != -1 &&
-			fasttime() - sendtime_[oldest_unacked_pkt%maxwnd_] > 2*avgRTT_){
+			fasttime() - sent_.ts(oldest_unacked_pkt) > 2*avgRTT_){
 				xmit_seqno = oldest_unacked_pkt;
 			}
 			else
@@ -827,23 +814,8 @@ FastTcpAgent::output(int seqno, int reason)
 	/* if this is the 1st pkt, setup senttime[] and transmits[]
 	 * I alloc mem here, instrad of in the constructor, to cover
 	 * cases which windows get set by each different tcp flows */
-	if (seqno==0) {
-		maxwnd_ = int(wnd_);
-		if (sendtime_)
-			delete []sendtime_;
-        	if (transmits_)
-			delete []transmits_;
-        	if (cwnd_array_)
-			delete []cwnd_array_;
-		sendtime_ = new double[maxwnd_];
-		transmits_ = new int[maxwnd_];
-		cwnd_array_= new double[maxwnd_];
-		for(int i=0;i<maxwnd_;i++) {
-			sendtime_[i] = -1.;
-			transmits_[i] = 0;
-			cwnd_array_[i]=-1;
-		}
-	}
+	if (seqno==0)
+		sent_.reset(int(wnd_));
 
 	if (ecn_) {
 		hf->ect() = 1; // ECN capable transport.
@@ -867,10 +839,10 @@ FastTcpAgent::output(int seqno, int reason)
 	}
 
 	// record a find grained send time and # of transmits 
-	int index = seqno % maxwnd_;
-	sendtime_[index] = fasttime(); 
-	cwnd_array_[index]=avg_cwnd_last_RTT_; 
-	++transmits_[index];
+	sent_.fit(last_ack_+1, seqno);
+	sent_.ts(seqno) = fasttime(); 
+	sent_.cwnd(seqno) = avg_cwnd_last_RTT_; 
+	++sent_.transmits(seqno);
 	/* support ndatabytes_ in output - Lloyd Wood 14 March 2000 */
 	int bytes = hdr_cmn::access(p)->size(); 
 	ndatabytes_ += bytes; 
@@ -958,7 +930,7 @@ int
 FastTcpAgent::fast_expire(Packet* pkt)
 {
 	hdr_tcp *tcph = hdr_tcp::access(pkt);
-	double elapse = fasttime() - sendtime_[(tcph->seqno()+1)%maxwnd_];
+	double elapse = fasttime() - sent_.ts(tcph->seqno()+1);
 	if (elapse >= 2 * avgRTT_) {
 		return(tcph->seqno()+1);
 	}
@@ -92,11 +92,9 @@ protected:
 	unsigned short 	bc_ack,bc_spacing;	
 	double rtt_;			// current rtt;
 	double newcwnd_;		// record un-inflated cwnd
-	double* sendtime_;		// each unacked pkt's sendtime is recorded.
+	SentTable sent_;		// each unacked pkt's sendtime, cwnd and
+					// # of retx is recorded.
 					// (fixes problems with RTT calc'n)
-	double*	cwnd_array_;
-	int*   transmits_;		// # of retx for an unacked pkt
-	int    maxwnd_;			// maxwnd size for v_sendtime_[]
 
 	double firstrecv_;		//first receive timestamp.
 	double currentTime;		//the time when a recv event happens
@@ -199,6 +199,7 @@ FullTcpAgent::delay_bind_init_all()
         delay_bind_init_one("ecn_syn_wait_");
         delay_bind_init_one("debug_");
         delay_bind_init_one("spa_thresh_");
+        delay_bind_init_one("rq_index_");
 
 	TcpAgent::delay_bind_init_all();
        
@@ -213,6 +214,7 @@ FullTcpAgent::delay_bind_dispatch(const char *varName, const char *localName, Tc
         if (delay_bind(varName, localName, "tcprexmtthresh_", &tcprexmtthresh_, tracer)) return TCL_OK;
         if (delay_bind(varName, localName, "iss_", &iss_, tracer)) return TCL_OK;
         if (delay_bind(varName, localName, "spa_thresh_", &spa_thresh_, tracer)) return TCL_OK;
+        if (delay_bind_bool(varName, localName, "rq_index_", &rq_index_, tracer)) return TCL_OK;
         if (delay_bind_bool(varName, localName, "nodelay_", &nodelay_, tracer)) return TCL_OK;
         if (delay_bind_bool(varName, localName, "data_on_syn_", &data_on_syn_, tracer)) return TCL_OK;
         if (delay_bind_bool(varName, localName, "dupseg_fix_", &dupseg_fix_, tracer)) return TCL_OK;
@@ -610,6 +612,7 @@ FullTcpAgent::reset()
 	cancel_timers();	// cancel timers first
       	TcpAgent::reset();	// resets most variables
 	rq_.clear();		// clear reassembly queue
+	rq_.index(rq_index_);
 	rtt_init();		// zero rtt, srtt, backoff
 
 	last_ack_sent_ = -1;
@@ -2832,6 +2835,7 @@ void
 SackFullTcpAgent::reset()
 {
 	sq_.clear();			// no SACK blocks
+	sq_.index(rq_index_);
 	/* Fixed typo.  -M. Weigle 6/17/02 */
 	sack_min_ = h_seqno_ = -1;	// no left edge of SACK blocks
 	FullTcpAgent::reset();
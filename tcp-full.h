@@ -143,6 +143,7 @@ protected:
 	int open_cwnd_on_pack_;	// open cwnd on a partial ack?
 	int segs_per_ack_;  // for window updates
 	int spa_thresh_;    // rcv_nxt < spa_thresh? -> 1 seg per ack
+	int rq_index_;	    // keep reassembly/SACK queues indexed (see rq.h)
 	int nodelay_;       // disable sender-side Nagle?
 	int fastrecov_;	    // are we in fast recovery?
 	int deflate_on_pack_;	// deflate on partial acks (reno:yes)
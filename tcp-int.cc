@@ -85,7 +85,8 @@ public:
 
 IntTcpAgent::IntTcpAgent() : TcpAgent(), slink(), 
 	session_(0), closecwTS_(0), lastTS_(-1), count_(0), 
-	wt_(1), wndIncSeqno_(0), num_thresh_dupack_segs_(0)
+	wt_(1), wndIncSeqno_(0), num_thresh_dupack_segs_(0),
+	segHead_(NULL), segTail_(NULL), pass_(0), strideIdx_(-1)
 {
 	bind("rightEdge_", &rightEdge_);
 	bind("uniqTS_", &uniqTS_);
@@ -82,5 +82,9 @@ class IntTcpAgent : public TcpAgent, public slink {
 	int dynWt_;
 	int wndIncSeqno_;       /* used to mark RTTs for window inc. algorithm */
 	int num_thresh_dupack_segs_;
+	Segment *segHead_;	/* this connection's segments in the */
+	Segment *segTail_;	/*   session's seglist_, in order */
+	double pass_;		/* for the session's STRIDE scheduling */
+	int strideIdx_;		/* index in its heap, or -1 */
 };
 #endif
@@ -73,6 +73,7 @@ void CongestionControlManager::scan() {
 
 struct tcp_congestion_ops* CongestionControlManager::get_ops(const char* name) {
 	if (cc_list_changed) scan();
+	cc_list_frozen = 1;
 	for (int i=0; i< num_; i++) {
 		if (strcmp(name, ops_list[i]->name)==0)
 			return ops_list[i];
@@ -101,11 +102,18 @@ public:
 
 LinuxTcpAgent::LinuxTcpAgent() :
 	initialized_(false),
-	next_pkts_in_flight_(0)
+	next_pkts_in_flight_(0),
+	td_capacity_(TD_DEFAULT_CAPACITY),
+	ack_clock_(ACK_CLOCK_FLOW),
+	ack_clock_src_(3),
+	ack_clock_dst_(2),
+	pace_timer_(this),
+	pace_quantum_(1)
 {
 	bind("next_pkts_in_flight_", &next_pkts_in_flight_);
 	scb_ = new ScoreBoard1();
 	linux_.icsk_ca_ops = NULL;
+	linux_.params = NULL;
         linux_.snd_cwnd_stamp = 0;
 	linux_.icsk_ca_state = TCP_CA_Open;
 	linux_.snd_cwnd = 2;
@@ -114,28 +122,27 @@ LinuxTcpAgent::LinuxTcpAgent() :
 	linux_.prev_ts = 0;
         
         linux_.prev_rcv_ts = 0; // Liu Ke's code
-        linux_.td_interval = 0; // Liu Ke's code
-        linux_.td_interval_ts = 0; // Liu Ke's code
         linux_.clock_rate = 0; // Liu Ke's code
-        linux_.output_file = NULL; //Liu Ke's code
+        linux_.trace = NULL;
         
         linux_.sod_diff = 0;
         linux_.sod_start = 0;
-	linux_.td_count = 0;
-	linux_.head = 0;
-	linux_.last = 0;
-	linux_.td_head_index = 0;
-	linux_.td_last_index = 0;
+	memset(&linux_.td_i, 0, sizeof(linux_.td_i));
+	memset(&linux_.td_i_ts, 0, sizeof(linux_.td_i_ts));
+	memset(linux_.icsk_ca_priv, 0, ICSK_CA_PRIV_SIZE);
 	linux_.prev_time = 0;
         linux_.current_time = 0;
+	linux_.pacing_rate = 0;
 	//load_to_linux_once();
 //	scb_->test();
 }
 
 LinuxTcpAgent::~LinuxTcpAgent(){
+	pace_timer_.force_cancel();
 	delete scb_;
 	remove_congestion_control();
-        
+	ns_linux_trace_close(linux_.trace);
+	free_ack_history();
 }
 
 int LinuxTcpAgent::window() 
@@ -157,22 +164,18 @@ void LinuxTcpAgent::reset()
 	linux_.prev_ts = 0;
         
         linux_.prev_rcv_ts = 0; //Liu Ke's code
-        linux_.td_interval = 0; // Liu Ke's code
-        linux_.td_interval_ts = 0; // Liu Ke's code
         linux_.clock_rate = 0; // Liu Ke's code
         
-        if (linux_.output_file)
-                fclose(linux_.output_file);
-        linux_.output_file = NULL; //Liu Ke's code
+        if (linux_.trace)
+                ns_linux_trace_flush(linux_.trace);
         
-	linux_.td_count = 0;
-	linux_.head = 0;
-	linux_.last = 0;
-	linux_.td_head_index = 0;
-	linux_.td_last_index = 0;
+	win_var_reset(&linux_.td_i);
+	win_var_reset(&linux_.td_i_ts);
 	linux_.prev_time = 0;
         linux_.ack_var = 0;
         linux_.current_time = 0;
+	linux_.pacing_rate = 0;
+	pace_timer_.force_cancel();
 	initialized_ = false;
         
         
@@ -288,15 +291,15 @@ void LinuxTcpAgent::rtt_update(double tao, unsigned long pkt_seq_no)
 
 	/*Record microsecond timestamp*/
 	if ((linux_.icsk_ca_ops) && (linux_.icsk_ca_ops->rtt_sample)) {
-		if ( bugfix_ts_ && pkt_seq_no && tss ) {
+		if ( bugfix_ts_ && pkt_seq_no && tss_.valid() ) {
 			//if we use the tss value when we have the timestamp
 			
-			//unsigned long a = (unsigned long)(round((now-tss[pkt_seq_no % tss_size_])*US_RATIO));
+			//unsigned long a = (unsigned long)(round((now-tss_.ts(pkt_seq_no))*US_RATIO));
 			//unsigned long ha = highest_ack_;
 			//if (a < 100)
-			//printf("%lf (%p): RTT=%lu, seq:%lu, highest_ack:%lu tss_size: %lu timesamp:%lf\n", now, this, a, pkt_seq_no, ha, tss_size_, tss[pkt_seq_no % tss_size_]);
+			//printf("%lf (%p): RTT=%lu, seq:%lu, highest_ack:%lu tss size: %d timesamp:%lf\n", now, this, a, pkt_seq_no, ha, tss_.size(), tss_.ts(pkt_seq_no));
 			
-			linux_.icsk_ca_ops->rtt_sample(&linux_, (unsigned long)(round((now-tss[pkt_seq_no % tss_size_])*US_RATIO)));
+			linux_.icsk_ca_ops->rtt_sample(&linux_, (unsigned long)(round((now-tss_.ts(pkt_seq_no))*US_RATIO)));
 		} else { 
 			//otherwise, use an approximation
 			linux_.icsk_ca_ops->rtt_sample(&linux_, (unsigned long)(round(tao*US_RATIO)));
@@ -355,8 +358,6 @@ void LinuxTcpAgent::recv(Packet *pkt, Handler*)
 	u32 prior_in_flight;
 	s32 seq_rtt;
 	unsigned char flag=0;
-	struct td *t_delay, *tmp;
-	s32 i = 0;
 
 	tcp_time_stamp = (unsigned long) (trunc(Scheduler::instance().clock() * JIFFY_RATIO)); 
 	ktime_get_real = (s64)trunc(Scheduler::instance().clock()*1000000000);
@@ -392,57 +393,20 @@ void LinuxTcpAgent::recv(Packet *pkt, Handler*)
         
         double now = Scheduler::instance().clock();
         linux_.current_time = now;
-        char *src_nodeaddr = Address::instance().print_nodeaddr(iph->saddr());
-        char *dst_nodeaddr = Address::instance().print_nodeaddr(iph->daddr());
 	
-        if (!strcmp(src_nodeaddr, "3") && !strcmp(dst_nodeaddr, "2"))
+        if (run_ack_clock(iph))
         {
             if (linux_.prev_ts != 0)
             {
-                if (linux_.td_count < TD_ARRAY_CAPACITY)
-                {
-                    /*Liu Ke's modification*/
-                    t_delay = &(linux_.ary_td[linux_.td_head_index]);
-
-                    t_delay->td_i = now - linux_.prev_ts;
-                    t_delay->td_i_ts = (tcph->ts_ > linux_.prev_rcv_ts ? tcph->ts_ - linux_.prev_rcv_ts : 0);                 
-
-                    linux_.td_interval += t_delay->td_i;
-                    linux_.td_interval_ts += t_delay->td_i_ts;
-
-                    clock_rate = linux_.td_interval/linux_.td_interval_ts;
-                    linux_.ack_var = (linux_.td_interval) - (linux_.td_interval_ts);
-                    
-                    linux_.td_head_index = (linux_.td_head_index + 1) % TD_ARRAY_CAPACITY;
-                    linux_.td_count ++;
-
-                    //printf("%lf %lf %lf %lf %lf %lf\n", clock_rate, linux_.td_interval, linux_.td_interval_ts, t_delay->td_i_ts, tcph->ts_, linux_.prev_rcv_ts);
-
-                }
-                else 
-                {
-                    t_delay = &(linux_.ary_td[linux_.td_last_index]);   
-                    linux_.td_interval -= t_delay->td_i;                               
-                    linux_.td_interval_ts -= t_delay->td_i_ts;
-
-                    linux_.td_last_index = (linux_.td_last_index + 1) % TD_ARRAY_CAPACITY;
-
-                    t_delay = &(linux_.ary_td[linux_.td_head_index]);                
-                    t_delay->td_i = now - linux_.prev_ts;		
-                    t_delay->td_i_ts = (tcph->ts_ > linux_.prev_rcv_ts ? tcph->ts_ - linux_.prev_rcv_ts : 0);                                             
-
-                    linux_.td_interval += t_delay->td_i;                               
-                    linux_.td_interval_ts += t_delay->td_i_ts;                               
-                     
-                    clock_rate = linux_.td_interval/linux_.td_interval_ts;
-                    linux_.ack_var = (linux_.td_interval) - (linux_.td_interval_ts);
-                    
-                    linux_.td_head_index = (linux_.td_head_index + 1) % TD_ARRAY_CAPACITY;
+                if (!linux_.td_i.v)
+                    alloc_ack_history();
 
-                    //printf("%lf %lf %lf %lf\n", clock_rate, linux_.td_interval, linux_.td_interval_ts, t_delay->td_i_ts);
+                /*Liu Ke's modification*/
+                win_var_put(&linux_.td_i, now - linux_.prev_ts);
+                win_var_put(&linux_.td_i_ts, (tcph->ts_ > linux_.prev_rcv_ts ? tcph->ts_ - linux_.prev_rcv_ts : 0));
 
-
-                }
+                clock_rate = win_var_sum(&linux_.td_i)/win_var_sum(&linux_.td_i_ts);
+                linux_.ack_var = win_var_sum(&linux_.td_i) - win_var_sum(&linux_.td_i_ts);
 
                 linux_.prev_ts = now;            
                 linux_.prev_rcv_ts = (tcph->ts_ > linux_.prev_rcv_ts ? tcph->ts_ : linux_.prev_rcv_ts); 
@@ -456,20 +420,28 @@ void LinuxTcpAgent::recv(Packet *pkt, Handler*)
 
             }
 
-            if (!linux_.output_file)
-                linux_.output_file = fopen("output", "w");
-
-            fprintf(linux_.output_file, "%lf "TIME_FORMAT" %lf %d %u %u %u %lf %lf %d %lf\n", tcph->ts_, tcph->ts_echo_, now, tcph->seqno_, ack, linux_.snd_cwnd, linux_.snd_ssthresh, clock_rate, now - tcph->ts_echo_, int(t_rtt_), 
-                    linux_.ack_var);
+        }
+        
+        if (linux_.trace) {
+                struct ns_linux_trace_rec rec;
+                rec.type = NS_LINUX_TRACE_ACK;
+                rec.pad = 0;
+                rec.u.ack.ts = tcph->ts_;
+                rec.u.ack.ts_echo = tcph->ts_echo_;
+                rec.u.ack.now = now;
+                rec.u.ack.clock_rate = clock_rate;
+                rec.u.ack.rtt = now - tcph->ts_echo_;
+                rec.u.ack.ack_var = linux_.ack_var;
+                rec.u.ack.seqno = tcph->seqno_;
+                rec.u.ack.ack = ack;
+                rec.u.ack.cwnd = linux_.snd_cwnd;
+                rec.u.ack.ssthresh = linux_.snd_ssthresh;
+                rec.u.ack.t_rtt = int(t_rtt_);
+                rec.u.ack.pad = 0;
+                ns_linux_trace_write(linux_.trace, &rec);
         }
         
         
-	if (linux_.icsk_ca_ops) {
-		//This has to be done before the first call to linux_.icsk_ca_ops.
-		paramManager.load_local();
-		//After this call, all return must be done after a paramManager.restore_default, or save_to_linux (which inclues restore_default).
-	};
-
 	if (hdr_flags::access(pkt)->ecnecho() && ecn_ && (ack>1)) {
 		//ecn(tcph->seqno());
 		flag |= FLAG_ECE;			//ECN
@@ -506,7 +478,7 @@ void LinuxTcpAgent::recv(Packet *pkt, Handler*)
 			if ((flag & FLAG_UNSURE_TSTAMP) || (!bugfix_ts_)) {
 				last_ackt = 0;
 			} else {
-			        double then = tss[tcph->seqno() % tss_size_];
+			        double then = tss_.ts(tcph->seqno());
 				last_ackt = (s64)trunc(then*1000000000);
 			};	
 			linux_.icsk_ca_ops->pkts_acked(sk, ack - prior_snd_una, last_ackt);
@@ -554,7 +526,6 @@ void LinuxTcpAgent::recv(Packet *pkt, Handler*)
 	
 	if (linux_.icsk_ca_ops) {
 		save_from_linux();
-		paramManager.restore_default();
 	};
         
        
@@ -578,7 +549,7 @@ void LinuxTcpAgent::touch_cwnd() {
 }
 void LinuxTcpAgent::tcp_moderate_cwnd()
 {
-	linux_.snd_cwnd = min((int)linux_.snd_cwnd, packets_in_flight()+ tcp_max_burst);	//max
+	linux_.snd_cwnd = min((int)linux_.snd_cwnd, packets_in_flight()+ param_sk(&linux_, tcp_max_burst));	//max
 	touch_cwnd();
 }
 
@@ -648,7 +619,6 @@ void LinuxTcpAgent::tcp_fastretrans_alert(unsigned char flag)
 
 void LinuxTcpAgent::enter_loss() 
 {
-	paramManager.load_local();
 	touch_cwnd();
 	if (linux_.icsk_ca_ops==NULL) {
 		slowdown(CLOSE_SSTHRESH_HALF|CLOSE_CWND_RESTART);
@@ -687,7 +657,6 @@ void LinuxTcpAgent::enter_loss()
 	//scb_->ClearScoreBoard();
 	scb_->MarkLoss(highest_ack_+1, t_seqno_);
 	//In Linux, we don't clear scoreboard in timeout, unless it's SACK Renege. We don't consider SACK Renege here.
-	paramManager.restore_default();
 
 }
 
@@ -720,6 +689,7 @@ void LinuxTcpAgent::timeout(int tno)
 		next_pkts_in_flight_ = 0;
 		linux_.bytes_acked = 0;
 		save_from_linux();
+		pace_timer_.force_cancel();
 		send_much(0, TCP_REASON_TIMEOUT);
 	} else {
 		/* we do not know what it is */
@@ -750,6 +720,10 @@ void LinuxTcpAgent::send_much(int force, int reason, int maxburst)
         
 	if (!force && delsnd_timer_.status() == TIMER_PENDING)
 		return;
+	/* a paced quantum is still on its way out */
+	if (!force && linux_.pacing_rate > 0 &&
+	    pace_timer_.status() == TIMER_PENDING)
+		return;
 	
        
         /* 
@@ -779,8 +753,10 @@ void LinuxTcpAgent::send_much(int force, int reason, int maxburst)
 				 * if there is no more application data to send,
 				 * do nothing
 				 */
-				if (t_seqno_ >= curseq_) 
+				if (t_seqno_ >= curseq_) {
+					pace(npacket);
 					return;
+				}
 				found = 1;
 				xmit_seqno = t_seqno_++;
 			} else {
@@ -813,17 +789,49 @@ void LinuxTcpAgent::send_much(int force, int reason, int maxburst)
 			 * Set a delayed send timeout.
 			 */
 			delsnd_timer_.resched(Random::uniform(overhead_));
+			pace(npacket);
 			return;
 		}
 		if (maxburst && npacket >= maxburst)
 			break;
+		if (linux_.pacing_rate > 0 && npacket >= pace_quantum_)
+			break;
 	} /* while */
+	pace(npacket);
         
 	/* call helper function */
 	send_helper(maxburst);
 }
 
 
+/*
+ * The npacket packets just sent take npacket/pacing_rate seconds at the
+ * rate the congestion control module asked for; send_much holds back the
+ * next quantum until then.
+ */
+void LinuxTcpAgent::pace(int npacket)
+{
+	if (npacket > 0 && linux_.pacing_rate > 0)
+		pace_timer_.resched(npacket / linux_.pacing_rate);
+}
+
+void LinuxPaceTimer::expire(Event *)
+{
+	a_->send_much(0, 0, a_->maxburst_);
+}
+
+void LinuxTcpAgent::alloc_ack_history()
+{
+	win_var_init(&linux_.td_i, td_capacity_);
+	win_var_init(&linux_.td_i_ts, td_capacity_);
+}
+
+void LinuxTcpAgent::free_ack_history()
+{
+	win_var_free(&linux_.td_i);
+	win_var_free(&linux_.td_i_ts);
+}
+
 ////////////////////   Linux Module control part /////////////////////////////
 void LinuxTcpAgent::load_to_linux()
 {
@@ -892,6 +900,8 @@ char LinuxTcpAgent::install_congestion_control(const char* name)
                 	if (linux_.icsk_ca_ops !=NULL ) {
 				if (linux_.icsk_ca_ops->release) 
 					linux_.icsk_ca_ops->release(&linux_);
+				memset(linux_.icsk_ca_priv, 0, ICSK_CA_PRIV_SIZE);
+				linux_.pacing_rate = 0;
 				save_from_linux();
 			} else {
 				load_to_linux_once();
@@ -923,6 +933,8 @@ void LinuxTcpAgent::remove_congestion_control()
 	if (linux_.icsk_ca_ops != NULL) {
 		if (linux_.icsk_ca_ops->release)
 			linux_.icsk_ca_ops->release(&linux_);
+		memset(linux_.icsk_ca_priv, 0, ICSK_CA_PRIV_SIZE);
+		linux_.pacing_rate = 0;
 		save_from_linux();
 		linux_.icsk_ca_ops = NULL;		
 	}
@@ -943,6 +955,7 @@ int LinuxTcpAgent::command(int argc, const char*const* argv)
 		if (!paramManager.set_param(argv[2], argv[3], atoi(argv[4]))) {
 			printf("Error: do not find %s as a parameter for congestion control algorithm %s\n", argv[3], argv[2]);
 		};
+		linux_.params = paramManager.block();
 		return (TCL_OK);
 	};
 	if ((argc>=4) && (strcmp(argv[1], "get_ca_param")==0)) {
@@ -979,6 +992,60 @@ int LinuxTcpAgent::command(int argc, const char*const* argv)
 		};
 		return (TCL_OK);
 	};
+	if ((argc>=3) && (strcmp(argv[1], "ack_clock")==0)) {
+		// ack_clock on | off | <src node> <dst node>
+		if (strcmp(argv[2], "on")==0) {
+			ack_clock_ = ACK_CLOCK_ALL;
+		} else if (strcmp(argv[2], "off")==0) {
+			ack_clock_ = ACK_CLOCK_OFF;
+		} else if (argc>=4) {
+			ack_clock_ = ACK_CLOCK_FLOW;
+			ack_clock_src_ = atoi(argv[2]);
+			ack_clock_dst_ = atoi(argv[3]);
+		} else {
+			printf("Error: usage: %s ack_clock on|off|<src node> <dst node>\n", argv[0]);
+			return (TCL_ERROR);
+		}
+		return (TCL_OK);
+	};
+	if ((argc==3) && (strcmp(argv[1], "set_ack_history")==0)) {
+		// set_ack_history <capacity>: samples kept by the ACK clock-rate estimator
+		int capacity = atoi(argv[2]);
+		if (capacity < 1) {
+			printf("Error: the ACK history needs at least one entry\n");
+			return (TCL_ERROR);
+		}
+		td_capacity_ = capacity;
+		free_ack_history();
+		linux_.prev_ts = 0;
+		return (TCL_OK);
+	};
+	if ((argc==3) && (strcmp(argv[1], "set_pace_quantum")==0)) {
+		// set_pace_quantum <packets>: packets sent back to back when paced
+		int quantum = atoi(argv[2]);
+		if (quantum < 1) {
+			printf("Error: the pacing quantum needs at least one packet\n");
+			return (TCL_ERROR);
+		}
+		pace_quantum_ = quantum;
+		return (TCL_OK);
+	};
+	if ((argc>=3) && (strcmp(argv[1], "open_linux_trace")==0)) {
+		// open_linux_trace <file> [mmap]
+		ns_linux_trace_close(linux_.trace);
+		int use_mmap = (argc>=4) && (strcmp(argv[3], "mmap")==0);
+		linux_.trace = ns_linux_trace_open(argv[2], use_mmap);
+		if (!linux_.trace) {
+			printf("Error: cannot open %s as the trace file\n", argv[2]);
+			return (TCL_ERROR);
+		}
+		return (TCL_OK);
+	};
+	if ((argc==2) && (strcmp(argv[1], "close_linux_trace")==0)) {
+		ns_linux_trace_close(linux_.trace);
+		linux_.trace = NULL;
+		return (TCL_OK);
+	};
 	return (TcpAgent::command(argc, argv));
 
 }
@@ -1027,8 +1094,15 @@ bool LinuxParamManager::set_default_param(const char* proto, const char* param,
 
 bool LinuxParamManager::set_param(const char* proto, const char* param, const int value) {
 	struct cc_param_list* p = find_param_by_proto_name(proto, param);
-	if (!p) return false;
-	localValues.set_param((int*)p->ptr, value);
+	if ((!p) || (p->slot < 0)) return false;
+	if (!block_) {
+		int n = linux_param_count();
+		block_ = new int*[n];
+		local_ = new int[n];
+		for (int i = 0; i < n; i++) block_[i] = linux_param_addr(i);
+	};
+	local_[p->slot] = value;
+	block_[p->slot] = &local_[p->slot];
 	return true;
 };
 
@@ -1042,7 +1116,10 @@ bool LinuxParamManager::get_default_param(const char* proto, const char* param,
 bool LinuxParamManager::get_param(const char* proto, const char* param, int* valuep) {
 	struct cc_param_list* p = find_param_by_proto_name(proto, param);
 	if (!p) return false;
-	if (localValues.get_param((int*)p->ptr, valuep)) return true;
+	if (block_ && (p->slot >= 0) && (block_[p->slot] == &local_[p->slot])) {
+		*valuep = local_[p->slot];
+		return true;
+	};
 	*valuep = *((int*)(p->ptr));
 	return true;
 };
@@ -1060,70 +1137,8 @@ bool LinuxParamManager::query_param(const char* proto) {
 	}; 
 	return true;
 };
-/** Get a local value for a TCP */
-bool ParamList::get_param(int* address, int* valuep) {
-	struct paramNode *p = head;
-	while (p && (p->addr != address)) p = p->next;
-	if (p) {
-		*valuep = p->value;
-		return true;
-	};
-	return false;
-};
-
-/** Set a local value for a TCP */
-void ParamList::set_param(int* address, int value) {
-	struct paramNode *p = head;
-	while ((p) && (p->addr != address)) {
-		p = p->next;
-	};
-	if (p) {
-		//we find one.
-		p->value = value;
-		return;
-	};
-	//Cannot find any
-	//Create a new entry
-	p = new struct paramNode;
-	p->addr = address; 
-	p->value = value;
-	p->default_value = *address;
-	p->next = head;
-	head = p;
-};
-
-/** Refresh all the values in the list */
-void ParamList::refresh_default() {
-	struct paramNode *p = head;
-	while (p) {
-		p->default_value = *(p->addr);
-		p = p->next;
-	};
-};
-
-void ParamList::restore_default() {
-	struct paramNode *p = head;
-	while (p) {
-		p->value = *(p->addr);
-		*(p->addr) = p->default_value;
-		p = p->next;
-	};
-};
-
-void ParamList::load_local() {
-	struct paramNode *p = head;
-	while (p) {
-		p->default_value = *(p->addr);
-		*(p->addr) = p->value;
-		p = p->next;
-	};
-};
-
-ParamList::~ParamList() {
-	while (head) {
-		struct paramNode *p = head;
-		head = head->next;
-		delete p;
-	};
+LinuxParamManager::~LinuxParamManager() {
+	delete [] block_;
+	delete [] local_;
 };
 
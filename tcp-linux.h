@@ -56,6 +56,8 @@
 #define ns_tcp_linux_h
 
 #include "tcp.h"
+#include "ip.h"
+#include "address.h"
 #include "scoreboard1.h"
 #include "linux/ns-linux-util.h"
 #include "string.h"
@@ -64,52 +66,49 @@
 #define DEBUG_LEVEL 0
 #define DEBUG(level, ...) if (DEBUG_LEVEL>=level) printf(__VA_ARGS__);
 
-/* A list to store the parameters */
-class ParamList {
-private:
-	struct paramNode {
-		int* addr;
-		int value;
-		int default_value;
-		struct paramNode* next;
-	};
-	struct paramNode* head;
-public:
-	ParamList():head(NULL) {};
-	~ParamList();
-	/** Add this parameter to the list and set the value */
-	void set_param(int* address, int value);
-	bool get_param(int* address, int* valuep);
-
-	/** Refresh all the values in the list */
-	void refresh_default();
-	
-	/** Restore the */ 
-	void restore_default();
-	void load_local();
-};
+/* Modes of the ACK clock-rate estimator */
+#define ACK_CLOCK_OFF 0
+#define ACK_CLOCK_ALL 1
+#define ACK_CLOCK_FLOW 2
 
 //This class provide C++ interface to access the Linux parameters for specific congestion control algorithm
 /* The manager of Linux parameters for each TCP */
 class LinuxParamManager {
 private:
-	ParamList localValues;
+	/* The parameter block of this TCP (see ns-linux-param.h): block_[slot]
+	 * points to local_[slot] for the parameters set by set_param, and to
+	 * the global value for the others.  NULL until the first set_param. */
+	int** block_;
+	int* local_;
 	static struct cc_list* find_cc_by_proto(const char* proto);
 	static struct cc_param_list* find_param_by_proto_name(const char* proto, const char* name);
 public:
-	LinuxParamManager(){};
+	LinuxParamManager():block_(NULL), local_(NULL) {};
+	~LinuxParamManager();
 	static bool set_default_param(const char* proto, const char* param, const int value);
 	static bool get_default_param(const char* proto, const char* param, int* valuep);
 	static bool query_param(const char* proto);
 	bool set_param(const char* proto, const char* param, const int value);
 	bool get_param(const char* proto, const char* param, int* valuep);
-	void load_local() {localValues.load_local();};
-	void restore_default() {localValues.restore_default();};
+	/** The block for tcp_sock.params */
+	int** block() {return block_;};
 };
 
 
+class LinuxTcpAgent;
+
+/* Releases the next quantum of a paced LinuxTcpAgent (see linux_.pacing_rate) */
+class LinuxPaceTimer : public TimerHandler {
+public:
+	LinuxPaceTimer(LinuxTcpAgent *a) : TimerHandler() { a_ = a; }
+protected:
+	virtual void expire(Event *e);
+	LinuxTcpAgent *a_;
+};
+
 /* TCP Linux */
 class LinuxTcpAgent : public TcpAgent {
+	friend class LinuxPaceTimer;
 private:	
 	LinuxParamManager paramManager;
 public:
@@ -134,6 +133,12 @@ protected:
 	bool initialized_;		// a flag to record if a congestion control algorithm is initialized or not
 					// ca_ops->init shall be run the first time an acknowledgment is processed (at least one RTT sample recorded).
 	TracedInt next_pkts_in_flight_;	//the # of packets in flight allowed, if we need rate halving
+	unsigned long td_capacity_;	// capacity of the ACK inter-arrival history (linux_.td_i/td_i_ts)
+	int ack_clock_;			// which ACKs feed the ACK clock-rate estimator: ACK_CLOCK_OFF, _ALL or _FLOW
+	int ack_clock_src_;		// with ACK_CLOCK_FLOW, only ACKs from node ack_clock_src_
+	int ack_clock_dst_;		//     to node ack_clock_dst_
+	LinuxPaceTimer pace_timer_;	// pending while the last quantum is still being paced out
+	int pace_quantum_;		// packets released back to back per pacing interval
         
      
 
@@ -161,6 +166,16 @@ protected:
 
 	void save_from_linux();				// the variables that shall be saved from Linux every ack
 
+	inline bool run_ack_clock(hdr_ip* iph) {
+		if (ack_clock_ == ACK_CLOCK_FLOW)
+			return (Address::instance().get_nodeaddr(iph->saddr()) == ack_clock_src_) &&
+				(Address::instance().get_nodeaddr(iph->daddr()) == ack_clock_dst_);
+		return (ack_clock_ == ACK_CLOCK_ALL);
+	};
+	void pace(int npacket);				// hold the next release for npacket packets at linux_.pacing_rate
+	void alloc_ack_history();			// allocate linux_.td_i/td_i_ts the first time the ACK clock-rate estimator runs
+	void free_ack_history();
+
 	char install_congestion_control(const char* name);
 	void remove_congestion_control();
 
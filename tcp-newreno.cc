@@ -150,7 +150,7 @@ NewRenoTcpAgent::dupack_action()
         }
 
         if (bug_fix_) {
-		if (bugfix_ts_ && tss[highest_ack_ % tss_size_] == ts_echo_)
+		if (bugfix_ts_ && tss_.ts(highest_ack_) == ts_echo_)
 			goto reno_action;
 		else if (bugfix_ack_ && cwnd_ > 1 && highest_ack_ - prev_highest_ack_ <= numdupacks_)
 			goto reno_action;
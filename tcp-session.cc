@@ -81,7 +81,8 @@ public:
 TcpSessionAgent::TcpSessionAgent() : CorresHost(), 
 	rtx_timer_(this), burstsnd_timer_(this), sessionSeqno_(0),
 	last_send_time_(-1), curConn_(0), numConsecSegs_(0), 
-	schedDisp_(FINE_ROUND_ROBIN), wtSum_(0), dynWtSum_(0) 
+	schedDisp_(FINE_ROUND_ROBIN), wtSum_(0), dynWtSum_(0),
+	strideHeap_(NULL), strideLen_(0), strideSize_(0), strideVtime_(0)
 {
 	bind("ownd_", &ownd_);
 	bind("owndCorr_", &owndCorrection_);
@@ -93,6 +94,11 @@ TcpSessionAgent::TcpSessionAgent() : CorresHost(),
 	sessionList_.append(this);
 }
 
+TcpSessionAgent::~TcpSessionAgent()
+{
+	delete [] strideHeap_;
+}
+
 int
 TcpSessionAgent::command(int argc, const char*const* argv)
 {
@@ -251,6 +257,7 @@ TcpSessionAgent::timeout(int tno)
 			curconn->recover_ = curconn->maxseq_;
 			curconn->last_cwnd_action_ = CWND_ACTION_TIMEOUT;
 		}
+		stride_activate_all();
 		while ((curseg = seg_iter()) != NULL) {
 			/* XXX exclude packets sent "recently"? */
 			curseg->size_ = 0;
@@ -298,6 +305,7 @@ TcpSessionAgent::timeout(int tno)
 			curconn->recover_ = curconn->maxseq_;
 			curconn->last_cwnd_action_ = CWND_ACTION_TIMEOUT;
 		}
+		stride_activate_all();
 		while ((curseg = seg_iter()) != NULL) {
 			/* XXX exclude packets sent "recently"? */
 			curseg->size_ = 0;
@@ -420,17 +428,115 @@ TcpSessionAgent::who_to_snd(int how)
 		} while (next && !next->data_left_to_send());
 		return(next);
 	}
+	/* stride scheduling on wt_, over the connections with data */
+	case STRIDE: {
+		IntTcpAgent *next;
+
+		while (strideLen_ > 0) {
+			next = strideHeap_[0];
+			if (next->data_left_to_send()) {
+				strideVtime_ = next->pass_;
+				next->pass_ += 1.0/(next->wt_ > 0 ? next->wt_ : 1);
+				stride_down(0);
+				return next;
+			}
+			/* nothing to send: out of the heap until reactivated */
+			next->strideIdx_ = -1;
+			if (--strideLen_ > 0) {
+				stride_set(0, strideHeap_[strideLen_]);
+				stride_down(0);
+			}
+		}
+		return NULL;
+	}
 	default:
 		return NULL;
 	}
 }
 
 void
-TcpSessionAgent::send_much(IntTcpAgent* /*agent*/, int force, int reason) 
+TcpSessionAgent::stride_set(int i, IntTcpAgent *tcp)
+{
+	strideHeap_[i] = tcp;
+	tcp->strideIdx_ = i;
+}
+
+void
+TcpSessionAgent::stride_up(int i)
+{
+	IntTcpAgent *tcp = strideHeap_[i];
+
+	while (i > 0 && strideHeap_[(i-1)/2]->pass_ > tcp->pass_) {
+		stride_set(i, strideHeap_[(i-1)/2]);
+		i = (i-1)/2;
+	}
+	stride_set(i, tcp);
+}
+
+void
+TcpSessionAgent::stride_down(int i)
+{
+	IntTcpAgent *tcp = strideHeap_[i];
+	int c;
+
+	while ((c = 2*i+1) < strideLen_) {
+		if (c+1 < strideLen_ && 
+		    strideHeap_[c+1]->pass_ < strideHeap_[c]->pass_)
+			c++;
+		if (strideHeap_[c]->pass_ >= tcp->pass_)
+			break;
+		stride_set(i, strideHeap_[c]);
+		i = c;
+	}
+	stride_set(i, tcp);
+}
+
+/*
+ * Put a connection that has data to send (back) in the STRIDE heap.
+ * It gets no credit for the time it had nothing to send.  This is
+ * done whatever schedDisp_ is, so that STRIDE can be switched to.
+ */
+void
+TcpSessionAgent::stride_activate(IntTcpAgent *tcp)
+{
+	if (tcp->strideIdx_ >= 0 || !tcp->data_left_to_send())
+		return;
+	if (strideLen_ == strideSize_) {
+		IntTcpAgent **heap;
+
+		strideSize_ = strideSize_ ? 2*strideSize_ : 16;
+		heap = new IntTcpAgent*[strideSize_];
+		for (int i = 0; i < strideLen_; i++)
+			heap[i] = strideHeap_[i];
+		delete [] strideHeap_;
+		strideHeap_ = heap;
+	}
+	if (tcp->pass_ < strideVtime_)
+		tcp->pass_ = strideVtime_;
+	stride_set(strideLen_++, tcp);
+	stride_up(strideLen_-1);
+}
+
+/* after a timeout, when every connection may have data to resend */
+void
+TcpSessionAgent::stride_activate_all()
+{
+	Islist_iter<IntTcpAgent> conn_iter(conns_);
+	IntTcpAgent *tcp;
+
+	while ((tcp = conn_iter()) != NULL)
+		stride_activate(tcp);
+}
+
+void
+TcpSessionAgent::send_much(IntTcpAgent* agent, int force, int reason) 
 {
 	int npackets = 0;
 	Islist_iter<Segment> seg_iter(seglist_);
 
+	/* agent may have new data to send */
+	if (agent)
+		stride_activate(agent);
 	if (reason != TCP_REASON_TIMEOUT &&
 	    burstsnd_timer_.status() == TIMER_PENDING)
 		return;
@@ -533,13 +639,12 @@ TcpSessionAgent::setflags(Packet *pkt)
 int
 TcpSessionAgent::findSessionSeqno(IntTcpAgent *sender, int seqno)
 {
-	Islist_iter<Segment> seg_iter(seglist_);
 	Segment *cur;
 	int min = sessionSeqno_;
 	
-	while ((cur = seg_iter()) != NULL) {
-		if (sender == cur->sender_ && cur->seqno_ >= seqno && 
-		    cur->sessionSeqno_ < min)
+	/* only this sender's segments need to be looked at */
+	for (cur = sender->segHead_; cur != NULL; cur = cur->cnext_) {
+		if (cur->seqno_ >= seqno && cur->sessionSeqno_ < min)
 			min = cur->sessionSeqno_;
 	}
 	if (min == sessionSeqno_) {
@@ -553,16 +658,13 @@ TcpSessionAgent::findSessionSeqno(IntTcpAgent *sender, int seqno)
 void
 TcpSessionAgent::removeSessionSeqno(int sessionSeqno) 
 {
-	Islist_iter<Segment> seg_iter(seglist_);
-	Segment *cur, *prev=NULL;
+	Segment *cur = find_seg(sessionSeqno);
 	
-	while ((cur = seg_iter()) != NULL) {
-		if (cur->sessionSeqno_ == sessionSeqno) {
-			seglist_.remove(cur, prev);
-			adjust_ownd(cur->size_);
-			return;
-		}
-		prev = cur;
+	if (cur != NULL) {
+		seg_remove(cur);
+		adjust_ownd(cur->size_);
+		free_seg(cur);
+		return;
 	}
 	printf("In removeSessionSeqno(): unable to find segment with sessionSeqno = %d\n", sessionSeqno);
 }
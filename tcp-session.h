@@ -46,6 +46,7 @@
 #define FINE_ROUND_ROBIN 1
 #define COARSE_ROUND_ROBIN 2
 #define RANDOM 3
+#define STRIDE 4
 
 class TcpSessionAgent;
 
@@ -81,6 +82,7 @@ protected:
 class TcpSessionAgent : public CorresHost {
 public:
 	TcpSessionAgent();
+	~TcpSessionAgent();
 	int command(int argc, const char*const* argv);
 	void reset_rtx_timer(int mild, int backoff = 1); /* XXX mild needed ? */
 	void set_rtx_timer();
@@ -98,6 +100,8 @@ public:
 	void set_weight(IntTcpAgent *tcp, int wt);
 	void reset_dyn_weights();
 	IntTcpAgent *who_to_snd(int how);
+	void stride_activate(IntTcpAgent *tcp);
+	void stride_activate_all();
 	void send_much(IntTcpAgent *agent, int force, int reason); 
 	void recv(IntTcpAgent *agent, Packet *pkt, int amt_data_acked);
 	void setflags(Packet *pkt);
@@ -121,6 +125,17 @@ protected:
 	int schedDisp_;
 	int wtSum_;
 	int dynWtSum_;
+	/*
+	 * Stride scheduling: the connections with data to send are kept in a
+	 * heap on their pass_, which advances by 1/wt_ per pkt sent.
+	 */
+	IntTcpAgent **strideHeap_;
+	int strideLen_;
+	int strideSize_;
+	double strideVtime_;	/* pass_ of the last connection picked */
+	void stride_up(int i);
+	void stride_down(int i);
+	void stride_set(int i, IntTcpAgent *tcp);
 };
 
 #endif
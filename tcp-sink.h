@@ -37,6 +37,7 @@
 #define ns_tcpsink_h
 
 #include <math.h>
+#include <stdint.h>
 #include "agent.h"
 #include "tcp.h"
 
@@ -55,7 +56,7 @@ class TcpSink;
 class Acker {
 public:
 	Acker();
-	virtual ~Acker() { delete[] seen_; }
+	virtual ~Acker() { delete[] seen_; delete[] seen_map_; }
 	void update_ts(int seqno, double ts, int rfc1323 = 0);
 	int update(int seqno, int numBytes);
 	void update_ecn_unacked(int value);
@@ -73,7 +74,29 @@ protected:
 	int wndmask_;		/* window mask - either MWM or HS_MWM - Sylvia */ 
 	int ecn_unacked_;	/* ECN forwarded to sender, but not yet
 				 * acknowledged. */
-	int *seen_;		/* array of packets seen */
+	int *seen_;		/* bytes seen of each packet */
+	uint64_t *seen_map_;	/* bitmap of the packets seen (seen_ != 0) */
+	/*
+	 * seq indexes both seen_ and seen_map_ modulo wndmask_+1, which
+	 * is a power of 2 and at least 64, so a word of seen_map_ holds
+	 * 64 consecutive packets, from a multiple of 64.
+	 */
+	inline uint64_t& seen_word(int seq) const {
+		return seen_map_[(seq & wndmask_) >> 6];
+	}
+	inline int seen(int seq) const {
+		return ((seen_word(seq) >> (seq & 63)) & 1);
+	}
+	inline void mark_seen(int seq, int numBytes) {
+		seen_[seq & wndmask_] = numBytes;
+		if (numBytes)
+			seen_word(seq) |= (uint64_t)1 << (seq & 63);
+		else
+			seen_word(seq) &= ~((uint64_t)1 << (seq & 63));
+	}
+	void clear_seen(int from, int to);	// mark [from, to) unseen
+	int next_hole(int from, int to) const;	// first unseen in [from, to)
+	int prev_hole(int from, int to) const;	// last unseen in [from, to)
 	double ts_to_echo_;	/* timestamp to echo to peer */
 	int is_dup_;		// A duplicate packet.
 public:
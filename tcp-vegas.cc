@@ -81,18 +81,13 @@ public:
 } class_vegas;
 
 
-VegasTcpAgent::VegasTcpAgent() : TcpAgent()
+VegasTcpAgent::VegasTcpAgent() : TcpAgent(),
+	v_sent_(SentTable::TS | SentTable::TRANSMITS, -1.)
 {
-	v_sendtime_ = NULL;
-	v_transmits_ = NULL;
 }
 
 VegasTcpAgent::~VegasTcpAgent()
 {
-	if (v_sendtime_)
-		delete []v_sendtime_;
-	if (v_transmits_)
-		delete []v_transmits_;
 }
 
 void
@@ -301,15 +296,9 @@ VegasTcpAgent::recv(Packet *pkt, Handler *)
 		 */
 
 		// reset v_sendtime for acked pkts and incr v_transmits_
-		double sendTime = v_sendtime_[tcph->seqno()%v_maxwnd_];
-		int transmits = v_transmits_[tcph->seqno()% v_maxwnd_];
-		int range = tcph->seqno() - oldack;
-		for(int k=((oldack+1) %v_maxwnd_); 
-			k<=(tcph->seqno()%v_maxwnd_) && range >0 ; 
-			k=((k+1) % v_maxwnd_), range--) {
-			v_sendtime_[k] = -1.0;
-			v_transmits_[k] = 0;
-		}
+		double sendTime = v_sent_.ts(tcph->seqno());
+		int transmits = v_sent_.transmits(tcph->seqno());
+		v_sent_.clear(oldack+1, tcph->seqno());
 
 		if((sendTime !=0.) && (transmits==1)) {
 			 // update fine-grained timeout value, v_timeout_.
@@ -353,8 +342,8 @@ VegasTcpAgent::recv(Packet *pkt, Handler *)
 		++dupacks_; 
 		int expired=vegas_expire(pkt);
 		if (expired>=0 || dupacks_ == numdupacks_) {
-			double sendTime=v_sendtime_[(last_ack_+1) % v_maxwnd_]; 
-			int transmits=v_transmits_[(last_ack_+1) % v_maxwnd_];
+			double sendTime=v_sent_.ts(last_ack_+1); 
+			int transmits=v_sent_.transmits(last_ack_+1);
        	                /* The line below, for "bug_fix_" true, avoids
                         * problems with multiple fast retransmits after
 			* a retransmit timeout.
@@ -464,24 +453,13 @@ VegasTcpAgent::output(int seqno, int reason)
 	/* if this is the 1st pkt, setup senttime[] and transmits[]
 	 * I alloc mem here, instrad of in the constructor, to cover
 	 * cases which windows get set by each different tcp flows */
-	if (seqno==0) {
-		v_maxwnd_ = int(wnd_);
-		if (v_sendtime_)
-			delete []v_sendtime_;
-        	if (v_transmits_)
-               		delete []v_transmits_;
-		v_sendtime_ = new double[v_maxwnd_];
-		v_transmits_ = new int[v_maxwnd_];
-		for(int i=0;i<v_maxwnd_;i++) {
-			v_sendtime_[i] = -1.;
-			v_transmits_[i] = 0;
-		}
-	}
+	if (seqno==0)
+		v_sent_.reset(int(wnd_));
 
 	// record a find grained send time and # of transmits 
-	int index = seqno % v_maxwnd_;
-	v_sendtime_[index] = vegastime();  
-	++v_transmits_[index];
+	v_sent_.fit(last_ack_+1, seqno);
+	v_sent_.ts(seqno) = vegastime();  
+	++v_sent_.transmits(seqno);
 
 	/* support ndatabytes_ in output - Lloyd Wood 14 March 2000 */
 	int bytes = hdr_cmn::access(p)->size(); 
@@ -518,7 +496,7 @@ int
 VegasTcpAgent::vegas_expire(Packet* pkt)
 {
 	hdr_tcp *tcph = hdr_tcp::access(pkt);
-	double elapse = vegastime() - v_sendtime_[(tcph->seqno()+1)%v_maxwnd_];
+	double elapse = vegastime() - v_sent_.ts(tcph->seqno()+1);
 	if (elapse >= v_timeout_) {
 		return(tcph->seqno()+1);
 	}
@@ -38,6 +38,7 @@ static const char rcsid[] =
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <sys/types.h>
 #include "ip.h"
@@ -63,6 +64,11 @@ public:
 	TclObject* create(int , const char*const*) {
 		return (new TcpAgent());
 	}
+	virtual void bind() {
+		TclClass::bind();
+		/* the default of hstcp_table_, which ns-default.tcl does not set */
+		Tcl::instance().evalf("%s set hstcp_table_ 0", classname_);
+	}
 } class_tcp;
 
 TcpAgent::TcpAgent() 
@@ -71,7 +77,7 @@ TcpAgent::TcpAgent()
           cwnd_(0), ssthresh_(0), maxseq_(0), count_(0), 
           rtt_active_(0), rtt_seq_(-1), rtt_ts_(0.0), 
           lastreset_(0.0), closed_(0), t_rtt_(0), t_srtt_(0), t_rttvar_(0), 
-	  t_backoff_(0), ts_peer_(0), ts_echo_(0), tss(NULL), tss_size_(100), 
+	  t_backoff_(0), ts_peer_(0), ts_echo_(0), tss_(SentTable::TS, 0.0), 
 	  rtx_timer_(this), delsnd_timer_(this), burstsnd_timer_(this), 
 	  first_decrease_(1), fcnt_(0), nrexmit_(0), restart_bugfix_(1), 
           cong_action_(0), ecn_burst_(0), ecn_backoff_(0), ect_(0), 
@@ -177,6 +183,7 @@ TcpAgent::delay_bind_init_all()
 	delay_bind_init_one("high_decrease_");
 	delay_bind_init_one("max_ssthresh_");
 	delay_bind_init_one("cwnd_range_");
+	delay_bind_init_one("hstcp_table_");
 	delay_bind_init_one("timerfix_");
 	delay_bind_init_one("rfc2988_");
 	delay_bind_init_one("singledup_");
@@ -289,6 +296,7 @@ TcpAgent::delay_bind_dispatch(const char *varName, const char *localName, TclObj
 	if (delay_bind(varName, localName, "high_decrease_", &high_decrease_, tracer)) return TCL_OK;
 	if (delay_bind(varName, localName, "max_ssthresh_", &max_ssthresh_, tracer)) return TCL_OK;
 	if (delay_bind(varName, localName, "cwnd_range_", &cwnd_range_, tracer)) return TCL_OK;
+	if (delay_bind_bool(varName, localName, "hstcp_table_", &hstcp_table_, tracer)) return TCL_OK;
 	if (delay_bind_bool(varName, localName, "timerfix_", &timerfix_, tracer)) return TCL_OK;
 	if (delay_bind_bool(varName, localName, "rfc2988_", &rfc2988_, tracer)) return TCL_OK;
         if (delay_bind(varName, localName, "singledup_", &singledup_ , tracer)) return TCL_OK;
@@ -509,6 +517,7 @@ TcpAgent::reset()
         	hstcp_.p1 = 
 		  log(hstcp_.low_p) - log(low_window_) * highLowP/highLowWin;
 		hstcp_.p2 = highLowP/highLowWin;
+		hstcp_.table = NULL;	/* looked up again for these params */
 	}
 
 	if (QOption_) {
@@ -652,6 +661,119 @@ int TcpAgent::headersize()
         return (total);
 }
 
+SentTable::~SentTable()
+{
+	free(ts_);
+	free(transmits_);
+	free(cwnd_);
+}
+
+void SentTable::alloc(int size)
+{
+	if (fields_ & TS)
+		ts_ = (double *)malloc(size * sizeof(double));
+	if (fields_ & TRANSMITS)
+		transmits_ = (int *)malloc(size * sizeof(int));
+	if (fields_ & CWND)
+		cwnd_ = (double *)malloc(size * sizeof(double));
+	if (((fields_ & TS) && ts_ == NULL) ||
+	    ((fields_ & TRANSMITS) && transmits_ == NULL) ||
+	    ((fields_ & CWND) && cwnd_ == NULL)) {
+		fprintf(stderr, "SentTable: can't allocate %d entries\n", size);
+		exit(1);
+	}
+	mask_ = size - 1;
+}
+
+// Empty the entries i..i+n-1, which must not wrap around.
+void SentTable::empty(int i, int n)
+{
+	int k;
+	if (ts_)
+		for (k = i; k < i + n; k++)
+			ts_[k] = empty_;
+	if (transmits_)
+		memset(transmits_ + i, 0, n * sizeof(int));
+	if (cwnd_)
+		for (k = i; k < i + n; k++)
+			cwnd_[k] = empty_;
+}
+
+void SentTable::reset(int size)
+{
+	int n = 16;
+	while (n < size)
+		n <<= 1;
+	if (n != mask_ + 1) {
+		free(ts_);
+		free(transmits_);
+		free(cwnd_);
+		ts_ = cwnd_ = NULL;
+		transmits_ = NULL;
+		alloc(n);
+	}
+	empty(0, n);
+}
+
+/*
+ * Make room for seqno hi.  The entries of [lo, lo+size()) are kept
+ *   if the table has to grow.
+ */
+void SentTable::fit(int lo, int hi)
+{
+	if (!valid()) {
+		reset(hi - lo + 1);
+		return;
+	}
+	if (hi - lo <= mask_)
+		return;
+	int n = mask_ + 1;
+	while (hi - lo >= n)
+		n <<= 1;
+	int omask = mask_;
+	double *ts = ts_, *cwnd = cwnd_;
+	int *transmits = transmits_;
+	ts_ = cwnd_ = NULL;
+	transmits_ = NULL;
+	alloc(n);
+	empty(0, n);
+	for (int s = lo; s <= lo + omask; s++) {
+		if (ts)
+			ts_[s & mask_] = ts[s & omask];
+		if (transmits)
+			transmits_[s & mask_] = transmits[s & omask];
+		if (cwnd)
+			cwnd_[s & mask_] = cwnd[s & omask];
+	}
+	free(ts);
+	free(transmits);
+	free(cwnd);
+}
+
+void SentTable::clear(int lo, int hi)
+{
+	int n = hi - lo + 1;
+	if (n <= 0 || !valid())
+		return;
+	if (n > mask_) {
+		empty(0, mask_ + 1);
+		return;
+	}
+	int i = lo & mask_;
+	if (i + n <= mask_ + 1)
+		empty(i, n);
+	else {
+		empty(i, mask_ + 1 - i);
+		empty(0, n - (mask_ + 1 - i));
+	}
+}
+
+void SentTable::fill_cwnd(double cwnd)
+{
+	for (int k = 0; k <= mask_; k++)
+		cwnd_[k] = cwnd;
+}
+
 void TcpAgent::output(int seqno, int reason)
 {
 	int force_set_rtx_timer = 0;
@@ -692,26 +814,10 @@ void TcpAgent::output(int seqno, int reason)
  
         // store timestamps, with bugfix_ts_.  From Andrei Gurtov. 
 	// (A real TCP would use scoreboard for this.)
-        if (bugfix_ts_ && tss==NULL) {
-                tss = (double*) calloc(tss_size_, sizeof(double));
-                if (tss==NULL) exit(1);
-        }
-        //dynamically grow the timestamp array if it's getting full
-        if (bugfix_ts_ && ((seqno - highest_ack_) > tss_size_* 0.9)) {
-                double *ntss;
-                ntss = (double*) calloc(tss_size_*2, sizeof(double));
-                printf("%p resizing timestamp table\n", this);
-                if (ntss == NULL) exit(1);
-                for (int i=0; i<tss_size_; i++)
-                        ntss[(highest_ack_ + i) % (tss_size_ * 2)] =
-                                tss[(highest_ack_ + i) % tss_size_];
-                free(tss);
-                tss_size_ *= 2;
-                tss = ntss;
-        }
- 
-        if (tss!=NULL)
-                tss[seqno % tss_size_] = tcph->ts(); 
+	if (bugfix_ts_)
+		tss_.fit(highest_ack_, seqno);
+	if (tss_.valid())
+		tss_.ts(seqno) = tcph->ts();
 
 	tcph->ts_echo() = ts_peer_;
 	tcph->reason() = reason;
@@ -1079,12 +1185,73 @@ int TcpAgent::numdupacks(double cwnd)
 	}
 }
 
+/*
+ * The HighSpeed TCP tables, one per parameter set.
+ */
+static hstcp_table *hstcp_tables_ = NULL;
+
+/*
+ * Find (or build) the table for the current HighSpeed TCP parameters.
+ * increase[] and decrease[] hold exactly what increase_param() and
+ * decrease_param() compute at each integer window.
+ */
+hstcp_table* TcpAgent::hstcp_get_table()
+{
+	hstcp_table *t;
+	for (t = hstcp_tables_; t != NULL; t = t->next) {
+		if (t->low_window == low_window_ && 
+		    t->high_window == high_window_ &&
+		    t->p1 == hstcp_.p1 && t->p2 == hstcp_.p2 &&
+		    t->dec1 == hstcp_.dec1 && t->dec2 == hstcp_.dec2)
+			return t;
+	}
+	if (high_window_ <= low_window_)
+		return NULL;
+	int size = high_window_ - low_window_ + 1;
+	t = new hstcp_table;
+	t->low_window = low_window_;
+	t->high_window = high_window_;
+	t->p1 = hstcp_.p1;
+	t->p2 = hstcp_.p2;
+	t->dec1 = hstcp_.dec1;
+	t->dec2 = hstcp_.dec2;
+	t->increase = new double[size];
+	t->decrease = new double[size];
+	for (int i = 0; i < size; i++) {
+		double w = low_window_ + i;
+		double p = exp(hstcp_.p1 + log(w) * hstcp_.p2);
+		t->decrease[i] = hstcp_.dec1 + log(w) * hstcp_.dec2;
+		t->increase[i] = w * w * p /(1/t->decrease[i] - 0.5);
+	}
+	t->next = hstcp_tables_;
+	hstcp_tables_ = t;
+	return t;
+}
+
+/*
+ * Interpolate tab[] (of hstcp_.table) at cwnd_,
+ * for low_window_ <= cwnd_ < high_window_.
+ */
+double TcpAgent::hstcp_lookup(const double *tab)
+{
+	int i = (int)cwnd_ - hstcp_.table->low_window;
+	double frac = cwnd_ - (int)cwnd_;
+	return tab[i] + frac * (tab[i+1] - tab[i]);
+}
+
 /*
  * Calculating the decrease parameter for highspeed TCP.
  */
 double TcpAgent::decrease_param()
 {
 	double decrease;
+	if (hstcp_table_) {
+		if (hstcp_.table == NULL)
+			hstcp_.table = hstcp_get_table();
+		if (hstcp_.table != NULL && cwnd_ >= low_window_ &&
+		    cwnd_ < high_window_)
+			return hstcp_lookup(hstcp_.table->decrease);
+	}
 	// OLD:
 	// decrease = linear(log(cwnd_), log(low_window_), 0.5, log(high_window_), high_decrease_);
 	// NEW (but equivalent):
@@ -1110,11 +1277,21 @@ double TcpAgent::increase_param()
 	// For an efficient implementation, this would just be looked up
 	//   in a table, with the increase and decrease being a function of the
 	//   congestion window.
+	// Setting hstcp_table_ does just that, see hstcp_get_table().
 
        if (cwnd_ <= low_window_) { 
 		answer = 1 / cwnd_;
        		return answer; 
-       } else if (cwnd_ >= hstcp_.cwnd_last_ && 
+       } 
+       if (hstcp_table_) {
+		if (hstcp_.table == NULL)
+			hstcp_.table = hstcp_get_table();
+		if (hstcp_.table != NULL && cwnd_ < high_window_) {
+			answer = hstcp_lookup(hstcp_.table->increase) / cwnd_;
+			return answer;
+		}
+       }
+       if (cwnd_ >= hstcp_.cwnd_last_ && 
 	      cwnd_ < hstcp_.cwnd_last_ + cwnd_range_) {
 	      // cwnd_range_ can be set to 0 to be disabled,
 	      //  or can be set from 1 to 100 
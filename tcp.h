@@ -159,6 +159,20 @@ protected:
 //int *hs_win_;		// array of cwnd values
 //int *hs_increase_;	// array of increase values
 //double *hs_decrease_;	// array of decrease values
+/*
+ * Increase and decrease parameters of HighSpeed TCP for each integer
+ * window from low_window to high_window.  The tables are built once per
+ * parameter set and shared by all the agents using that set.
+ */
+struct hstcp_table {
+	int low_window;
+	int high_window;
+	double p1, p2, dec1, dec2;	/* the parameter set */
+	double *increase;	/* increase per RTT, indexed by w - low_window */
+	double *decrease;	/* decrease factor, indexed by w - low_window */
+	hstcp_table *next;
+};
+
 struct hstcp {
 	double low_p;  // low_p
 	double dec1;	// for computing the decrease parameter
@@ -170,15 +184,50 @@ struct hstcp {
  	/*   might be just to have a look-up array.  */
 	double cwnd_last_;	/* last cwnd for computed parameters */
         double increase_last_;	/* increase param for cwnd_last_ */
+	hstcp_table *table;	/* NULL until first used with hstcp_table_ */
 	hstcp() : low_p(0.0), dec1(0.0), dec2(0.0), p1(0.0), p2(0.0),
-	    cwnd_last_(0.0), increase_last_(0.0) { }
+	    cwnd_last_(0.0), increase_last_(0.0), table(NULL) { }
+};
+
+/*
+ * Per-packet send state, indexed by seqno.  The size is a power of two,
+ *   so the entry of a seqno is at (seqno & mask_), and each field is an
+ *   array of its own, allocated only if given to the constructor.
+ * fit() doubles the size until all the seqnos from the oldest one still
+ *   needed to the one being sent have distinct entries.  Empty entries
+ *   have times of empty_ and no transmits.
+ */
+class SentTable {
+public:
+	enum { TS = 1, TRANSMITS = 2, CWND = 4 };
+	SentTable(int fields, double empty) : fields_(fields), empty_(empty),
+	    mask_(-1), ts_(NULL), transmits_(NULL), cwnd_(NULL) { }
+	~SentTable();
+	int valid() const { return (mask_ >= 0); }
+	int size() const { return (mask_ + 1); }
+	void reset(int size);		/* empty, for at least size seqnos */
+	void fit(int lo, int hi);	/* keep [lo, lo+size()), fit hi */
+	void clear(int lo, int hi);	/* empty the entries of [lo, hi] */
+	void fill_cwnd(double cwnd);
+	double& ts(int seqno) { return ts_[seqno & mask_]; }
+	int& transmits(int seqno) { return transmits_[seqno & mask_]; }
+	double& cwnd(int seqno) { return cwnd_[seqno & mask_]; }
+protected:
+	void alloc(int size);
+	void empty(int i, int n);
+	int fields_;
+	double empty_;
+	int mask_;
+	double *ts_;		/* send time */
+	int *transmits_;	/* number of transmissions */
+	double *cwnd_;		/* cwnd at send time */
 };
 
 class TcpAgent : public Agent {
 	friend class XcpEndsys;
 public:
 	TcpAgent();
-	virtual ~TcpAgent() {free(tss);}
+	virtual ~TcpAgent() {}
         virtual void recv(Packet*, Handler*);
 	virtual void timeout(int tno);
 	virtual void timeout_nonrtx(int tno);
@@ -307,8 +356,7 @@ protected:
 	double ts_peer_;        /* the most recent timestamp the peer sent */
 	double ts_echo_;        /* the most recent timestamp the peer echoed */
 	int ts_option_size_;    // header bytes in a ts option
-        double *tss;            // To store sent timestamps, with bugfix_ts_
-        int tss_size_;          // Current capacity of tss
+        SentTable tss_;         // To store sent timestamps, with bugfix_ts_
 	int ts_option_;		/* use RFC1323-like timestamps? */
 	/* End of timestamps. */
 
@@ -472,7 +520,10 @@ protected:
 	double increase_param();  /* get increase parameter for current cwnd */
 	double decrease_param();  /* get decrease parameter for current cwnd */
 	int cwnd_range_;	/* for determining when to recompute params. */
+	int hstcp_table_;	/* boolean: look the params up in a table */
 	hstcp hstcp_;		/* HighSpeed TCP variables */
+	hstcp_table *hstcp_get_table();
+	double hstcp_lookup(const double *tab);
         /* end of section for experimental high-speed TCP */
 
 	/* for Quick-Start, RFC 4782 */
@@ -640,10 +691,8 @@ protected:
 	double v_begtime_;	// tagged pkt sent
 	int    v_begseq_;	// tagged pkt seqno
 
-	double* v_sendtime_;	// each unacked pkt's sendtime is recorded.
-	int*   v_transmits_;	// # of retx for an unacked pkt
-
-	int    v_maxwnd_;	// maxwnd size for v_sendtime_[]
+	SentTable v_sent_;	// each unacked pkt's sendtime and # of
+				// transmits is recorded.
 	double v_newcwnd_;	// record un-inflated cwnd
 
 	double v_baseRTT_;	// min of all rtt
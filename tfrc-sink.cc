@@ -47,10 +47,16 @@ public:
   	TclObject* create(int, const char*const*) {
      		return (new TfrcSinkAgent());
   	}
+	virtual void bind() {
+		TclClass::bind();
+		/* the default of InverseAccuracy_, which ns-default.tcl does not set */
+		Tcl::instance().evalf("%s set InverseAccuracy_ 0", classname_);
+	}
 } class_tfrcSink; 
 
 
-TfrcSinkAgent::TfrcSinkAgent() : Agent(PT_TFRC_ACK), nack_timer_(this)
+TfrcSinkAgent::TfrcSinkAgent() : Agent(PT_TFRC_ACK), nack_timer_(this),
+	InverseAccuracy_(0)
 {
 	bind("packetSize_", &size_);	
 	bind("InitHistorySize_", &hsz);
@@ -61,6 +67,7 @@ TfrcSinkAgent::TfrcSinkAgent() : Agent(PT_TFRC_ACK), nack_timer_(this)
 	bind ("PreciseLoss_", &PreciseLoss_);
 	bind ("numPkts_", &numPkts_);
 	bind("minDiscountRatio_", &minDiscountRatio_);
+	bind("InverseAccuracy_", &InverseAccuracy_);
 
 	// for WALI ONLY
 	bind ("NumSamples_", &numsamples);
@@ -94,10 +101,6 @@ TfrcSinkAgent::TfrcSinkAgent() : Agent(PT_TFRC_ACK), nack_timer_(this)
 	lastloss_round_id = -1 ;
 	numPktsSoFar_ = 0;
 
-	rtvec_ = NULL;
-	tsvec_ = NULL;
-	lossvec_ = NULL;
-
 	// used by WALI and EWMA
 	last_sample = 0;
 
@@ -110,8 +113,11 @@ TfrcSinkAgent::TfrcSinkAgent() : Agent(PT_TFRC_ACK), nack_timer_(this)
 	count_losses = NULL ;
         num_rtts = NULL ;
 	sample_count = 1 ;
+	hist_head_ = 0;
+	mult_scale_ = 1.0;
 	mult_factor_ = 1.0;
 	init_WALI_flag = 0;
+	older_valid_ = 0;
 
 	// used only for EWMA
 	avg_loss_int = -1 ;
@@ -134,18 +140,19 @@ TfrcSinkAgent::TfrcSinkAgent() : Agent(PT_TFRC_ACK), nack_timer_(this)
  */
 int TfrcSinkAgent::new_loss(int i, double tstamp)
 {
-	double time_since_last_loss_interval = tsvec_[i%hsz]-lastloss;
+	double time_since_last_loss_interval = hist_.ts(i)-lastloss;
 	if ((time_since_last_loss_interval > rtt_)
 	     && (PreciseLoss_ == 0 || (round_id > lastloss_round_id))) {
 		lastloss = tstamp;
 		lastloss_round_id = round_id ;
                 if (time_since_last_loss_interval < ShortRtts_ * rtt_ &&
 				algo == WALI) {
-                        count_losses[0] = 1;
+                        count_losses[slot(0)] = 1;
                 }
                 if (rtt_ > 0 && algo == WALI) {
-                        num_rtts[0] = (int) ceil(time_since_last_loss_interval / rtt_);
-                        if (num_rtts[0] < 1) num_rtts[0] = 1;
+                        int s = slot(0);
+                        num_rtts[s] = (int) ceil(time_since_last_loss_interval / rtt_);
+                        if (num_rtts[s] < 1) num_rtts[s] = 1;
                 }
 		return TRUE;
 	} else return FALSE;
@@ -153,8 +160,8 @@ int TfrcSinkAgent::new_loss(int i, double tstamp)
 
 double TfrcSinkAgent::estimate_tstamp(int before, int after, int i)
 {
-	double delta = (tsvec_[after%hsz]-tsvec_[before%hsz])/(after-before) ; 
-	double tstamp = tsvec_[before%hsz]+(i-before)*delta ;
+	double delta = (hist_.ts(after)-hist_.ts(before))/(after-before) ; 
+	double tstamp = hist_.ts(before)+(i-before)*delta ;
 	return tstamp;
 }
 
@@ -185,18 +192,7 @@ void TfrcSinkAgent::recv(Packet *pkt, Handler *)
 		newdata = 1;
 		maxseq = tfrch->seqno - 1 ;
 		maxseqList = tfrch->seqno;
-		rtvec_=(double *)malloc(sizeof(double)*hsz);
-		tsvec_=(double *)malloc(sizeof(double)*hsz);
-		lossvec_=(char *)malloc(sizeof(double)*hsz);
-		if (rtvec_ && lossvec_) {
-			int i;
-			for (i = 0; i < hsz ; i ++) {
-				lossvec_[i] = UNKNOWN;
-				rtvec_[i] = -1; 
-				tsvec_[i] = -1; 
-			}
-		}
-		else {
+		if (hist_.init(hsz, now, tfrch->timestamp) < 0) {
 			printf ("error allocating memory for packet buffers\n");
 			abort (); 
 		}
@@ -208,8 +204,12 @@ void TfrcSinkAgent::recv(Packet *pkt, Handler *)
 	int oldmaxseq = maxseq;
 	// if this is the highest packet yet, or an unknown packet
 	//   between maxseqList and maxseq  
+	if (seqno > maxseq) {
+		// entering new blocks of the history
+		hist_.rebase(maxseq + 1, seqno + 1, now, tfrch->timestamp);
+	}
 	if ((seqno > maxseq) || 
-	  (seqno > maxseqList && lossvec_[seqno%hsz] == UNKNOWN )) {
+	  (seqno > maxseqList && hist_.state(seqno) == UNKNOWN )) {
 		if (seqno > maxseqList + 1)
 			++ numPktsSoFar_;
 		UrgentFlag = tfrch->UrgentFlag;
@@ -220,61 +220,55 @@ void TfrcSinkAgent::recv(Packet *pkt, Handler *)
 		sendrate = tfrch->rate;
 		last_arrival_=now;
 		last_timestamp_=tfrch->timestamp;
-		rtvec_[seqno%hsz]=now;	
-		tsvec_[seqno%hsz]=last_timestamp_;	
+		hist_.set_rt(seqno, now);	
+		hist_.set_ts(seqno, last_timestamp_);	
 		if (hf->ect() == 1 && hf->ce() == 1) {
 			// ECN action
-			lossvec_[seqno%hsz] = ECN_RCVD;
+			hist_.set_state(seqno, ECN_RCVD);
 			++ total_losses_;
 			losses_since_last_report++;
-			if (new_loss(seqno, tsvec_[seqno%hsz])) {
+			if (new_loss(seqno, hist_.ts(seqno))) {
 				ecnEvent = 1;
-				lossvec_[seqno%hsz] = ECNLOST;
+				hist_.set_state(seqno, ECNLOST);
 			} 
 			if (algo == WALI) {
-                       		++ losses[0];
+                       		++ losses[slot(0)];
 			}
-		} else lossvec_[seqno%hsz] = RCVD;
+		} else hist_.set_state(seqno, RCVD);
 	}
-	if (seqno > maxseq) {
-		int i = maxseq + 1;
-		while (i < seqno) {
-			// Added 3/1/05 in case we have wrapped around
-			//   in packet sequence space.
-			lossvec_[i%hsz] = UNKNOWN;
-			++ i;
-			++ total_losses_;
-			++ total_dropped_;
-		}
+	if (seqno > maxseq + 1) {
+		// Added 3/1/05 in case we have wrapped around
+		//   in packet sequence space.
+		hist_.fill(maxseq + 1, seqno, UNKNOWN);
+		total_losses_ += seqno - maxseq - 1;
+		total_dropped_ += seqno - maxseq - 1;
 	}
 	if (seqno > maxseqList && 
 	  (ecnEvent || numPktsSoFar_ >= numPkts_ ||
-	     tsvec_[seqno%hsz] - tsvec_[maxseqList%hsz] > rtt_)) {
+	     hist_.ts(seqno) - hist_.ts(maxseqList) > rtt_)) {
 		// numPktsSoFar_ >= numPkts_:
 		// Number of pkts since we last entered this procedure
 		//   at least equal numPkts_, the number of non-sequential 
 		//   packets that must be seen before inferring loss.
 		// maxseqList: max seq number checked for dropped packets
 		// Decide which losses begin new loss events.
-		int i = maxseqList ;
+		int i = hist_.find_next(maxseqList, seqno, UNKNOWN, UNKNOWN);
 		while(i < seqno) {
-			if (lossvec_[i%hsz] == UNKNOWN) {
-				rtvec_[i%hsz]=now;	
-				tsvec_[i%hsz]=estimate_tstamp(oldmaxseq, seqno, i);	
-				if (new_loss(i, tsvec_[i%hsz])) {
-					congestionEvent = 1;
-					lossvec_[i%hsz] = LOST;
-				} else {
-					// This lost packet is marked "NOT_RCVD"
-					// as it does not begin a loss event.
-					lossvec_[i%hsz] = NOT_RCVD; 
-				}
-				if (algo == WALI) {
-			    		++ losses[0];
-				}
-				losses_since_last_report++;
+			hist_.set_rt(i, now);	
+			hist_.set_ts(i, estimate_tstamp(oldmaxseq, seqno, i));	
+			if (new_loss(i, hist_.ts(i))) {
+				congestionEvent = 1;
+				hist_.set_state(i, LOST);
+			} else {
+				// This lost packet is marked "NOT_RCVD"
+				// as it does not begin a loss event.
+				hist_.set_state(i, NOT_RCVD); 
 			}
-			i++;
+			if (algo == WALI) {
+		    		++ losses[slot(0)];
+			}
+			losses_since_last_report++;
+			i = hist_.find_next(i + 1, seqno, UNKNOWN, UNKNOWN);
 		}
 		maxseqList = seqno;
 		numPktsSoFar_ = 0;
@@ -349,17 +343,15 @@ double TfrcSinkAgent::est_thput ()
 	else {
 		// count number of packets received in the last RTT
 		if (rtt_ > 0){
-			double last = rtvec_[maxseq%hsz]; 
+			double last = hist_.rt(maxseq); 
 			int rcvd = 0;
-			int i = maxseq;
+			int i = hist_.find_prev(1, maxseq + 1, RCVD, RCVD);
 			while (i > 0) {
-				if (lossvec_[i%hsz] == RCVD) {
-					if ((rtvec_[i%hsz] + rtt_) > last) 
-						rcvd++; 
-					else
-						break ;
-				}
-				i--; 
+				if ((hist_.rt(i) + rtt_) > last) 
+					rcvd++; 
+				else
+					break ;
+				i = hist_.find_prev(1, i, RCVD, RCVD);
 			}
 			if (rcvd > 0)
 				thput = rcvd/rtt_; 
@@ -480,6 +472,9 @@ int TfrcSinkAgent::command(int argc, const char*const* argv)
 				num_rtts[count] = 0;
 				weights[count] = 0;
 				mult[count] = 1;
+				hist_head_ = 0;
+				mult_scale_ = 1.0;
+				older_valid_ = 0;
 				free(w);
 				return (TCL_OK);
 			}
@@ -496,6 +491,188 @@ void TfrcNackTimer::expire(Event *) {
 	a_->nextpkt(-1);
 }
 
+////
+/// Receive history
+////
+#define NIB_ONES 0x1111111111111111ULL
+
+// Mask of the nibbles of slots [lo, hi) within a word, 0 <= lo < hi <= 16.
+static inline uint64_t nib_mask(int lo, int hi)
+{
+	uint64_t m = (hi == HIST_BLOCK) ? ~0ULL : ((1ULL << (4*hi)) - 1);
+	return m & ~((1ULL << (4*lo)) - 1);
+}
+
+TfrcRecvHistory::~TfrcRecvHistory()
+{
+	free(state_);
+	free(rt_);
+	free(ts_);
+	free(rt_base_);
+	free(ts_base_);
+}
+
+int TfrcRecvHistory::init(int size, double rt, double ts)
+{
+	int i;
+	size_ = size;
+	nblocks_ = (size + HIST_BLOCK - 1)/HIST_BLOCK;
+	state_ = (uint64_t *)calloc(nblocks_, sizeof(uint64_t));
+	rt_ = (float *)malloc(sizeof(float)*size);
+	ts_ = (float *)malloc(sizeof(float)*size);
+	rt_base_ = (double *)malloc(sizeof(double)*nblocks_);
+	ts_base_ = (double *)malloc(sizeof(double)*nblocks_);
+	if (!state_ || !rt_ || !ts_ || !rt_base_ || !ts_base_)
+		return (-1);
+	for (i = 0; i < nblocks_; i++) {
+		rt_base_[i] = rt;
+		ts_base_[i] = ts;
+	}
+	// all packets are UNKNOWN (0), with times of -1
+	for (i = 0; i < size; i++) {
+		rt_[i] = (float)(-1 - rt);
+		ts_[i] = (float)(-1 - ts);
+	}
+	return (0);
+}
+
+// Bit 0 of each nibble of word w with status st1 or st2.
+inline uint64_t TfrcRecvHistory::match(int w, int st1, int st2) const
+{
+	uint64_t x = state_[w] ^ (NIB_ONES * st1);
+	uint64_t y = state_[w] ^ (NIB_ONES * st2);
+	x |= x >> 1;
+	x |= x >> 2;
+	y |= y >> 1;
+	y |= y >> 2;
+	return (~x | ~y) & NIB_ONES;
+}
+
+/*
+ * The functions below walk [from, to) in runs of contiguous slots,
+ *   [i, i+len), and each run a word at a time.
+ */
+void TfrcRecvHistory::fill(int from, int to, int st)
+{
+	if (to - from > size_)
+		from = to - size_;
+	while (from < to) {
+		int i = from % size_;
+		int len = (to - from < size_ - i) ? to - from : size_ - i;
+		for (int w = i/HIST_BLOCK; w*HIST_BLOCK < i + len; w++) {
+			int lo = (w == i/HIST_BLOCK) ? i%HIST_BLOCK : 0;
+			int hi = (i + len - w*HIST_BLOCK < HIST_BLOCK) ?
+			    i + len - w*HIST_BLOCK : HIST_BLOCK;
+			uint64_t m = nib_mask(lo, hi);
+			state_[w] = (state_[w] & ~m) | (NIB_ONES * st & m);
+		}
+		from += len;
+	}
+}
+
+void TfrcRecvHistory::replace(int from, int to, int st1, int st2, int st)
+{
+	if (to - from > size_)
+		from = to - size_;
+	while (from < to) {
+		int i = from % size_;
+		int len = (to - from < size_ - i) ? to - from : size_ - i;
+		for (int w = i/HIST_BLOCK; w*HIST_BLOCK < i + len; w++) {
+			int lo = (w == i/HIST_BLOCK) ? i%HIST_BLOCK : 0;
+			int hi = (i + len - w*HIST_BLOCK < HIST_BLOCK) ?
+			    i + len - w*HIST_BLOCK : HIST_BLOCK;
+			uint64_t m = (match(w, st1, st2) & nib_mask(lo, hi)) * 0xf;
+			state_[w] = (state_[w] & ~m) | (NIB_ONES * st & m);
+		}
+		from += len;
+	}
+}
+
+int TfrcRecvHistory::find_next(int from, int to, int st1, int st2) const
+{
+	while (from < to) {
+		int i = from % size_;
+		int len = (to - from < size_ - i) ? to - from : size_ - i;
+		for (int w = i/HIST_BLOCK; w*HIST_BLOCK < i + len; w++) {
+			int lo = (w == i/HIST_BLOCK) ? i%HIST_BLOCK : 0;
+			int hi = (i + len - w*HIST_BLOCK < HIST_BLOCK) ?
+			    i + len - w*HIST_BLOCK : HIST_BLOCK;
+			uint64_t m = match(w, st1, st2) & nib_mask(lo, hi);
+			if (m)
+				return from + w*HIST_BLOCK +
+				    __builtin_ctzll(m)/4 - i;
+		}
+		from += len;
+	}
+	return to;
+}
+
+int TfrcRecvHistory::find_prev(int from, int to, int st1, int st2) const
+{
+	while (from < to) {
+		int j = (to - 1) % size_;	// run [j+1-len, j]
+		int len = (to - from < j + 1) ? to - from : j + 1;
+		int i = j + 1 - len;
+		for (int w = j/HIST_BLOCK; w >= i/HIST_BLOCK; w--) {
+			int lo = (w == i/HIST_BLOCK) ? i%HIST_BLOCK : 0;
+			int hi = (w == j/HIST_BLOCK) ? j%HIST_BLOCK + 1 : HIST_BLOCK;
+			uint64_t m = match(w, st1, st2) & nib_mask(lo, hi);
+			if (m)
+				return to - 1 - j + w*HIST_BLOCK +
+				    (63 - __builtin_clzll(m))/4;
+		}
+		to -= len;
+	}
+	return from - 1;
+}
+
+int TfrcRecvHistory::count(int from, int to, int st1, int st2) const
+{
+	int n = 0;
+	while (from < to) {
+		int i = from % size_;
+		int len = (to - from < size_ - i) ? to - from : size_ - i;
+		for (int w = i/HIST_BLOCK; w*HIST_BLOCK < i + len; w++) {
+			int lo = (w == i/HIST_BLOCK) ? i%HIST_BLOCK : 0;
+			int hi = (i + len - w*HIST_BLOCK < HIST_BLOCK) ?
+			    i + len - w*HIST_BLOCK : HIST_BLOCK;
+			n += __builtin_popcountll(match(w, st1, st2) &
+			    nib_mask(lo, hi));
+		}
+		from += len;
+	}
+	return n;
+}
+
+/*
+ * Move the base of the blocks starting in [from, to) to (rt, ts).  The
+ *   times still stored in such a block (from the previous pass over the
+ *   history) are kept, relative to the new base.
+ */
+void TfrcRecvHistory::rebase(int from, int to, double rt, double ts)
+{
+	if (to - from > size_)
+		from = to - size_;
+	while (from < to) {
+		int i = from % size_;
+		int len = (to - from < size_ - i) ? to - from : size_ - i;
+		for (int b = (i + HIST_BLOCK - 1)/HIST_BLOCK;
+		     b*HIST_BLOCK < i + len; b++) {
+			float drt = (float)(rt_base_[b] - rt);
+			float dts = (float)(ts_base_[b] - ts);
+			for (int k = b*HIST_BLOCK;
+			     k < size_ && k < (b+1)*HIST_BLOCK; k++) {
+				rt_[k] += drt;
+				ts_[k] += dts;
+			}
+			rt_base_[b] = rt;
+			ts_base_[b] = ts;
+		}
+		from += len;
+	}
+}
+
+
 void TfrcSinkAgent::print_loss(int sample, double ave_interval)
 {
 	double now = Scheduler::instance().clock();
@@ -509,32 +686,39 @@ void TfrcSinkAgent::print_loss(int sample, double ave_interval)
 	//printf ("time: %7.5f maxseq: %d\n", now, maxseq);
 }
 
-void TfrcSinkAgent::print_loss_all(int *sample) 
+void TfrcSinkAgent::print_loss_all() 
 {
 	double now = Scheduler::instance().clock();
+	if (sample == NULL)
+		return;
 	printf ("%f: sample 0: %5d 1: %5d 2: %5d 3: %5d 4: %5d\n", 
-		now, sample[0], sample[1], sample[2], sample[3], sample[4]); 
+		now, sample[slot(0)], sample[slot(1)], sample[slot(2)], 
+		sample[slot(3)], sample[slot(4)]); 
 }
 
-void TfrcSinkAgent::print_losses_all(int *losses) 
+void TfrcSinkAgent::print_losses_all() 
 {
 	double now = Scheduler::instance().clock();
 	printf ("%f: losses 0: %5d 1: %5d 2: %5d 3: %5d 4: %5d\n", 
-		now, losses[0], losses[1], losses[2], losses[3], losses[4]); 
+		now, losses[slot(0)], losses[slot(1)], losses[slot(2)], 
+		losses[slot(3)], losses[slot(4)]); 
 }
 
-void TfrcSinkAgent::print_count_losses_all(int *count_losses) 
+void TfrcSinkAgent::print_count_losses_all() 
 {
 	double now = Scheduler::instance().clock();
 	printf ("%f: count? 0: %5d 1: %5d 2: %5d 3: %5d 4: %5d\n", 
-		now, count_losses[0], count_losses[1], count_losses[2], count_losses[3], count_losses[4]); 
+		now, count_losses[slot(0)], count_losses[slot(1)], 
+		count_losses[slot(2)], count_losses[slot(3)], 
+		count_losses[slot(4)]); 
 }
 
-void TfrcSinkAgent::print_num_rtts_all(int *count_losses) 
+void TfrcSinkAgent::print_num_rtts_all() 
 {
 	double now = Scheduler::instance().clock();
 	printf ("%f: rtts 0: %5d 1: %5d 2: %5d 3: %5d 4: %5d\n", 
- 	   now, num_rtts[0], num_rtts[1], num_rtts[2], num_rtts[3], num_rtts[4]); 
+ 	   now, num_rtts[slot(0)], num_rtts[slot(1)], num_rtts[slot(2)], 
+	   num_rtts[slot(3)], num_rtts[slot(4)]); 
 }
 
 ////////////////////////////////////////
@@ -545,49 +729,47 @@ void TfrcSinkAgent::print_num_rtts_all(int *count_losses)
 ////
 /// WALI Code
 ////
-double TfrcSinkAgent::est_loss_WALI () 
+double TfrcSinkAgent::est_loss_WALI ()
 {
 	int i;
-	double ave_interval1, ave_interval2; 
-	int ds ; 
-		
+	double ave_interval1, ave_interval2;
+	int ds ;
+
 	if (!init_WALI_flag) {
 		init_WALI () ;
 	}
-	// sample[i] counts the number of packets in the i-th loss interval
-	// sample[0] contains the most recent sample.
-        // losses[i] contains the number of losses in the i-th loss interval
-        // count_losses[i] is 1 if the i-th loss interval is short.
-        // num_rtts[i] contains the number of rtts in the i-th loss interval
+	// sample[slot(i)] counts the number of packets in the i-th loss interval
+	// sample[slot(0)] contains the most recent sample.
+        // losses[slot(i)] contains the number of losses in the i-th loss interval
+        // count_losses[slot(i)] is 1 if the i-th loss interval is short.
+        // num_rtts[slot(i)] contains the number of rtts in the i-th loss interval
 	for (i = last_sample; i <= maxseq ; i ++) {
-		sample[0]++;
-		if (lossvec_[i%hsz] == LOST || lossvec_[i%hsz] == ECNLOST) {
-		        //  new loss event
-			sample_count ++;
-			shift_array (sample, numsamples+1, 0); 
-			shift_array (losses, numsamples+1, 1); 
-			shift_array (count_losses, numsamples+1, 1); 
-			shift_array (num_rtts, numsamples+1, 0); 
-			multiply_array(mult, numsamples+1, mult_factor_);
-			shift_array (mult, numsamples+1, 1.0); 
-			mult_factor_ = 1.0;
-		}
+		int j = hist_.find_next(i, maxseq + 1, LOST, ECNLOST);
+		sample[slot(0)] += j - i;
+		if (j > maxseq)
+			break;
+		//  new loss event
+		sample[slot(0)]++;
+		sample_count ++;
+		new_loss_interval();
+		i = j;
 	}
-	last_sample = maxseq+1 ; 
+	last_sample = maxseq+1 ;
 	double now = Scheduler::instance().clock();
         //if (ShortIntervals_ > 0 && printLoss_ > 0) {
         //    printf ("now: %5.2f lastloss: %5.2f ShortRtts_: %d rtt_: %5.2f\n",
         //         now, lastloss, ShortRtts_, rtt_);
         //}
-        if (ShortIntervals_ > 0 && 
+	int s0 = slot(0);
+        if (ShortIntervals_ > 0 &&
             now - lastloss > ShortRtts_ * rtt_) {
               // Check if the current loss interval is short.
-              count_losses[0] = 0;
+              count_losses[s0] = 0;
         }
         if (ShortIntervals_ > 0 && rtt_ > 0) {
               // Count number of rtts in current loss interval.
-              num_rtts[0] = (int) ceil((now - lastloss) / rtt_);
-              if (num_rtts[0] < 1) num_rtts[0] = 1;
+              num_rtts[s0] = (int) ceil((now - lastloss) / rtt_);
+              if (num_rtts[s0] < 1) num_rtts[s0] = 1;
         }
 	if (sample_count>numsamples+1)
 		// The array of loss intervals is full.
@@ -595,96 +777,117 @@ double TfrcSinkAgent::est_loss_WALI ()
     	else
 		ds=sample_count;
 
-	if (sample_count == 1 && false_sample == 0) 
+	if (sample_count == 1 && false_sample == 0)
 		// no losses yet
-		return 0; 
+		return 0;
+	update_older_sums(ds);
+	// Calculations not including the most recent loss interval.
+	//   As all these intervals are weighted by mult_factor_, it
+	//   cancels out.
+	if (older_wsum_ > 0)
+		ave_interval2 = older_sum_/older_wsum_;
+	else
+		ave_interval2 = 0;
 	/* do we need to discount weights? */
-	if (sample_count > 1 && discount && sample[0] > 0) {
-                double ave = weighted_average1(1, ds, 1.0, mult, weights, sample, ShortIntervals_, losses, count_losses, num_rtts);
+	if (sample_count > 1 && discount && sample[s0] > 0) {
+                double ave = ave_interval2;
 		int factor = 2;
-		double ratio = (factor*ave)/sample[0];
+		double ratio = (factor*ave)/sample[s0];
 		if ( ratio < 1.0) {
 			// the most recent loss interval is very large
 			mult_factor_ = ratio;
 			double min_ratio = minDiscountRatio_;
-			if (mult_factor_ < min_ratio) 
+			if (mult_factor_ < min_ratio)
 				mult_factor_ = min_ratio;
 		}
 	}
 	// Calculations including the most recent loss interval.
-        ave_interval1 = weighted_average1(0, ds, mult_factor_, mult, weights, sample, ShortIntervals_, losses, count_losses, num_rtts);
-        // Calculations not including the most recent loss interval.
-        ave_interval2 = weighted_average1(1, ds, mult_factor_, mult, weights, sample, ShortIntervals_, losses, count_losses, num_rtts);
+	//   With smooth_, the weight array is effectively shifted.
+	double wsum, answer;
+	if (smooth_ == 1) {
+		double m0 = mult_at(0)*weights[1];
+		wsum = m0 + mult_factor_*older_wsum1_;
+		answer = m0*interval_sample(0, 1) + mult_factor_*older_sum1_;
+	} else {
+		double m0 = mult_at(0)*weights[0];
+		wsum = m0 + mult_factor_*older_wsum_;
+		answer = m0*interval_sample(0, 0) + mult_factor_*older_sum_;
+	}
+	if (wsum > 0)
+		ave_interval1 = answer/wsum;
+	else
+		ave_interval1 = 0;
 	// The most recent loss interval does not end in a loss
-	// event.  Include the most recent interval in the 
+	// event.  Include the most recent interval in the
 	// calculations only if this increases the estimated loss
-	// interval. 
+	// interval.
         // If ShortIntervals is less than 10, do not count the most
         //   recent interval if it is a short interval.
         //   Values of ShortIntervals greater than 10 are only for
         //   validation purposes, and for backwards compatibility.
         //
 	if (ave_interval2 > ave_interval1 ||
-             (ShortIntervals_ > 1 && ShortIntervals_ < 10 
-                     && count_losses[0] == 1))
+             (ShortIntervals_ > 1 && ShortIntervals_ < 10
+                     && count_losses[s0] == 1))
                 // The second condition is to check if the first interval
                 //  is a short interval.  If so, we must use ave_interval2.
 		ave_interval1 = ave_interval2;
-	if (ave_interval1 > 0) { 
+	if (ave_interval1 > 0) {
 		if (printLoss_ > 0) {
-			print_loss(sample[0], ave_interval1);
-			print_loss_all(sample);
+			print_loss(sample[s0], ave_interval1);
+			print_loss_all();
 			if (ShortIntervals_ > 0) {
-				print_losses_all(losses);
-				print_count_losses_all(count_losses);
-                                print_num_rtts_all(num_rtts);
+				print_losses_all();
+				print_count_losses_all();
+                                print_num_rtts_all();
 			}
 		}
-		return 1/ave_interval1; 
-	} else return 999;     
+		return 1/ave_interval1;
+	} else return 999;
 }
 
-// Calculate the weighted average.
-double TfrcSinkAgent::weighted_average(int start, int end, double factor, double *m, double *w, int *sample)
+/*
+ * A new loss event: the most recent loss interval is closed, and a new
+ *   one starts in the slot of the oldest.  The pending discount
+ *   (mult_factor_) is applied to all the closed intervals.
+ */
+void TfrcSinkAgent::new_loss_interval()
 {
-	int i; 
-	double wsum = 0;
-	double answer = 0;
-	if (smooth_ == 1 && start == 0) {
-		if (end == numsamples+1) {
-			// the array is full, but we don't want to uses
-			//  the last loss interval in the array
-			end = end-1;
-		} 
-		// effectively shift the weight arrays 
-		for (i = start ; i < end; i++) 
-			if (i==0)
-				wsum += m[i]*w[i+1];
-			else 
-				wsum += factor*m[i]*w[i+1];
-		for (i = start ; i < end; i++)  
-			if (i==0)
-			 	answer += m[i]*w[i+1]*sample[i]/wsum;
-			else 
-				answer += factor*m[i]*w[i+1]*sample[i]/wsum;
-	        return answer;
+	discount_history(mult_factor_);
+	mult_factor_ = 1.0;
+	hist_head_ = (hist_head_ == 0 ? numsamples : hist_head_ - 1);
+	int s = hist_head_;
+	sample[s] = 0;
+	losses[s] = 1;
+	count_losses[s] = 1;
+	num_rtts[s] = 0;
+	mult[s] = 1.0/mult_scale_;
+	older_valid_ = 0;
+}
 
-	} else {
-		for (i = start ; i < end; i++) 
-			if (i==0)
-				wsum += m[i]*w[i];
-			else 
-				wsum += factor*m[i]*w[i];
-		for (i = start ; i < end; i++)  
-			if (i==0)
-			 	answer += m[i]*w[i]*sample[i]/wsum;
-			else 
-				answer += factor*m[i]*w[i]*sample[i]/wsum;
-	        return answer;
+/*
+ * Multiply mult[] by multiplier, except for the most recent interval.
+ *   This is done in O(1) through mult_scale_, unless mult_scale_
+ *   would become too small.
+ */
+void TfrcSinkAgent::discount_history(double multiplier)
+{
+	int i;
+	if (multiplier == 1.0)
+		return;
+	if (multiplier > 0 && mult_scale_*multiplier > 1e-100) {
+		mult_scale_ *= multiplier;
+		mult[slot(0)] /= multiplier;
+		return;
 	}
+	for (i = 0; i < numsamples+1; i++)
+		mult[i] *= mult_scale_;
+	mult_scale_ = 1.0;
+	for (i = 1; i < numsamples+1; i++)
+		mult[slot(i)] *= multiplier;
 }
 
-int TfrcSinkAgent::get_sample(int oldSample, int numLosses) 
+int TfrcSinkAgent::get_sample(int oldSample, int numLosses)
 {
 	int newSample;
 	if (numLosses == 0) {
@@ -695,7 +898,7 @@ int TfrcSinkAgent::get_sample(int oldSample, int numLosses)
 	return newSample;
 }
 
-int TfrcSinkAgent::get_sample_rtts(int oldSample, int numLosses, int rtts) 
+int TfrcSinkAgent::get_sample_rtts(int oldSample, int numLosses, int rtts)
 {
 	int newSample;
 	if (numLosses == 0) {
@@ -716,10 +919,9 @@ int TfrcSinkAgent::get_sample_rtts(int oldSample, int numLosses, int rtts)
 	return newSample;
 }
 
-// Calculate the weighted average, factor*m[i]*w[i]*sample[i]/wsum.
-// "factor" is "mult_factor_", for weighting the most recent interval
-//    when it is very large
-// "m[i]" is "mult[]", for old values of "mult_factor_".
+// The length of loss interval i, as used in the weighted average.
+// "smooth" is set for the smooth_ average including the most recent
+//   interval.
 //
 // When ShortIntervals_%10 is 1, the length of a loss interval is
 //   "sample[i]/losses[i]" for short intervals, not just "sample[i]".
@@ -733,103 +935,65 @@ int TfrcSinkAgent::get_sample_rtts(int oldSample, int numLosses, int rtts)
 // When ShortIntervals_%10 is 3, short intervals are up to three RTTs,
 //   and the number of losses counted is a function of the interval size.
 //
-double TfrcSinkAgent::weighted_average1(int start, int end, double factor, double *m, double *w, int *sample, int ShortIntervals, int *losses, int *count_losses, int *num_rtts)
+int TfrcSinkAgent::interval_sample(int i, int smooth)
 {
-        int i;
-        int ThisSample;
-        double wsum = 0;
-        double answer = 0;
-        if (smooth_ == 1 && start == 0) {
-                if (end == numsamples+1) {
-                        // the array is full, but we don't want to use
-                        //  the last loss interval in the array
-                        end = end-1;
-                }
-                // effectively shift the weight arrays
-                for (i = start ; i < end; i++)
-                        if (i==0)
-                                wsum += m[i]*w[i+1];
-                        else
-                                wsum += factor*m[i]*w[i+1];
-                for (i = start ; i < end; i++) {
-                        ThisSample = sample[i];
-                        if (ShortIntervals%10 == 1 && count_losses[i] == 1) {
-			       ThisSample = get_sample(sample[i], losses[i]);
-                        }
-                        if (ShortIntervals%10 == 2 && count_losses[i] == 1) {
-			       int adjusted_losses = int(fsize_/size_);
-			       if (losses[i] < adjusted_losses) {
-					adjusted_losses = losses[i];
-			       }
-			       ThisSample = get_sample(sample[i], adjusted_losses);
-                        }
-                        if (ShortIntervals%10 == 3 && count_losses[i] == 1) {
-			       ThisSample = get_sample_rtts(sample[i], losses[i], num_rtts[i]);
-                        }
-                        if (i==0)
-                                answer += m[i]*w[i+1]*ThisSample/wsum;
-                                //answer += m[i]*w[i+1]*sample[i]/wsum;
-                        else
-                                answer += factor*m[i]*w[i+1]*ThisSample/wsum;
-                                //answer += factor*m[i]*w[i+1]*sample[i]/wsum;
-		}
-                return answer;
-
-        } else {
-                for (i = start ; i < end; i++)
-                        if (i==0)
-                                wsum += m[i]*w[i];
-                        else
-                                wsum += factor*m[i]*w[i];
-                for (i = start ; i < end; i++) {
-                       ThisSample = sample[i];
-                       if (ShortIntervals%10 == 1 && count_losses[i] == 1) {
-			       ThisSample = get_sample(sample[i], losses[i]);
-                       }
-                       if (ShortIntervals%10 == 2 && count_losses[i] == 1) {
-			       ThisSample = get_sample(sample[i], 7);
-			       // Replace 7 by 1460/packet size.
-                               // NOT FINISHED.
-                       }
-                        if (ShortIntervals%10 == 3 && count_losses[i] == 1) {
-			       ThisSample = get_sample_rtts(sample[i], losses[i], (int) num_rtts[i]);
-                        }
-                       if (i==0)
-                                answer += m[i]*w[i]*ThisSample/wsum;
-                                //answer += m[i]*w[i]*sample[i]/wsum;
-                        else
-                                answer += factor*m[i]*w[i]*ThisSample/wsum;
-                                //answer += factor*m[i]*w[i]*sample[i]/wsum;
+	int s = slot(i);
+	int ThisSample = sample[s];
+	if (count_losses[s] != 1)
+		return ThisSample;
+	if (ShortIntervals_%10 == 1) {
+		ThisSample = get_sample(sample[s], losses[s]);
+	}
+	if (ShortIntervals_%10 == 2) {
+		if (smooth) {
+			int adjusted_losses = int(fsize_/size_);
+			if (losses[s] < adjusted_losses) {
+				adjusted_losses = losses[s];
+			}
+			ThisSample = get_sample(sample[s], adjusted_losses);
+		} else {
+			ThisSample = get_sample(sample[s], 7);
+			// Replace 7 by 1460/packet size.
+			// NOT FINISHED.
 		}
-                return answer;
-        }
-}
-
-// Shift array a[] up, starting with a[sz-2] -> a[sz-1].
-void TfrcSinkAgent::shift_array(int *a, int sz, int defval) 
-{
-	int i ;
-	for (i = sz-2 ; i >= 0 ; i--) {
-		a[i+1] = a[i] ;
 	}
-	a[0] = defval;
-}
-void TfrcSinkAgent::shift_array(double *a, int sz, double defval) {
-	int i ;
-	for (i = sz-2 ; i >= 0 ; i--) {
-		a[i+1] = a[i] ;
+	if (ShortIntervals_%10 == 3) {
+		ThisSample = get_sample_rtts(sample[s], losses[s], num_rtts[s]);
 	}
-	a[0] = defval;
+	return ThisSample;
 }
 
-// Multiply array by value, starting with array index 1.
-// Array index 0 of the unshifted array contains the most recent interval.
-void TfrcSinkAgent::multiply_array(double *a, int sz, double multiplier) {
-	int i ;
-	for (i = 1; i <= sz-1; i++) {
-		double old = a[i];
-		a[i] = old * multiplier ;
+// Calculate the weighted sums of the closed loss intervals 1..ds-1,
+//   mult[i]*w[i]*sample[i] and mult[i]*w[i].  For smooth_, the
+//   sums with w[i+1] skip the last interval of a full array.
+// These only change with a new loss interval, so they are computed
+//   once per loss event rather than for each loss rate estimate.
+void TfrcSinkAgent::update_older_sums(int ds)
+{
+	int i;
+	if (older_valid_ && older_ds_ == ds && older_fsize_ == fsize_ &&
+	    older_size_ == size_ && older_short_ == ShortIntervals_ &&
+	    older_rtts_ == ShortRtts_ && older_smooth_ == smooth_)
+		return;
+	int end1 = (ds == numsamples+1) ? ds-1 : ds;
+	older_wsum_ = older_sum_ = 0;
+	older_wsum1_ = older_sum1_ = 0;
+	for (i = 1; i < ds; i++) {
+		double m = mult_at(i);
+		older_wsum_ += m*weights[i];
+		older_sum_ += m*weights[i]*interval_sample(i, 0);
+		if (smooth_ == 1 && i < end1) {
+			older_wsum1_ += m*weights[i+1];
+			older_sum1_ += m*weights[i+1]*interval_sample(i, 1);
+		}
 	}
+	older_valid_ = 1;
+	older_ds_ = ds;
+	older_fsize_ = fsize_;
+	older_size_ = size_;
+	older_short_ = ShortIntervals_;
+	older_rtts_ = ShortRtts_;
+	older_smooth_ = smooth_;
 }
 
 /*
@@ -837,32 +1001,28 @@ void TfrcSinkAgent::multiply_array(double *a, int sz, double multiplier) {
  */
 double TfrcSinkAgent::adjust_history (double ts)
 {
-	int i;
 	double p;
-	for (i = maxseq; i >= 0 ; i --) {
-		if (lossvec_[i%hsz] == LOST || lossvec_[i%hsz] == ECNLOST ) {
-			lossvec_[i%hsz] = NOT_RCVD; 
-		}
-	}
+	hist_.replace(0, maxseq + 1, LOST, ECNLOST, NOT_RCVD);
 	lastloss = ts; 
 	lastloss_round_id = round_id ;
-	p=b_to_p(est_thput()*psize_, rtt_, tzero_, fsize_, 1);
+	p=b_to_p(est_thput()*psize_, rtt_, tzero_, fsize_, 1, InverseAccuracy_);
 	false_sample = (int)(1.0/p);
-	sample[1] = false_sample;
-	sample[0] = 0;
-	losses[1] = 0;
-	losses[0] = 1;
-	count_losses[1] = 0;
-	count_losses[0] = 0;
-        num_rtts[0]=0;
-        num_rtts[1]=0;
+	sample[slot(1)] = false_sample;
+	sample[slot(0)] = 0;
+	losses[slot(1)] = 0;
+	losses[slot(0)] = 1;
+	count_losses[slot(1)] = 0;
+	count_losses[slot(0)] = 0;
+        num_rtts[slot(0)]=0;
+        num_rtts[slot(1)]=0;
 	sample_count++; 
+	older_valid_ = 0;
 	if (printLoss_) {
-		print_loss_all (sample);
+		print_loss_all ();
 		if (ShortIntervals_ > 0) {
-			print_losses_all(losses);
-			print_count_losses_all(count_losses);
-			print_num_rtts_all(num_rtts);
+			print_losses_all();
+			print_count_losses_all();
+			print_num_rtts_all();
 		}
 	}
 	false_sample = -1 ; 
@@ -909,6 +1069,9 @@ void TfrcSinkAgent::init_WALI () {
 	for (i = 0; i < numsamples+1; i ++) {
 		mult[i] = 1.0 ; 
 	}
+	hist_head_ = 0;
+	mult_scale_ = 1.0;
+	older_valid_ = 0;
 	init_WALI_flag = 1;  /* initialization done */
 }
 
@@ -919,15 +1082,19 @@ void TfrcSinkAgent::init_WALI () {
 double TfrcSinkAgent::est_loss_EWMA () {
 	double p1, p2 ;
 	for (int i = last_sample; i <= maxseq ; i ++) {
+		int j = hist_.find_next(i, maxseq + 1, LOST, ECNLOST);
+		loss_int += j - i;
+		if (j > maxseq)
+			break;
+		// new loss event at packet j
 		loss_int++; 
-		if (lossvec_[i%hsz] == LOST || lossvec_[i%hsz] == ECNLOST ) {
-			if (avg_loss_int < 0) {
-				avg_loss_int = loss_int ; 
-			} else {
-				avg_loss_int = history*avg_loss_int + (1-history)*loss_int ;
-			}
-			loss_int = 0 ;
+		if (avg_loss_int < 0) {
+			avg_loss_int = loss_int ; 
+		} else {
+			avg_loss_int = history*avg_loss_int + (1-history)*loss_int ;
 		}
+		loss_int = 0 ;
+		i = j;
 	}
 	last_sample = maxseq+1 ; 
 
@@ -958,7 +1125,7 @@ double TfrcSinkAgent::est_loss_EWMA () {
 			print_loss(loss_int, 1.0/p1);
 		else
 			print_loss(loss_int, 0.00001);
-		print_loss_all(sample);
+		print_loss_all();
 	}
 	return p1 ;
 }
@@ -973,7 +1140,7 @@ double TfrcSinkAgent::est_loss_RBPH () {
 
 	// how many pkts we should go back?
 	if (sendrate > 0 && rtt_ > 0) {
-		double x = b_to_p(sendrate, rtt_, tzero_, psize_, 1);
+		double x = b_to_p(sendrate, rtt_, tzero_, psize_, 1, InverseAccuracy_);
 		if (x > 0) 
 			numpkts = minlc/x ; 
 		else
@@ -991,11 +1158,10 @@ double TfrcSinkAgent::est_loss_RBPH () {
 	int i = maxseq ;
 
 	// first see if how many lc's we find in numpkts 
-	while (pc < numpkts) {
-		pc ++ ;
-		if (lossvec_[i%hsz] == LOST || lossvec_[i%hsz] == ECNLOST )
-			lc ++ ; 
-		i -- ;
+	if (numpkts > 0) {
+		pc = (int)ceil(numpkts);
+		lc = hist_.count(i - pc + 1, i + 1, LOST, ECNLOST);
+		i -= pc;
 	}
 
 	// if not enough lsos events, keep going back ...
@@ -1006,13 +1172,7 @@ double TfrcSinkAgent::est_loss_RBPH () {
 		if (numpkts > hsz)
 			numpkts = hsz ;
 
-		while ((lc < minlc) && (pc < numpkts)) {
-			pc ++ ;
-			if (lossvec_[i%hsz] == LOST || lossvec_[i%hsz] == ECNLOST )
-				lc ++ ;
-			i -- ;
-		
-		}
+		back_to_losses(i, pc, lc, (int)numpkts);
 	}
 
 	if (pc == 0) 
@@ -1024,11 +1184,31 @@ double TfrcSinkAgent::est_loss_RBPH () {
 			print_loss(0, 1.0/p);
 		else
 			print_loss(0, 0.00001);
-		print_loss_all(sample);
+		print_loss_all();
 	}
 	return p ;
 }
 
+/*
+ * Go back from packet i, counting packets in pc and loss events in lc,
+ *   until minlc loss events or maxpc packets are counted.
+ */
+void TfrcSinkAgent::back_to_losses(int &i, int &pc, int &lc, int maxpc)
+{
+	int lo = i - (maxpc - pc) + 1;	// last packet we may count
+	while ((lc < minlc) && (pc < maxpc)) {
+		int j = hist_.find_prev(lo, i + 1, LOST, ECNLOST);
+		if (j < lo) {
+			pc += i - lo + 1;
+			i = lo - 1;
+			break;
+		}
+		pc += i - j + 1;
+		lc ++;
+		i = j - 1;
+	}
+}
+
 ///////////////////////////
 // EBPH //////////////////
 //////////////////////////
@@ -1045,12 +1225,7 @@ double TfrcSinkAgent::est_loss_EBPH () {
 	if (numpkts > hsz)
 		numpkts = hsz ;
 
-	while ((lc < minlc) && (pc < numpkts)) {
-		pc ++ ;
-		if (lossvec_[i%hsz] == LOST || lossvec_[i%hsz] == ECNLOST)
-			lc ++ ;
-		i -- ;
-	}
+	back_to_losses(i, pc, lc, (int)numpkts);
 
 	if (pc == 0) 
 		p = 0; 
@@ -1061,7 +1236,7 @@ double TfrcSinkAgent::est_loss_EBPH () {
 			print_loss(0, 1.0/p);
 		else
 			print_loss(0, 0.00001);
-		print_loss_all(sample);
+		print_loss_all();
 	}
 	return p ;
 }
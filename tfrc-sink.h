@@ -33,6 +33,7 @@
  *
  */
 
+#include <stdint.h>
 #include "agent.h"
 #include "packet.h"
 #include "ip.h"
@@ -60,6 +61,71 @@
 
 class TfrcSinkAgent;
 
+/*
+ * The receive history of TfrcSinkAgent, indexed by seqno%size.
+ * The packet status is kept in 4 bits, 16 packets to a 64-bit word,
+ *   so the scans for a status go a word at a time.
+ * The arrival time and the timestamp are kept as float offsets from a
+ *   base shared by each block of 16 packets.  The base is moved forward
+ *   when the receiver enters the block again.
+ */
+#define HIST_BLOCK 16
+
+class TfrcRecvHistory {
+public:
+	TfrcRecvHistory() : size_(0), nblocks_(0), state_(NULL), rt_(NULL),
+	    ts_(NULL), rt_base_(NULL), ts_base_(NULL) {}
+	~TfrcRecvHistory();
+	int init(int size, double rt, double ts);
+	inline int state(int seq) const {
+		int i = seq % size_;
+		return (int)((state_[i/HIST_BLOCK] >> (4*(i%HIST_BLOCK))) & 0xf);
+	}
+	inline void set_state(int seq, int st) {
+		int i = seq % size_;
+		uint64_t *w = &state_[i/HIST_BLOCK];
+		int sh = 4*(i%HIST_BLOCK);
+		*w = (*w & ~((uint64_t)0xf << sh)) | ((uint64_t)st << sh);
+	}
+	inline double rt(int seq) const {
+		int i = seq % size_;
+		return rt_base_[i/HIST_BLOCK] + rt_[i];
+	}
+	inline double ts(int seq) const {
+		int i = seq % size_;
+		return ts_base_[i/HIST_BLOCK] + ts_[i];
+	}
+	inline void set_rt(int seq, double t) {
+		int i = seq % size_;
+		rt_[i] = (float)(t - rt_base_[i/HIST_BLOCK]);
+	}
+	inline void set_ts(int seq, double t) {
+		int i = seq % size_;
+		ts_[i] = (float)(t - ts_base_[i/HIST_BLOCK]);
+	}
+	// set the status of [from, to)
+	void fill(int from, int to, int st);
+	// replace the status st1 or st2 by st in [from, to)
+	void replace(int from, int to, int st1, int st2, int st);
+	// first (last) seqno in [from, to) with status st1 or st2,
+	//   to (from-1) if none
+	int find_next(int from, int to, int st1, int st2) const;
+	int find_prev(int from, int to, int st1, int st2) const;
+	// number of packets in [from, to) with status st1 or st2
+	int count(int from, int to, int st1, int st2) const;
+	// the blocks starting in [from, to) are entered again at (rt, ts)
+	void rebase(int from, int to, double rt, double ts);
+protected:
+	inline uint64_t match(int w, int st1, int st2) const;
+	int size_;		// number of packets
+	int nblocks_;
+	uint64_t *state_;	// packet status, 4 bits per packet
+	float *rt_;		// arrival time - rt_base_
+	float *ts_;		// timestamp - ts_base_
+	double *rt_base_;	// per block
+	double *ts_base_;	// per block
+};
+
 class TfrcNackTimer : public TimerHandler {
 public:
 	TfrcNackTimer(TfrcSinkAgent *a) : TimerHandler() { 
@@ -83,27 +149,31 @@ protected:
 	double est_thput(); 
 	int command(int argc, const char*const* argv);
 	void print_loss(int sample, double ave_interval);
-	void print_loss_all(int *sample);
-	void print_losses_all(int *losses);
-	void print_count_losses_all(int *count_losses);
-	void print_num_rtts_all(int *num_rtts);
+	void print_loss_all();
+	void print_losses_all();
+	void print_count_losses_all();
+	void print_num_rtts_all();
 	int new_loss(int i, double tstamp);
 	double estimate_tstamp(int before, int after, int i);
 
 	// algo specific
 	double est_loss_WALI();
-	void shift_array(int *a, int sz, int defval) ;
-	void shift_array(double *a, int sz, double defval) ;
-	void multiply_array(double *a, int sz, double multiplier);
 	void init_WALI();
-	double weighted_average(int start, int end, double factor, double *m, double *w, int *sample);
+	void new_loss_interval();
+	void discount_history(double multiplier);
 	int get_sample(int oldSample, int numLosses);
 	int get_sample_rtts(int oldSample, int numLosses, int rtts);
-	double weighted_average1(int start, int end, double factor, double *m, double *w, int *sample, int ShortIntervals, int *losses, int *count_losses, int *num_rtts);
+	int interval_sample(int i, int smooth);
+	void update_older_sums(int ds);
+	// Slot of loss interval i in the WALI arrays, 0 being the most
+	//   recent interval.
+	inline int slot(int i) { return (hist_head_ + i) % (numsamples+1); }
+	inline double mult_at(int i) { return mult[slot(i)] * mult_scale_; }
 
 	double est_loss_EWMA () ;
 	
 	double est_loss_RBPH () ;
+	void back_to_losses(int &i, int &pc, int &lc, int maxpc);
 
 	double est_loss_EBPH() ;
 
@@ -134,6 +204,8 @@ protected:
         double minDiscountRatio_; 	// Minimum for history discounting.
 	int numPktsSoFar_;	// Num non-sequential packets so far
 	int PreciseLoss_;       // to estimate loss events more precisely
+	double InverseAccuracy_;	// relative accuracy of b_to_p(),
+					//  "0" for the original bisection
 
 	// an option for single-RTT loss intervals
 	int ShortIntervals_ ;	// For calculating loss event rates for short 
@@ -151,27 +223,39 @@ protected:
 	double last_timestamp_; // timestamp of last new, in-order pkt arrival.
 	double last_arrival_;   // time of last new, in-order pkt arrival.
 	int hsz;		// InitHistorySize_, number of pkts in history
-	char *lossvec_;		// array with packet history
-	double *rtvec_;		// array with time of packet arrival
-	double *tsvec_;		// array with timestamp of packet
+	TfrcRecvHistory hist_;	// packet status, time of packet arrival
+				//   and timestamp of packet
 	int lastloss_round_id ; // round_id for start of loss event
 	int round_id ;		// round_id of last new, in-order packet
 	double lastloss; 	// when last loss occured
 
 	// WALI specific
+	// sample, mult, losses, count_losses and num_rtts are circular,
+	//   indexed through slot(); weights is indexed by interval.
 	int numsamples ;
 	int *sample;		// array with size of loss interval
 	double *weights ;	// weight for loss interval
-	double *mult ;		// discount factor for loss interval
+	double *mult ;		// discount factor for loss interval,
+				//   scaled by mult_scale_
 	int *losses ;		// array with number of losses per loss
 				//   interval
 	int *count_losses ;	// "1" to count losses in the loss interval
         int *num_rtts ;         // number of rtts per loss interval
+	int hist_head_;		// slot of the most recent loss interval
+	double mult_scale_;	// discounts applied to the whole history
 	double mult_factor_;	// most recent multiple of mult array
 	int sample_count ;	// number of loss intervals
 	int last_sample ;  	// loss event rate estimated to here
 	int init_WALI_flag;	// sample arrays initialized
 
+	// Weighted sums over the loss intervals before the most recent one,
+	//   valid until the history or the parameters below change.
+	int older_valid_;
+	int older_ds_, older_fsize_, older_size_, older_short_, older_rtts_;
+	int older_smooth_;
+	double older_wsum_, older_sum_;		// weights w[i]
+	double older_wsum1_, older_sum1_;	// weights w[i+1], for smooth_
+
 	// these are for "faking" history after slow start
 	int loss_seen_yet; 	// have we seen the first loss yet?
 	int adjust_history_after_ss; // fake history after slow start? (0/1)